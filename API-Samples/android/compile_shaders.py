@@ -27,7 +27,7 @@ if not os.path.exists(headersdir):
 assembly_files = ["spirv_assembly.vert", "spirv_assembly.frag", "specialized.frag"]
 for root, dir, files in os.walk(samplesdir):
     for file in files:
-        if file.endswith(".vert") or file.endswith(".frag"):
+        if file.endswith(".vert") or file.endswith(".frag") or file.endswith(".comp"):
             samplepath = os.path.join(root, file)
             if file in assembly_files:
                 args = [ sys.executable, script, samplepath, os.path.join(headersdir, file + ".h"), assembler, "true"]
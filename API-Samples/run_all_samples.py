@@ -24,6 +24,8 @@ for root, dir, files in os.walk(samplesdir):
 
 samples.sort()
 samples_requiring_validation_layer = ["enable_validation_with_callback", "validation_cache"]
+# Run again with the compressed, mipmapped KTX2 texture, natively or decoded on the CPU
+samples_with_ktx_texture = ["draw_textured_cube"]
 for sample in samples:
     executable = os.path.join(directory, sample)
     print('exe = ' + executable)
@@ -33,5 +35,8 @@ for sample in samples:
     if os.path.isfile(executable + suffix):
         print('Running: ' + sample)
         subprocess.check_call(executable)
+        if sample in samples_with_ktx_texture:
+            print('Running: ' + sample + ' --texture lunarg.ktx2')
+            subprocess.check_call([executable, "--texture", "lunarg.ktx2"])
     else:
         print("Skipping {} because the sample doesn't seem to be built".format(sample))
@@ -0,0 +1,184 @@
+/*
+ * Vulkan Samples
+ *
+ * Copyright (C) 2015-2016 Valve Corporation
+ * Copyright (C) 2015-2016 LunarG, Inc.
+ * Copyright (C) 2015-2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Times the per-pixel fread loop read_ppm used to have against
+ * open_image/read_image, decoding to RGBA8 rows with padding, and checks
+ * that both produce the same texels.  Without -f a PPM is generated.
+ *
+ *   SamplesImageBench [-f file.ppm] [-w width] [-h height] [-r runs]
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "util.hpp"
+
+/* read_ppm as it was before it moved to open_image */
+static bool read_ppm_fread(char const *const filename, int &width, int &height, uint64_t rowPitch, unsigned char *dataPtr) {
+    char magicStr[3] = {}, heightStr[6] = {}, widthStr[6] = {}, formatStr[6] = {};
+
+    FILE *fPtr = fopen(filename, "rb");
+    if (!fPtr) return false;
+
+    int count = fscanf(fPtr, "%2s %5s %5s %5s ", magicStr, widthStr, heightStr, formatStr);
+    if (count != 4 || strncmp(magicStr, "P6", sizeof(magicStr))) {
+        fclose(fPtr);
+        return false;
+    }
+
+    width = atoi(widthStr);
+    height = atoi(heightStr);
+
+    for (int y = 0; y < height; y++) {
+        unsigned char *rowPtr = dataPtr;
+        for (int x = 0; x < width; x++) {
+            count = fread(rowPtr, 3, 1, fPtr);
+            if (count != 1) {
+                fclose(fPtr);
+                return false;
+            }
+            rowPtr[3] = 255; /* Alpha of 1 */
+            rowPtr += 4;
+        }
+        dataPtr += rowPitch;
+    }
+    fclose(fPtr);
+
+    return true;
+}
+
+static bool read_image_file(char const *const filename, uint64_t rowPitch, unsigned char *dataPtr) {
+    image_file image;
+    if (!open_image(filename, image)) return false;
+
+    bool ok = read_image(image, rowPitch, dataPtr);
+    close_image(image);
+
+    return ok;
+}
+
+static bool write_test_ppm(char const *const filename, int width, int height) {
+    FILE *fPtr = fopen(filename, "wb");
+    if (!fPtr) return false;
+
+    /* No comment, the fread loader does not handle them */
+    fprintf(fPtr, "P6\n%d %d\n255\n", width, height);
+
+    std::vector<unsigned char> row(width * 3);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width * 3; x++) row[x] = (unsigned char)(x * 7 + y * 13 + (x * y >> 5));
+        fwrite(row.data(), 1, row.size(), fPtr);
+    }
+    fclose(fPtr);
+
+    return true;
+}
+
+template <typename F>
+static double time_runs(int runs, F f) {
+    /* Warm the page cache */
+    f();
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) f();
+    auto end = std::chrono::steady_clock::now();
+
+    /* milliseconds per run */
+    return std::chrono::duration<double, std::milli>(end - begin).count() / runs;
+}
+
+int main(int argc, char **argv) {
+    std::string filename;
+    int width = 4096;
+    int height = 4096;
+    int runs = 5;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg(argv[i]);
+        if (arg == "-f" && i + 1 < argc) {
+            filename = argv[++i];
+        } else if (arg == "-w" && i + 1 < argc) {
+            width = atoi(argv[++i]);
+        } else if (arg == "-h" && i + 1 < argc) {
+            height = atoi(argv[++i]);
+        } else if (arg == "-r" && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else {
+            std::cerr << "usage: " << argv[0] << " [-f file.ppm] [-w width] [-h height] [-r runs]" << std::endl;
+            return 1;
+        }
+    }
+
+    const bool generated = filename.empty();
+    if (generated) {
+        filename = "image_load_bench.ppm";
+        if (width <= 0 || height <= 0 || !write_test_ppm(filename.c_str(), width, height)) {
+            std::cerr << "could not write " << filename << std::endl;
+            return 1;
+        }
+    }
+
+    image_file image;
+    if (!open_image(filename.c_str(), image)) {
+        std::cerr << "could not open " << filename << std::endl;
+        return 1;
+    }
+    width = image.width;
+    height = image.height;
+    close_image(image);
+
+    /* Pad the rows like a linear image's rowPitch usually is */
+    const uint64_t rowPitch = ((uint64_t)width * 4 + 255) & ~(uint64_t)255;
+    std::vector<unsigned char> fread_texels(rowPitch * height);
+    std::vector<unsigned char> image_texels(rowPitch * height);
+
+    int fread_width, fread_height;
+    bool ok = true;
+    const double fread_ms = time_runs(runs, [&]() {
+        ok &= read_ppm_fread(filename.c_str(), fread_width, fread_height, rowPitch, fread_texels.data());
+    });
+    const double image_ms = time_runs(runs, [&]() { ok &= read_image_file(filename.c_str(), rowPitch, image_texels.data()); });
+
+    if (generated) remove(filename.c_str());
+
+    if (!ok) {
+        std::cerr << "could not read " << filename << std::endl;
+        return 1;
+    }
+
+    bool match = fread_width == width && fread_height == height;
+    for (int y = 0; match && y < height; y++)
+        match = !memcmp(&fread_texels[rowPitch * y], &image_texels[rowPitch * y], width * 4);
+
+    const double megapixels = (double)width * height / 1e6;
+    std::cout << width << "x" << height << ", " << runs << " runs" << std::endl;
+    std::cout << "fread per pixel: " << fread_ms << " ms, " << megapixels / fread_ms * 1000.0 << " Mpixel/s" << std::endl;
+    std::cout << "open_image: " << image_ms << " ms, " << megapixels / image_ms * 1000.0 << " Mpixel/s, " << fread_ms / image_ms
+              << "x" << std::endl;
+    std::cout << "texels " << (match ? "match" : "DIFFER") << std::endl;
+
+    return match ? 0 : 1;
+}
@@ -0,0 +1,216 @@
+/*
+ * Vulkan Samples
+ *
+ * Copyright (C) 2015-2016 Valve Corporation
+ * Copyright (C) 2015-2016 LunarG, Inc.
+ * Copyright (C) 2015-2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Unit test of the buddy allocator behind allocate_device_memory: alignment,
+ * splitting and coalescing, exhaustion, and freeing in any order.
+ *
+ *   SamplesBuddyTest
+ */
+
+#include <stdio.h>
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+#include "util_buddy.hpp"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                           \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "%s:%d: CHECK(%s)\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                       \
+        }                                                                     \
+    } while (0)
+
+/* The block is back to one free range of the largest order */
+static bool buddy_whole(const buddy_allocator &buddy) {
+    for (uint32_t order = 0; order < buddy.max_order; order++) {
+        if (!buddy.free_lists[order].empty()) return false;
+    }
+    return buddy.free_lists[buddy.max_order].size() == 1 && *buddy.free_lists[buddy.max_order].begin() == 0;
+}
+
+/* Mark the min_size units of a range as used or not, false when one already was */
+static bool mark_range(std::vector<bool> &used, const buddy_allocator &buddy, uint64_t offset, uint32_t order, bool value) {
+    bool ok = true;
+    for (uint64_t unit = offset / buddy.min_size; unit < offset / buddy.min_size + (1u << order); unit++) {
+        if (value && used[unit]) ok = false;
+        used[unit] = value;
+    }
+    return ok;
+}
+
+static void test_order() {
+    CHECK(buddy_order(256, 1) == 0);
+    CHECK(buddy_order(256, 256) == 0);
+    CHECK(buddy_order(256, 257) == 1);
+    CHECK(buddy_order(256, 4096) == 4);
+    CHECK(buddy_order(256, 4097) == 5);
+
+    buddy_allocator buddy;
+    buddy_init(buddy, 256, 1 << 20);
+    CHECK(buddy.max_order == 12);
+    CHECK(buddy_whole(buddy));
+}
+
+static void test_alignment() {
+    buddy_allocator buddy;
+    buddy_init(buddy, 256, 1 << 20);
+
+    /* Mixed orders, every range aligned to its size and inside the block */
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    const uint32_t orders[] = {0, 3, 1, 0, 5, 2, 0, 4, 1, 3};
+    for (uint32_t order : orders) {
+        uint64_t offset;
+        CHECK(buddy_alloc(buddy, order, offset));
+        const uint64_t size = buddy.min_size << order;
+        CHECK(offset % size == 0);
+        CHECK(offset + size <= (buddy.min_size << buddy.max_order));
+        ranges.push_back(std::make_pair(offset, size));
+    }
+
+    /* and none overlap */
+    std::sort(ranges.begin(), ranges.end());
+    for (size_t i = 1; i < ranges.size(); i++) CHECK(ranges[i - 1].first + ranges[i - 1].second <= ranges[i].first);
+}
+
+static void test_split_and_coalesce() {
+    buddy_allocator buddy;
+    buddy_init(buddy, 256, 4096);
+
+    /* The first order 0 range splits the block down, leaving one free range
+     * of every smaller order */
+    uint64_t a;
+    CHECK(buddy_alloc(buddy, 0, a));
+    CHECK(a == 0);
+    for (uint32_t order = 0; order < buddy.max_order; order++) {
+        CHECK(buddy.free_lists[order].size() == 1);
+        CHECK(buddy.free_lists[order].count(256u << order) == 1);
+    }
+    CHECK(buddy.free_lists[buddy.max_order].empty());
+
+    /* The next one is a's buddy, without further splits */
+    uint64_t b;
+    CHECK(buddy_alloc(buddy, 0, b));
+    CHECK(b == 256);
+    CHECK(buddy.free_lists[0].empty());
+
+    /* Freeing one doesn't merge while its buddy is in use */
+    buddy_free(buddy, 0, a);
+    CHECK(buddy.free_lists[0].count(0) == 1);
+    CHECK(!buddy_whole(buddy));
+
+    /* Freeing the other merges all the way up */
+    buddy_free(buddy, 0, b);
+    CHECK(buddy_whole(buddy));
+}
+
+static void test_exhaustion() {
+    buddy_allocator buddy;
+    buddy_init(buddy, 256, 4096);
+
+    /* Larger than the block */
+    uint64_t offset;
+    CHECK(!buddy_alloc(buddy, buddy.max_order + 1, offset));
+
+    /* Sixteen order 0 ranges fill it */
+    std::vector<uint64_t> offsets;
+    for (int i = 0; i < 16; i++) {
+        CHECK(buddy_alloc(buddy, 0, offset));
+        offsets.push_back(offset);
+    }
+    CHECK(!buddy_alloc(buddy, 0, offset));
+    CHECK(!buddy_alloc(buddy, 1, offset));
+
+    /* A free order 0 range doesn't satisfy order 1 */
+    buddy_free(buddy, 0, offsets[5]);
+    CHECK(!buddy_alloc(buddy, 1, offset));
+    CHECK(buddy_alloc(buddy, 0, offset));
+    CHECK(offset == offsets[5]);
+
+    /* The whole block when nothing is in use */
+    for (uint64_t o : offsets) buddy_free(buddy, 0, o);
+    CHECK(buddy_whole(buddy));
+    CHECK(buddy_alloc(buddy, buddy.max_order, offset));
+    CHECK(offset == 0);
+    CHECK(!buddy_alloc(buddy, 0, offset));
+}
+
+static void test_free_in_any_order() {
+    std::mt19937 rng(1);
+
+    for (int round = 0; round < 100; round++) {
+        buddy_allocator buddy;
+        buddy_init(buddy, 256, 1 << 16);
+
+        /* Allocate random orders until full, tracking the units in use */
+        std::vector<std::pair<uint64_t, uint32_t>> live;
+        std::vector<bool> used(256, false);
+        for (;;) {
+            const uint32_t order = rng() % 4;
+            uint64_t offset;
+            if (!buddy_alloc(buddy, order, offset)) break;
+
+            CHECK(mark_range(used, buddy, offset, order, true));
+            live.push_back(std::make_pair(offset, order));
+        }
+
+        /* Free half in a random order, then allocate again into the holes */
+        std::shuffle(live.begin(), live.end(), rng);
+        for (size_t i = live.size() / 2; i < live.size(); i++) {
+            mark_range(used, buddy, live[i].first, live[i].second, false);
+            buddy_free(buddy, live[i].second, live[i].first);
+        }
+        live.resize(live.size() / 2);
+
+        for (int i = 0; i < 32; i++) {
+            const uint32_t order = rng() % 3;
+            uint64_t offset;
+            if (!buddy_alloc(buddy, order, offset)) continue;
+
+            CHECK(mark_range(used, buddy, offset, order, true));
+            live.push_back(std::make_pair(offset, order));
+        }
+
+        /* Free the rest in a random order, everything coalesces */
+        std::shuffle(live.begin(), live.end(), rng);
+        for (const auto &range : live) buddy_free(buddy, range.second, range.first);
+        CHECK(buddy_whole(buddy));
+    }
+}
+
+int main() {
+    test_order();
+    test_alignment();
+    test_split_and_coalesce();
+    test_exhaustion();
+    test_free_in_any_order();
+
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("buddy allocator tests passed\n");
+    return 0;
+}
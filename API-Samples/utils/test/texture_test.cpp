@@ -0,0 +1,157 @@
+/*
+ * Vulkan Samples
+ *
+ * Copyright (C) 2015-2016 Valve Corporation
+ * Copyright (C) 2015-2016 LunarG, Inc.
+ * Copyright (C) 2015-2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Unit test of the CPU decode of BC7 and ASTC blocks behind init_texture.
+ * Pseudo-random blocks cover every mode; their expected texels are hashes
+ * of what Mesa's decoders make of the same blocks.
+ *
+ *   SamplesTextureTest
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "util.hpp"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                           \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "%s:%d: CHECK(%s)\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                       \
+        }                                                                     \
+    } while (0)
+
+/* Blocks of a linear congruential generator.  ASTC void extent blocks keep
+ * their reserved bits set, those that aren't are checked on their own. */
+static std::vector<unsigned char> random_blocks(uint32_t count, uint32_t seed, bool astc) {
+    std::vector<unsigned char> blocks(count * 16);
+    for (auto &byte : blocks) {
+        seed = seed * 1664525 + 1013904223;
+        byte = (unsigned char)(seed >> 24);
+    }
+    for (uint32_t i = 0; astc && i < count; i++) {
+        unsigned char *block = &blocks[i * 16];
+        if (((block[0] | (block[1] << 8)) & 0x1FF) == 0x1FC) block[1] |= 0x0C;
+    }
+    return blocks;
+}
+
+static uint32_t fnv1a(const std::vector<unsigned char> &data) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char byte : data) hash = (hash ^ byte) * 16777619u;
+    return hash;
+}
+
+static std::vector<unsigned char> decode(VkFormat format, uint32_t width, uint32_t height, const unsigned char *blocks) {
+    std::vector<unsigned char> texels(width * height * 4);
+    CHECK(decode_texel_blocks(format, width, height, blocks, width * 4, texels.data()));
+    return texels;
+}
+
+static void test_random_blocks() {
+    static const struct {
+        VkFormat format;
+        uint32_t hash;
+    } tests[] = {
+        {VK_FORMAT_BC7_UNORM_BLOCK, 0xce62e8ab},       {VK_FORMAT_BC7_SRGB_BLOCK, 0x15a6d661},
+        {VK_FORMAT_ASTC_4x4_UNORM_BLOCK, 0x907ca483},  {VK_FORMAT_ASTC_4x4_SRGB_BLOCK, 0x6b5ff9ff},
+        {VK_FORMAT_ASTC_5x4_UNORM_BLOCK, 0xf7689595},  {VK_FORMAT_ASTC_6x5_SRGB_BLOCK, 0x41453c21},
+        {VK_FORMAT_ASTC_8x8_UNORM_BLOCK, 0x75ca6fd5},  {VK_FORMAT_ASTC_10x6_SRGB_BLOCK, 0xd8a06060},
+        {VK_FORMAT_ASTC_12x12_UNORM_BLOCK, 0x2bac286b},
+    };
+
+    for (const auto &test : tests) {
+        uint32_t block_width, block_height, block_size;
+        CHECK(get_format_block(test.format, block_width, block_height, block_size));
+
+        /* 64 by 64 blocks, cut short at the right and bottom */
+        const uint32_t width = 64 * block_width - 1, height = 64 * block_height - 2;
+        const bool astc = test.format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK;
+        const std::vector<unsigned char> blocks = random_blocks(64 * 64, test.format, astc);
+        const uint32_t hash = fnv1a(decode(test.format, width, height, blocks.data()));
+        if (hash != test.hash) fprintf(stderr, "format %d hashes to 0x%08x\n", test.format, hash);
+        CHECK(hash == test.hash);
+    }
+}
+
+static void test_bc7() {
+    /* Mode 6 with all endpoint bits set and index 15 everywhere, white */
+    unsigned char block[16];
+    memset(block, 0xFF, sizeof(block));
+    block[0] = 0xC0;
+    std::vector<unsigned char> texels = decode(VK_FORMAT_BC7_UNORM_BLOCK, 4, 4, block);
+    for (unsigned char value : texels) CHECK(value == 255);
+
+    /* No mode bit, transparent black */
+    memset(block, 0, sizeof(block));
+    texels = decode(VK_FORMAT_BC7_UNORM_BLOCK, 4, 4, block);
+    for (unsigned char value : texels) CHECK(value == 0);
+}
+
+static void test_astc() {
+    /* Void extent with all ones extents, 16-bit RGBA of which the top 8 bits count */
+    const unsigned char constant[16] = {0xFC, 0xFD, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                        0x34, 0x12, 0x78, 0x56, 0xBC, 0x9A, 0xF0, 0xDE};
+    std::vector<unsigned char> texels = decode(VK_FORMAT_ASTC_6x6_UNORM_BLOCK, 6, 6, constant);
+    for (size_t i = 0; i < texels.size(); i += 4)
+        CHECK(texels[i] == 0x12 && texels[i + 1] == 0x56 && texels[i + 2] == 0x9A && texels[i + 3] == 0xDE);
+
+    /* Magenta for reserved void extent bits and for reserved block modes */
+    unsigned char reserved[16];
+    memcpy(reserved, constant, sizeof(reserved));
+    reserved[1] = 0xF1;
+    texels = decode(VK_FORMAT_ASTC_4x4_SRGB_BLOCK, 4, 4, reserved);
+    for (size_t i = 0; i < texels.size(); i += 4)
+        CHECK(texels[i] == 255 && texels[i + 1] == 0 && texels[i + 2] == 255 && texels[i + 3] == 255);
+
+    memset(reserved, 0, sizeof(reserved));
+    texels = decode(VK_FORMAT_ASTC_4x4_UNORM_BLOCK, 4, 4, reserved);
+    for (size_t i = 0; i < texels.size(); i += 4)
+        CHECK(texels[i] == 255 && texels[i + 1] == 0 && texels[i + 2] == 255 && texels[i + 3] == 255);
+}
+
+static void test_decoded_formats() {
+    CHECK(get_decoded_format(VK_FORMAT_BC7_UNORM_BLOCK) == VK_FORMAT_R8G8B8A8_UNORM);
+    CHECK(get_decoded_format(VK_FORMAT_BC7_SRGB_BLOCK) == VK_FORMAT_R8G8B8A8_SRGB);
+    CHECK(get_decoded_format(VK_FORMAT_ASTC_4x4_UNORM_BLOCK) == VK_FORMAT_R8G8B8A8_UNORM);
+    CHECK(get_decoded_format(VK_FORMAT_ASTC_12x12_SRGB_BLOCK) == VK_FORMAT_R8G8B8A8_SRGB);
+
+    /* HDR has nowhere to go in RGBA8 */
+    CHECK(get_decoded_format(VK_FORMAT_BC6H_UFLOAT_BLOCK) == VK_FORMAT_UNDEFINED);
+    CHECK(get_decoded_format(VK_FORMAT_BC6H_SFLOAT_BLOCK) == VK_FORMAT_UNDEFINED);
+}
+
+int main() {
+    test_random_blocks();
+    test_bc7();
+    test_astc();
+    test_decoded_formats();
+
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("texture decode tests passed\n");
+    return 0;
+}
@@ -130,6 +130,12 @@ void set_image_layout(struct sample_info &info, VkImage image, VkImageAspectFlag
     assert(info.cmd != VK_NULL_HANDLE);
     assert(info.graphics_queue != VK_NULL_HANDLE);
 
+    set_image_layout(info, info.cmd, image, aspectMask, old_image_layout, new_image_layout, src_stages, dest_stages);
+}
+
+void set_image_layout(struct sample_info &info, VkCommandBuffer cmd, VkImage image, VkImageAspectFlags aspectMask,
+                      VkImageLayout old_image_layout, VkImageLayout new_image_layout, VkPipelineStageFlags src_stages,
+                      VkPipelineStageFlags dest_stages) {
     VkImageMemoryBarrier image_memory_barrier = {};
     image_memory_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     image_memory_barrier.pNext = NULL;
@@ -142,7 +148,7 @@ void set_image_layout(struct sample_info &info, VkImage image, VkImageAspectFlag
     image_memory_barrier.image = image;
     image_memory_barrier.subresourceRange.aspectMask = aspectMask;
     image_memory_barrier.subresourceRange.baseMipLevel = 0;
-    image_memory_barrier.subresourceRange.levelCount = 1;
+    image_memory_barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
     image_memory_barrier.subresourceRange.baseArrayLayer = 0;
     image_memory_barrier.subresourceRange.layerCount = 1;
 
@@ -188,87 +194,24 @@ void set_image_layout(struct sample_info &info, VkImage image, VkImageAspectFlag
             break;
     }
 
-    vkCmdPipelineBarrier(info.cmd, src_stages, dest_stages, 0, 0, NULL, 0, NULL, 1, &image_memory_barrier);
+    vkCmdPipelineBarrier(cmd, src_stages, dest_stages, 0, 0, NULL, 0, NULL, 1, &image_memory_barrier);
 }
 
 bool read_ppm(char const *const filename, int &width, int &height, uint64_t rowPitch, unsigned char *dataPtr) {
-    // PPM format expected from http://netpbm.sourceforge.net/doc/ppm.html
-    //  1. magic number
-    //  2. whitespace
-    //  3. width
-    //  4. whitespace
-    //  5. height
-    //  6. whitespace
-    //  7. max color value
-    //  8. whitespace
-    //  7. data
-
-    // Comments are not supported, but are detected and we kick out
-    // Only 8 bits per channel is supported
+    // Reads any image open_image handles, P6 PPM with comments and 8 or 16
+    // bits per channel, or PNG, expanded to RGBA8 rows rowPitch apart.
     // If dataPtr is nullptr, only width and height are returned
+    image_file image;
+    if (!open_image(filename, image)) return false;
 
-    // Read in values from the PPM file as characters to check for comments
-    char magicStr[3] = {}, heightStr[6] = {}, widthStr[6] = {}, formatStr[6] = {};
-
-#ifndef __ANDROID__
-    FILE *fPtr = fopen(filename, "rb");
-#else
-    FILE *fPtr = AndroidFopen(filename, "rb");
-#endif
-    if (!fPtr) {
-        printf("Bad filename in read_ppm: %s\n", filename);
-        return false;
-    }
-
-    // Read the four values from file, accounting with any and all whitepace
-    int U_ASSERT_ONLY count = fscanf(fPtr, "%s %s %s %s ", magicStr, widthStr, heightStr, formatStr);
-    assert(count == 4);
+    width = image.width;
+    height = image.height;
 
-    // Kick out if comments present
-    if (magicStr[0] == '#' || widthStr[0] == '#' || heightStr[0] == '#' || formatStr[0] == '#') {
-        printf("Unhandled comment in PPM file\n");
-        return false;
-    }
-
-    // Only one magic value is valid
-    if (strncmp(magicStr, "P6", sizeof(magicStr))) {
-        printf("Unhandled PPM magic number: %s\n", magicStr);
-        return false;
-    }
+    bool ok = true;
+    if (dataPtr != nullptr) ok = read_image(image, rowPitch, dataPtr);
 
-    width = atoi(widthStr);
-    height = atoi(heightStr);
-
-    // Ensure we got something sane for width/height
-    static const int saneDimension = 32768;  //??
-    if (width <= 0 || width > saneDimension) {
-        printf("Width seems wrong.  Update read_ppm if not: %u\n", width);
-        return false;
-    }
-    if (height <= 0 || height > saneDimension) {
-        printf("Height seems wrong.  Update read_ppm if not: %u\n", height);
-        return false;
-    }
-
-    if (dataPtr == nullptr) {
-        // If no destination pointer, caller only wanted dimensions
-        return true;
-    }
-
-    // Now read the data
-    for (int y = 0; y < height; y++) {
-        unsigned char *rowPtr = dataPtr;
-        for (int x = 0; x < width; x++) {
-            count = fread(rowPtr, 3, 1, fPtr);
-            assert(count == 1);
-            rowPtr[3] = 255; /* Alpha of 1 */
-            rowPtr += 4;
-        }
-        dataPtr += rowPitch;
-    }
-    fclose(fPtr);
-
-    return true;
+    close_image(image);
+    return ok;
 }
 
 #if (defined(VK_USE_PLATFORM_IOS_MVK) || defined(VK_USE_PLATFORM_MACOS_MVK))
@@ -363,12 +306,29 @@ void process_command_line_args(struct sample_info &info, int argc, char *argv[])
     for (i = 1, n = 1; i < argc; i++) {
         if (optionMatch("--save-images", argv[i]))
             info.save_images = true;
-        else if (optionMatch("--help", argv[i]) || optionMatch("-h", argv[i])) {
+        else if (optionMatch("--dedicated-memory", argv[i]))
+            info.memory_allocator.dedicated = true;
+        else if (optionMatch("--mipmaps", argv[i]))
+            info.generate_mipmaps = true;
+        else if (optionMatch("--texture", argv[i]) && i + 1 < argc) {
+            argv[n++] = argv[i++];
+            info.texture_name = argv[i];
+        } else if (optionMatch("--help", argv[i]) || optionMatch("-h", argv[i])) {
             printf("\nOther options:\n");
             printf(
                 "\t--save-images\n"
                 "\t\tSave tests images as ppm files in current working "
-                "directory.\n");
+                "directory.\n"
+                "\t--dedicated-memory\n"
+                "\t\tGive every helper allocation its own VkDeviceMemory "
+                "instead of sub-allocating.\n"
+                "\t--mipmaps\n"
+                "\t\tGenerate a full mip chain on the GPU for single level "
+                "textures, and sample textures trilinearly.\n"
+                "\t--texture <file>\n"
+                "\t\tLoad <file> from the data directory in place of the "
+                "default texture,\n"
+                "\t\tfor instance lunarg.ktx2 for BC7 with mip levels.\n");
             exit(0);
         } else {
             printf("\nUnrecognized option: %s\n", argv[i]);
@@ -484,12 +444,7 @@ void write_ppm(struct sample_info &info, const char *basename) {
     res = vkEndCommandBuffer(info.cmd);
     assert(res == VK_SUCCESS);
     const VkCommandBuffer cmd_bufs[] = {info.cmd};
-    VkFenceCreateInfo fenceInfo;
-    VkFence cmdFence;
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.pNext = NULL;
-    fenceInfo.flags = 0;
-    vkCreateFence(info.device, &fenceInfo, NULL, &cmdFence);
+    VkFence cmdFence = acquire_fence(info);
 
     VkSubmitInfo submit_info[1] = {};
     submit_info[0].pNext = NULL;
@@ -512,7 +467,7 @@ void write_ppm(struct sample_info &info, const char *basename) {
     } while (res == VK_TIMEOUT);
     assert(res == VK_SUCCESS);
 
-    vkDestroyFence(info.device, cmdFence, NULL);
+    release_fence(info, cmdFence);
 
     filename.append(basename);
     filename.append(".ppm");
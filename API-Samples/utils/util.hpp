@@ -99,6 +99,151 @@
 std::string get_base_data_dir();
 std::string get_data_dir(std::string filename);
 
+/*
+ * A range of device memory handed out by allocate_device_memory.  The
+ * VkDeviceMemory is usually shared with other allocations, so resources are
+ * bound at offset.  mapped points at offset when the memory type is host
+ * visible, the whole block being mapped once for its lifetime.
+ */
+struct device_memory_block;
+struct device_allocation {
+    VkDeviceMemory memory;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    void *mapped;
+
+    device_memory_block *block;
+    uint32_t order;
+};
+
+/*
+ * Sub-allocator behind the init_* helpers.  Each memory type has two lists of
+ * buddy-allocated blocks, one for buffers and linear images and one for
+ * optimal images, so neighbours never need bufferImageGranularity padding.
+ * Requests larger than half a block get a dedicated VkDeviceMemory.  Not
+ * thread safe.
+ */
+struct device_memory_allocator {
+    std::vector<std::vector<device_memory_block *>> pools;
+    bool dedicated;  // give every allocation its own VkDeviceMemory
+
+    uint32_t allocation_count;
+    VkDeviceSize bytes_used;
+    VkDeviceSize bytes_wasted;
+};
+
+struct device_memory_stats {
+    uint32_t block_count;
+    uint32_t allocation_count;
+    VkDeviceSize bytes_allocated;  // total size of all VkDeviceMemory blocks
+    VkDeviceSize bytes_used;       // sizes requested by live allocations
+    VkDeviceSize bytes_wasted;     // power of two rounding of live allocations
+};
+
+/*
+ * A command buffer of uploads in flight, and the end of its staging data in
+ * the ring.
+ */
+struct upload_batch {
+    uint64_t ticket;
+    VkCommandBuffer cmd;
+    VkFence fence;
+    uint64_t ring_end;
+};
+
+/*
+ * Staging for uploads.  Data is written to a persistently mapped ring buffer
+ * and the copies are recorded into one command buffer, submitted on the
+ * graphics queue by flush_uploads.  Every batch gets a ticket to wait on;
+ * ring space of completed batches is reused without waiting.  Fences and
+ * command buffers are pooled, and the fences are shared with the other
+ * helpers that submit work.  Set up on first use, not thread safe.
+ */
+struct upload_manager {
+    VkCommandPool cmd_pool;
+
+    VkBuffer buffer;
+    device_allocation alloc;
+    VkDeviceSize size;
+    /* ring positions only grow, the offset is position % size */
+    uint64_t head;
+    uint64_t tail;
+
+    /* ticket of the batch being recorded into cmd, 0 until set up */
+    uint64_t next_ticket;
+    VkCommandBuffer cmd;
+    std::vector<upload_batch> in_flight;
+
+    std::vector<VkCommandBuffer> free_cmds;
+    std::vector<VkFence> free_fences;
+};
+
+/*
+ * Room for size bytes of staging data, and the command buffer to record the
+ * copies out of it into.  ticket is the batch the copies belong to.
+ */
+struct upload_region {
+    void *data;
+    VkBuffer buffer;
+    VkDeviceSize offset;
+    VkCommandBuffer cmd;
+    uint64_t ticket;
+};
+
+/*
+ * A mip level of a KTX file, its texels are at contents + offset.
+ */
+struct image_level {
+    size_t offset;
+    size_t size;
+    uint32_t width, height;
+};
+
+/*
+ * An image file opened by open_image, mapped into memory where the platform
+ * allows.  read_image decodes it to RGBA8 rows rowPitch apart, which can be
+ * mapped Vulkan memory.  P6 PPM files, with comments and 8 or 16 bits per
+ * channel, and non-interlaced PNG files are handled, as well as 2D KTX and
+ * KTX2 files whose texels Vulkan can use as they are.
+ */
+struct image_file {
+    int width, height;
+
+    const unsigned char *contents;
+    size_t size;
+    bool mapped;
+    std::vector<unsigned char> buffer;  // contents when not mapped
+
+    int format;
+    int bit_depth;
+    int color_type;  // PNG
+    int max_value;   // PPM
+    size_t pixels;   // offset of the PPM pixels
+
+    VkFormat vk_format;  // of the KTX levels
+    std::vector<image_level> levels;  // KTX only, largest first
+};
+
+/*
+ * How generate_mipmaps fills the levels below level 0: a chain of
+ * vkCmdBlitImage calls, or mipmap_downsample.comp for RGBA8 images the
+ * format can't be blitted to.
+ */
+enum mipmap_method { MIPMAP_NONE, MIPMAP_BLIT, MIPMAP_COMPUTE };
+
+/*
+ * Objects the compute downsample records commands with, to be destroyed by
+ * destroy_mipmap_resources once those commands have completed.
+ */
+struct mipmap_resources {
+    VkShaderModule module;
+    VkDescriptorSetLayout desc_layout;
+    VkPipelineLayout pipeline_layout;
+    VkPipeline pipeline;
+    VkDescriptorPool desc_pool;
+    std::vector<VkImageView> views;  // one per level
+};
+
 /*
  * structure to track all objects related to a texture.
  */
@@ -114,6 +259,10 @@ struct texture_object {
 
     VkDeviceMemory image_memory;
     VkDeviceMemory buffer_memory;
+    device_allocation image_alloc;
+    device_allocation buffer_alloc;
+    // batch of info.uploads copying the texels, 0 if written by the host
+    uint64_t upload_ticket;
     VkImageView view;
     int32_t tex_width, tex_height;
 };
@@ -168,6 +317,8 @@ struct sample_info {
     bool prepared;
     bool use_staging_buffer;
     bool save_images;
+    bool generate_mipmaps;
+    const char *texture_name;  // --texture, in place of lunarg.ppm
 
     std::vector<const char *> instance_layer_names;
     std::vector<const char *> instance_extension_names;
@@ -184,8 +335,11 @@ struct sample_info {
     uint32_t graphics_queue_family_index;
     uint32_t present_queue_family_index;
     VkPhysicalDeviceProperties gpu_props;
+    VkPhysicalDeviceFeatures enabled_features;
     std::vector<VkQueueFamilyProperties> queue_props;
     VkPhysicalDeviceMemoryProperties memory_properties;
+    device_memory_allocator memory_allocator;
+    upload_manager uploads;
 
     VkFramebuffer *framebuffers;
     int width, height;
@@ -203,6 +357,7 @@ struct sample_info {
 
         VkImage image;
         VkDeviceMemory mem;
+        device_allocation alloc;
         VkImageView view;
     } depth;
 
@@ -211,6 +366,7 @@ struct sample_info {
     struct {
         VkBuffer buf;
         VkDeviceMemory mem;
+        device_allocation alloc;
         VkDescriptorBufferInfo buffer_info;
     } uniform_data;
 
@@ -221,6 +377,7 @@ struct sample_info {
     struct {
         VkBuffer buf;
         VkDeviceMemory mem;
+        device_allocation alloc;
         VkDescriptorBufferInfo buffer_info;
     } vertex_buffer;
     VkVertexInputBindingDescription vi_binding;
@@ -261,15 +418,58 @@ bool memory_type_from_properties(struct sample_info &info, uint32_t typeBits,
                                  VkFlags requirements_mask,
                                  uint32_t *typeIndex);
 
+bool allocate_device_memory(struct sample_info &info,
+                            const VkMemoryRequirements &mem_reqs,
+                            VkFlags requirements_mask, bool optimal_image,
+                            device_allocation &alloc);
+void free_device_memory(struct sample_info &info, device_allocation &alloc);
+void free_all_device_memory(struct sample_info &info);
+void get_device_memory_stats(const struct sample_info &info,
+                             device_memory_stats &stats);
+
+bool begin_upload(struct sample_info &info, VkDeviceSize size,
+                  VkDeviceSize alignment, upload_region &region);
+uint64_t flush_uploads(struct sample_info &info);
+void wait_upload(struct sample_info &info, uint64_t ticket);
+VkFence acquire_fence(struct sample_info &info);
+void release_fence(struct sample_info &info, VkFence fence);
+void destroy_upload_manager(struct sample_info &info);
+
 void set_image_layout(struct sample_info &demo, VkImage image,
                       VkImageAspectFlags aspectMask,
                       VkImageLayout old_image_layout,
                       VkImageLayout new_image_layout,
                       VkPipelineStageFlags src_stages,
                       VkPipelineStageFlags dest_stages);
+void set_image_layout(struct sample_info &demo, VkCommandBuffer cmd,
+                      VkImage image, VkImageAspectFlags aspectMask,
+                      VkImageLayout old_image_layout,
+                      VkImageLayout new_image_layout,
+                      VkPipelineStageFlags src_stages,
+                      VkPipelineStageFlags dest_stages);
 
 bool read_ppm(char const *const filename, int &width, int &height,
               uint64_t rowPitch, unsigned char *dataPtr);
+bool open_image(char const *const filename, image_file &image);
+bool read_image(const image_file &image, uint64_t rowPitch,
+                unsigned char *dataPtr);
+bool read_image_level(const image_file &image, uint32_t level,
+                      uint64_t rowPitch, unsigned char *dataPtr);
+void close_image(image_file &image);
+bool get_format_block(VkFormat format, uint32_t &block_width,
+                      uint32_t &block_height, uint32_t &block_size);
+VkFormat get_decoded_format(VkFormat format);
+bool decode_texel_blocks(VkFormat format, uint32_t width, uint32_t height,
+                         const unsigned char *blocks, uint64_t rowPitch,
+                         unsigned char *dataPtr);
+uint32_t get_mip_level_count(uint32_t width, uint32_t height);
+mipmap_method get_mipmap_method(struct sample_info &info, VkFormat format);
+void generate_mipmaps(struct sample_info &info, VkCommandBuffer cmd,
+                      VkImage image, VkFormat format, uint32_t width,
+                      uint32_t height, uint32_t levels, mipmap_method method,
+                      mipmap_resources &resources);
+void destroy_mipmap_resources(struct sample_info &info,
+                              mipmap_resources &resources);
 void write_ppm(struct sample_info &info, const char *basename);
 void extract_version(uint32_t version, uint32_t &major, uint32_t &minor,
                      uint32_t &patch);
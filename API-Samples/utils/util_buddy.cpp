@@ -0,0 +1,80 @@
+/*
+ * Vulkan Samples
+ *
+ * Copyright (C) 2015-2016 Valve Corporation
+ * Copyright (C) 2015-2016 LunarG, Inc.
+ * Copyright (C) 2015-2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+VULKAN_SAMPLE_DESCRIPTION
+samples buddy allocator
+*/
+
+#include <algorithm>
+#include "util_buddy.hpp"
+
+/* Smallest order whose ranges hold size bytes */
+uint32_t buddy_order(uint64_t min_size, uint64_t size) {
+    uint32_t order = 0;
+    while ((min_size << order) < size) order++;
+    return order;
+}
+
+/* One free range covering the whole block */
+void buddy_init(buddy_allocator &buddy, uint64_t min_size, uint64_t size) {
+    buddy.min_size = min_size;
+    buddy.max_order = buddy_order(min_size, size);
+    buddy.free_lists.clear();
+    buddy.free_lists.resize(buddy.max_order + 1);
+    buddy.free_lists[buddy.max_order].insert(0);
+}
+
+/*
+ * Take a range of the given order, splitting the smallest larger free range
+ * when there is none.
+ */
+bool buddy_alloc(buddy_allocator &buddy, uint32_t order, uint64_t &offset) {
+    uint32_t found = order;
+    while (found <= buddy.max_order && buddy.free_lists[found].empty()) found++;
+    if (found > buddy.max_order) return false;
+
+    offset = *buddy.free_lists[found].begin();
+    buddy.free_lists[found].erase(buddy.free_lists[found].begin());
+
+    /* Give back the upper half of each split */
+    while (found > order) {
+        found--;
+        buddy.free_lists[found].insert(offset + (buddy.min_size << found));
+    }
+
+    return true;
+}
+
+/*
+ * Return a range, merging it with its buddy for as long as the buddy is free
+ * too.
+ */
+void buddy_free(buddy_allocator &buddy, uint32_t order, uint64_t offset) {
+    while (order < buddy.max_order) {
+        const uint64_t other = offset ^ (buddy.min_size << order);
+        if (!buddy.free_lists[order].erase(other)) break;
+
+        offset = std::min(offset, other);
+        order++;
+    }
+
+    buddy.free_lists[order].insert(offset);
+}
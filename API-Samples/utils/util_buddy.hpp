@@ -0,0 +1,46 @@
+/*
+ * Vulkan Samples
+ *
+ * Copyright (C) 2015-2016 Valve Corporation
+ * Copyright (C) 2015-2016 LunarG, Inc.
+ * Copyright (C) 2015-2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UTIL_BUDDY_HPP
+#define UTIL_BUDDY_HPP
+
+#include <stdint.h>
+#include <set>
+#include <vector>
+
+/*
+ * Buddy allocator over the offsets of one block of min_size << max_order
+ * bytes.  A range of order n is min_size << n bytes and aligned to its size.
+ * It knows nothing of Vulkan, allocate_device_memory keeps one per block.
+ */
+struct buddy_allocator {
+    uint64_t min_size;
+    uint32_t max_order;
+
+    /* offsets of the free ranges of each order */
+    std::vector<std::set<uint64_t>> free_lists;
+};
+
+uint32_t buddy_order(uint64_t min_size, uint64_t size);
+void buddy_init(buddy_allocator &buddy, uint64_t min_size, uint64_t size);
+bool buddy_alloc(buddy_allocator &buddy, uint32_t order, uint64_t &offset);
+void buddy_free(buddy_allocator &buddy, uint32_t order, uint64_t offset);
+
+#endif  // UTIL_BUDDY_HPP
@@ -0,0 +1,976 @@
+/*
+ * Vulkan Samples
+ *
+ * Copyright (C) 2015-2016 Valve Corporation
+ * Copyright (C) 2015-2016 LunarG, Inc.
+ * Copyright (C) 2015-2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+VULKAN_SAMPLE_DESCRIPTION
+samples image file loading
+*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "util.hpp"
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif !defined(__ANDROID__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/*
+ * The SSSE3 kernel is built on every x86 compiler, for targets without
+ * SSSE3 too, and picked at run time unless the target guarantees it.
+ */
+#if defined(__SSSE3__) || defined(__AVX__)
+#include <tmmintrin.h>
+#define IMAGE_RGB_SSSE3
+#define IMAGE_RGB_SSSE3_TARGET
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+#define IMAGE_RGB_SSSE3
+#define IMAGE_RGB_SSSE3_DISPATCH
+#define IMAGE_RGB_SSSE3_TARGET __attribute__((target("ssse3")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <tmmintrin.h>
+#define IMAGE_RGB_SSSE3
+#define IMAGE_RGB_SSSE3_DISPATCH
+#define IMAGE_RGB_SSSE3_TARGET
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IMAGE_RGB_NEON
+#endif
+
+enum {
+    IMAGE_FORMAT_PPM,
+    IMAGE_FORMAT_PNG,
+    IMAGE_FORMAT_KTX,
+};
+
+/* Ensure we got something sane for width/height */
+static const int saneDimension = 32768;
+
+#if defined(IMAGE_RGB_SSSE3)
+/*
+ * Expand RGB8 pixels to RGBA8 four at a time, returning how many were.
+ */
+IMAGE_RGB_SSSE3_TARGET static int expand_rgb_to_rgba_ssse3(const unsigned char *src, unsigned char *dst, int count) {
+    int x = 0;
+
+    /* 16 byte loads read two pixels past the four used, keep them in the row */
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+    for (; x + 6 <= count; x += 4) {
+        __m128i rgb = _mm_loadu_si128((const __m128i *)(src + 3 * x));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+    }
+
+    return x;
+}
+
+static bool cpu_has_ssse3() {
+#if !defined(IMAGE_RGB_SSSE3_DISPATCH)
+    return true;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+#endif
+
+/*
+ * Expand count RGB8 pixels to RGBA8 with an alpha of 1.
+ */
+static void expand_rgb_to_rgba(const unsigned char *src, unsigned char *dst, int count) {
+    int x = 0;
+
+#if defined(IMAGE_RGB_SSSE3)
+    static const bool ssse3 = cpu_has_ssse3();
+    if (ssse3) x = expand_rgb_to_rgba_ssse3(src, dst, count);
+#elif defined(IMAGE_RGB_NEON)
+    for (; x + 16 <= count; x += 16) {
+        uint8x16x3_t rgb = vld3q_u8(src + 3 * x);
+        uint8x16x4_t rgba;
+        rgba.val[0] = rgb.val[0];
+        rgba.val[1] = rgb.val[1];
+        rgba.val[2] = rgb.val[2];
+        rgba.val[3] = vdupq_n_u8(255);
+        vst4q_u8(dst + 4 * x, rgba);
+    }
+#endif
+
+    for (; x < count; x++) {
+        dst[4 * x + 0] = src[3 * x + 0];
+        dst[4 * x + 1] = src[3 * x + 1];
+        dst[4 * x + 2] = src[3 * x + 2];
+        dst[4 * x + 3] = 255; /* Alpha of 1 */
+    }
+}
+
+/*
+ * PPM format expected from http://netpbm.sourceforge.net/doc/ppm.html
+ *  1. magic number P6
+ *  2. whitespace
+ *  3. width
+ *  4. whitespace
+ *  5. height
+ *  6. whitespace
+ *  7. max color value, below 256 for 8 bits per channel, else 16
+ *  8. a single whitespace
+ *  9. data
+ * A '#' starts a comment up to the end of the line, anywhere before 8.
+ */
+static bool read_ppm_number(const image_file &image, size_t &pos, int &value) {
+    while (pos < image.size) {
+        const unsigned char c = image.contents[pos];
+        if (c == '#') {
+            while (pos < image.size && image.contents[pos] != '\n' && image.contents[pos] != '\r') pos++;
+        } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f') {
+            pos++;
+        } else {
+            break;
+        }
+    }
+
+    if (pos >= image.size || image.contents[pos] < '0' || image.contents[pos] > '9') return false;
+
+    value = 0;
+    while (pos < image.size && image.contents[pos] >= '0' && image.contents[pos] <= '9') {
+        value = value * 10 + (image.contents[pos++] - '0');
+        if (value > 1 << 24) return false;
+    }
+
+    return true;
+}
+
+static bool open_ppm(image_file &image) {
+    size_t pos = 2;
+    int max_value;
+    if (!read_ppm_number(image, pos, image.width) || !read_ppm_number(image, pos, image.height) ||
+        !read_ppm_number(image, pos, max_value)) {
+        printf("Bad PPM header\n");
+        return false;
+    }
+
+    if (max_value <= 0 || max_value > 65535) {
+        printf("Unhandled PPM max color value: %d\n", max_value);
+        return false;
+    }
+
+    image.format = IMAGE_FORMAT_PPM;
+    image.max_value = max_value;
+    image.bit_depth = max_value < 256 ? 8 : 16;
+    image.pixels = pos + 1;
+
+    const size_t data_size = (size_t)image.width * image.height * 3 * (image.bit_depth / 8);
+    if (image.pixels > image.size || image.size - image.pixels < data_size) {
+        printf("PPM file is truncated\n");
+        return false;
+    }
+
+    return true;
+}
+
+static void read_ppm_pixels(const image_file &image, uint64_t rowPitch, unsigned char *dataPtr) {
+    const unsigned char *src = image.contents + image.pixels;
+
+    if (image.bit_depth == 8 && image.max_value == 255) {
+        for (int y = 0; y < image.height; y++) {
+            expand_rgb_to_rgba(src, dataPtr, image.width);
+            src += 3 * image.width;
+            dataPtr += rowPitch;
+        }
+        return;
+    }
+
+    /* Rescale other ranges, 16 bit values are big endian */
+    const int max_value = image.max_value;
+    for (int y = 0; y < image.height; y++) {
+        unsigned char *rowPtr = dataPtr;
+        for (int x = 0; x < image.width; x++) {
+            for (int c = 0; c < 3; c++) {
+                int value = *src++;
+                if (image.bit_depth == 16) value = (value << 8) | *src++;
+                if (value > max_value) value = max_value;
+                rowPtr[c] = (unsigned char)((value * 255 + max_value / 2) / max_value);
+            }
+            rowPtr[3] = 255; /* Alpha of 1 */
+            rowPtr += 4;
+        }
+        dataPtr += rowPitch;
+    }
+}
+
+/*
+ * Inflate for the zlib stream of PNG files, RFC 1951.  Huffman codes up to
+ * INFLATE_FAST_BITS long are decoded with one table lookup, longer ones bit
+ * by bit.
+ */
+#define INFLATE_MAX_BITS 15
+#define INFLATE_FAST_BITS 9
+
+struct inflate_huffman {
+    uint16_t count[INFLATE_MAX_BITS + 1];
+    uint16_t symbol[288];
+    /* (length << 9) | symbol, 0 for codes longer than INFLATE_FAST_BITS */
+    uint16_t fast[1 << INFLATE_FAST_BITS];
+};
+
+struct inflate_state {
+    const unsigned char *in;
+    size_t in_size;
+    size_t in_pos;
+    uint64_t bit_buf;
+    int bit_count;
+
+    unsigned char *out;
+    size_t out_size;
+    size_t out_pos;
+};
+
+static void inflate_fill(inflate_state &s, int count) {
+    while (s.bit_count < count) {
+        const uint64_t byte = s.in_pos < s.in_size ? s.in[s.in_pos] : 0;
+        s.in_pos++;
+        s.bit_buf |= byte << s.bit_count;
+        s.bit_count += 8;
+    }
+}
+
+static uint32_t inflate_bits(inflate_state &s, int count) {
+    if (!count) return 0;
+    inflate_fill(s, count);
+    const uint32_t value = (uint32_t)(s.bit_buf & ((1ull << count) - 1));
+    s.bit_buf >>= count;
+    s.bit_count -= count;
+    return value;
+}
+
+/* Whether the stream read past its input, which zero fills */
+static bool inflate_overrun(const inflate_state &s) { return s.in_pos * 8 - s.bit_count > s.in_size * 8; }
+
+static bool inflate_build(inflate_huffman &h, const uint8_t *lengths, int count) {
+    memset(h.count, 0, sizeof(h.count));
+    for (int i = 0; i < count; i++) h.count[lengths[i]]++;
+    h.count[0] = 0;
+
+    /* Reject over-subscribed codes, incomplete ones are caught when decoding */
+    int left = 1;
+    for (int len = 1; len <= INFLATE_MAX_BITS; len++) {
+        left = (left << 1) - h.count[len];
+        if (left < 0) return false;
+    }
+
+    uint16_t offsets[INFLATE_MAX_BITS + 1];
+    uint16_t next_code[INFLATE_MAX_BITS + 1];
+    offsets[1] = 0;
+    next_code[1] = 0;
+    for (int len = 1; len < INFLATE_MAX_BITS; len++) {
+        offsets[len + 1] = offsets[len] + h.count[len];
+        next_code[len + 1] = (next_code[len] + h.count[len]) << 1;
+    }
+
+    memset(h.fast, 0, sizeof(h.fast));
+    for (int sym = 0; sym < count; sym++) {
+        const int len = lengths[sym];
+        if (!len) continue;
+
+        h.symbol[offsets[len]++] = (uint16_t)sym;
+
+        const uint32_t code = next_code[len]++;
+        if (len > INFLATE_FAST_BITS) continue;
+
+        /* Codes are stored most significant bit first, the stream is read least significant first */
+        uint32_t reversed = 0;
+        for (int i = 0; i < len; i++) reversed |= ((code >> i) & 1) << (len - 1 - i);
+        for (uint32_t i = reversed; i < (1u << INFLATE_FAST_BITS); i += 1u << len) h.fast[i] = (uint16_t)((len << 9) | sym);
+    }
+
+    return true;
+}
+
+static int inflate_decode(inflate_state &s, const inflate_huffman &h) {
+    inflate_fill(s, INFLATE_FAST_BITS);
+    const uint16_t entry = h.fast[s.bit_buf & ((1 << INFLATE_FAST_BITS) - 1)];
+    if (entry) {
+        s.bit_buf >>= entry >> 9;
+        s.bit_count -= entry >> 9;
+        return entry & 511;
+    }
+
+    /* Walk the canonical code one bit at a time */
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len <= INFLATE_MAX_BITS; len++) {
+        code |= (int)inflate_bits(s, 1);
+        const int count = h.count[len];
+        if (code - count < first) return h.symbol[index + (code - first)];
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+
+    return -1;
+}
+
+static bool inflate_codes(inflate_state &s, const inflate_huffman &lencode, const inflate_huffman &distcode) {
+    static const uint16_t length_base[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                             31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const uint8_t length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const uint16_t dist_base[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                           193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static const uint8_t dist_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                           6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    while (true) {
+        int sym = inflate_decode(s, lencode);
+        if (sym < 0 || inflate_overrun(s)) return false;
+
+        if (sym < 256) {
+            if (s.out_pos >= s.out_size) return false;
+            s.out[s.out_pos++] = (unsigned char)sym;
+            continue;
+        }
+        if (sym == 256) return true;
+
+        sym -= 257;
+        if (sym >= 29) return false;
+        const size_t length = length_base[sym] + inflate_bits(s, length_extra[sym]);
+
+        sym = inflate_decode(s, distcode);
+        if (sym < 0 || sym >= 30) return false;
+        const size_t dist = dist_base[sym] + inflate_bits(s, dist_extra[sym]);
+
+        if (dist > s.out_pos || length > s.out_size - s.out_pos) return false;
+
+        /* Byte by byte, the ranges may overlap */
+        const unsigned char *from = s.out + s.out_pos - dist;
+        unsigned char *to = s.out + s.out_pos;
+        for (size_t i = 0; i < length; i++) to[i] = from[i];
+        s.out_pos += length;
+    }
+}
+
+static bool inflate_stored(inflate_state &s) {
+    /* Skip to the byte boundary */
+    inflate_bits(s, s.bit_count & 7);
+
+    const uint32_t length = inflate_bits(s, 16);
+    if ((inflate_bits(s, 16) ^ 0xffff) != length) return false;
+    if (length > s.out_size - s.out_pos) return false;
+
+    for (uint32_t i = 0; i < length; i++) s.out[s.out_pos++] = (unsigned char)inflate_bits(s, 8);
+
+    return !inflate_overrun(s);
+}
+
+static bool inflate_fixed(inflate_state &s) {
+    inflate_huffman lencode, distcode;
+    uint8_t lengths[288];
+
+    int sym = 0;
+    for (; sym < 144; sym++) lengths[sym] = 8;
+    for (; sym < 256; sym++) lengths[sym] = 9;
+    for (; sym < 280; sym++) lengths[sym] = 7;
+    for (; sym < 288; sym++) lengths[sym] = 8;
+    inflate_build(lencode, lengths, 288);
+
+    for (sym = 0; sym < 30; sym++) lengths[sym] = 5;
+    inflate_build(distcode, lengths, 30);
+
+    return inflate_codes(s, lencode, distcode);
+}
+
+static bool inflate_dynamic(inflate_state &s) {
+    static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+    const int nlen = inflate_bits(s, 5) + 257;
+    const int ndist = inflate_bits(s, 5) + 1;
+    const int ncode = inflate_bits(s, 4) + 4;
+    if (nlen > 286 || ndist > 30) return false;
+
+    uint8_t lengths[286 + 30] = {};
+    for (int i = 0; i < ncode; i++) lengths[order[i]] = (uint8_t)inflate_bits(s, 3);
+
+    inflate_huffman lencode, distcode;
+    if (!inflate_build(lencode, lengths, 19)) return false;
+
+    /* Code lengths of both codes, with runs */
+    int index = 0;
+    while (index < nlen + ndist) {
+        int sym = inflate_decode(s, lencode);
+        if (sym < 0 || inflate_overrun(s)) return false;
+
+        if (sym < 16) {
+            lengths[index++] = (uint8_t)sym;
+            continue;
+        }
+
+        uint8_t len = 0;
+        int repeat;
+        if (sym == 16) {
+            if (index == 0) return false;
+            len = lengths[index - 1];
+            repeat = 3 + inflate_bits(s, 2);
+        } else if (sym == 17) {
+            repeat = 3 + inflate_bits(s, 3);
+        } else {
+            repeat = 11 + inflate_bits(s, 7);
+        }
+
+        if (index + repeat > nlen + ndist) return false;
+        while (repeat--) lengths[index++] = len;
+    }
+
+    /* The end of block code must be there */
+    if (lengths[256] == 0) return false;
+
+    if (!inflate_build(lencode, lengths, nlen) || !inflate_build(distcode, lengths + nlen, ndist)) return false;
+
+    return inflate_codes(s, lencode, distcode);
+}
+
+static bool inflate_zlib(const unsigned char *in, size_t in_size, unsigned char *out, size_t out_size) {
+    /* zlib header, no preset dictionary, deflate only */
+    if (in_size < 2 || (in[0] & 0x0f) != 8 || ((in[0] << 8) | in[1]) % 31 || (in[1] & 0x20)) return false;
+
+    inflate_state s = {};
+    s.in = in + 2;
+    s.in_size = in_size - 2;
+    s.out = out;
+    s.out_size = out_size;
+
+    bool last;
+    do {
+        last = inflate_bits(s, 1) != 0;
+        bool ok;
+        switch (inflate_bits(s, 2)) {
+            case 0:
+                ok = inflate_stored(s);
+                break;
+            case 1:
+                ok = inflate_fixed(s);
+                break;
+            case 2:
+                ok = inflate_dynamic(s);
+                break;
+            default:
+                ok = false;
+                break;
+        }
+        if (!ok) return false;
+    } while (!last);
+
+    return s.out_pos == out_size;
+}
+
+/*
+ * PNG format expected from https://www.w3.org/TR/PNG/, non-interlaced with
+ * any color type and bit depth.  CRCs are not checked, and tRNS only applies
+ * to palettes.
+ */
+static uint32_t read_be32(const unsigned char *p) { return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+
+static int png_channels(int color_type) {
+    switch (color_type) {
+        case 0:
+            return 1;
+        case 2:
+            return 3;
+        case 3:
+            return 1;
+        case 4:
+            return 2;
+        case 6:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+static bool open_png(image_file &image) {
+    const unsigned char *ihdr = image.contents + 8;
+    if (image.size < 8 + 8 + 13 || read_be32(ihdr) != 13 || memcmp(ihdr + 4, "IHDR", 4)) {
+        printf("Bad PNG header\n");
+        return false;
+    }
+
+    image.format = IMAGE_FORMAT_PNG;
+    image.width = (int)std::min<uint32_t>(read_be32(ihdr + 8), 1u << 30);
+    image.height = (int)std::min<uint32_t>(read_be32(ihdr + 12), 1u << 30);
+    image.bit_depth = ihdr[16];
+    image.color_type = ihdr[17];
+
+    const int bits = image.bit_depth;
+    const bool valid_depth = image.color_type == 0   ? (bits == 1 || bits == 2 || bits == 4 || bits == 8 || bits == 16)
+                             : image.color_type == 3 ? (bits == 1 || bits == 2 || bits == 4 || bits == 8)
+                                                     : (bits == 8 || bits == 16);
+    if (!png_channels(image.color_type) || !valid_depth || ihdr[18] != 0 || ihdr[19] != 0) {
+        printf("Unhandled PNG color type %d with bit depth %d\n", image.color_type, image.bit_depth);
+        return false;
+    }
+    if (ihdr[20] != 0) {
+        printf("Interlaced PNG files are not supported\n");
+        return false;
+    }
+
+    return true;
+}
+
+static bool read_png_pixels(const image_file &image, uint64_t rowPitch, unsigned char *dataPtr) {
+    /* Palette, opaque unless a tRNS chunk says otherwise, and the zlib stream split over IDAT chunks */
+    unsigned char palette[256][4];
+    for (int i = 0; i < 256; i++) {
+        palette[i][0] = palette[i][1] = palette[i][2] = 0;
+        palette[i][3] = 255;
+    }
+    std::vector<unsigned char> zlib;
+    const unsigned char *idat = NULL;
+    size_t idat_size = 0;
+
+    size_t pos = 8;
+    while (pos + 12 <= image.size) {
+        const uint32_t length = read_be32(image.contents + pos);
+        const unsigned char *type = image.contents + pos + 4;
+        const unsigned char *data = type + 4;
+        if (length > image.size - pos - 12) break;
+
+        if (!memcmp(type, "PLTE", 4)) {
+            for (uint32_t i = 0; i < length / 3 && i < 256; i++) {
+                palette[i][0] = data[3 * i + 0];
+                palette[i][1] = data[3 * i + 1];
+                palette[i][2] = data[3 * i + 2];
+            }
+        } else if (!memcmp(type, "tRNS", 4) && image.color_type == 3) {
+            for (uint32_t i = 0; i < length && i < 256; i++) palette[i][3] = data[i];
+        } else if (!memcmp(type, "IDAT", 4)) {
+            /* A single IDAT chunk is inflated in place, several are joined */
+            if (!idat) {
+                idat = data;
+                idat_size = length;
+            } else {
+                if (zlib.empty()) zlib.assign(idat, idat + idat_size);
+                zlib.insert(zlib.end(), data, data + length);
+            }
+        } else if (!memcmp(type, "IEND", 4)) {
+            break;
+        }
+
+        pos += 12 + length;
+    }
+
+    if (!idat) {
+        printf("PNG file has no image data\n");
+        return false;
+    }
+    if (!zlib.empty()) {
+        idat = zlib.data();
+        idat_size = zlib.size();
+    }
+
+    /* Inflate to the filtered rows, each with a leading filter type byte */
+    const int channels = png_channels(image.color_type);
+    const int bits_per_pixel = channels * image.bit_depth;
+    const size_t row_size = ((size_t)image.width * bits_per_pixel + 7) / 8;
+    const size_t bpp = std::max(1, bits_per_pixel / 8);
+    std::vector<unsigned char> filtered((row_size + 1) * image.height);
+    if (!inflate_zlib(idat, idat_size, filtered.data(), filtered.size())) {
+        printf("Corrupt PNG image data\n");
+        return false;
+    }
+
+    std::vector<unsigned char> prior(row_size, 0);
+    for (int y = 0; y < image.height; y++) {
+        unsigned char *row = &filtered[(row_size + 1) * y];
+        const int filter = *row++;
+
+        switch (filter) {
+            case 0:
+                break;
+            case 1:
+                for (size_t i = bpp; i < row_size; i++) row[i] += row[i - bpp];
+                break;
+            case 2:
+                for (size_t i = 0; i < row_size; i++) row[i] += prior[i];
+                break;
+            case 3:
+                for (size_t i = 0; i < row_size; i++) row[i] += (unsigned char)(((i >= bpp ? row[i - bpp] : 0) + prior[i]) / 2);
+                break;
+            case 4:
+                for (size_t i = 0; i < row_size; i++) {
+                    const int a = i >= bpp ? row[i - bpp] : 0;
+                    const int b = prior[i];
+                    const int c = i >= bpp ? prior[i - bpp] : 0;
+                    const int p = a + b - c;
+                    const int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+                    row[i] += (unsigned char)((pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c));
+                }
+                break;
+            default:
+                printf("Bad PNG filter type %d\n", filter);
+                return false;
+        }
+        memcpy(prior.data(), row, row_size);
+
+        /* Convert the row to RGBA8 */
+        if (image.bit_depth == 8 && image.color_type == 6) {
+            memcpy(dataPtr, row, row_size);
+        } else if (image.bit_depth == 8 && image.color_type == 2) {
+            expand_rgb_to_rgba(row, dataPtr, image.width);
+        } else {
+            const int max_value = (1 << image.bit_depth) - 1;
+            unsigned char *rowPtr = dataPtr;
+            for (int x = 0; x < image.width; x++) {
+                unsigned char samples[4];
+                for (int c = 0; c < channels; c++) {
+                    const size_t bit = ((size_t)x * channels + c) * image.bit_depth;
+                    /* 16 bit values keep their high byte, palette indices are not scaled */
+                    int value = row[bit / 8];
+                    if (image.bit_depth < 8) {
+                        value = (value >> (8 - image.bit_depth - bit % 8)) & max_value;
+                        if (image.color_type != 3) value = value * 255 / max_value;
+                    }
+                    samples[c] = (unsigned char)value;
+                }
+
+                switch (image.color_type) {
+                    case 0:
+                        rowPtr[0] = rowPtr[1] = rowPtr[2] = samples[0];
+                        rowPtr[3] = 255;
+                        break;
+                    case 2:
+                        rowPtr[0] = samples[0];
+                        rowPtr[1] = samples[1];
+                        rowPtr[2] = samples[2];
+                        rowPtr[3] = 255;
+                        break;
+                    case 3:
+                        memcpy(rowPtr, palette[samples[0]], 4);
+                        break;
+                    case 4:
+                        rowPtr[0] = rowPtr[1] = rowPtr[2] = samples[0];
+                        rowPtr[3] = samples[1];
+                        break;
+                    case 6:
+                        memcpy(rowPtr, samples, 4);
+                        break;
+                }
+                rowPtr += 4;
+            }
+        }
+
+        dataPtr += rowPitch;
+    }
+
+    return true;
+}
+
+/*
+ * KTX format expected from https://www.khronos.org/ktx/, 2D textures with
+ * mip levels, without arrays or cube faces.  KTX2 files may not be
+ * supercompressed, and KTX files name their formats by GL internal format.
+ */
+static const unsigned char ktx_identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+static const unsigned char ktx2_identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+static uint32_t read_le32(const unsigned char *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+static uint64_t read_le64(const unsigned char *p) { return read_le32(p) | ((uint64_t)read_le32(p + 4) << 32); }
+
+static VkFormat ktx_gl_format(uint32_t internal_format) {
+    static const struct {
+        uint32_t gl;
+        VkFormat vk;
+    } formats[] = {
+        {0x8058, VK_FORMAT_R8G8B8A8_UNORM},                /* GL_RGBA8 */
+        {0x8C43, VK_FORMAT_R8G8B8A8_SRGB},                 /* GL_SRGB8_ALPHA8 */
+        {0x83F0, VK_FORMAT_BC1_RGB_UNORM_BLOCK},           /* GL_COMPRESSED_RGB_S3TC_DXT1_EXT */
+        {0x83F1, VK_FORMAT_BC1_RGBA_UNORM_BLOCK},          /* GL_COMPRESSED_RGBA_S3TC_DXT1_EXT */
+        {0x83F2, VK_FORMAT_BC2_UNORM_BLOCK},               /* GL_COMPRESSED_RGBA_S3TC_DXT3_EXT */
+        {0x83F3, VK_FORMAT_BC3_UNORM_BLOCK},               /* GL_COMPRESSED_RGBA_S3TC_DXT5_EXT */
+        {0x8C4C, VK_FORMAT_BC1_RGB_SRGB_BLOCK},            /* GL_COMPRESSED_SRGB_S3TC_DXT1_EXT */
+        {0x8C4D, VK_FORMAT_BC1_RGBA_SRGB_BLOCK},           /* GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT */
+        {0x8C4E, VK_FORMAT_BC2_SRGB_BLOCK},                /* GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT */
+        {0x8C4F, VK_FORMAT_BC3_SRGB_BLOCK},                /* GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT */
+        {0x8DBB, VK_FORMAT_BC4_UNORM_BLOCK},               /* GL_COMPRESSED_RED_RGTC1 */
+        {0x8DBC, VK_FORMAT_BC4_SNORM_BLOCK},               /* GL_COMPRESSED_SIGNED_RED_RGTC1 */
+        {0x8DBD, VK_FORMAT_BC5_UNORM_BLOCK},               /* GL_COMPRESSED_RG_RGTC2 */
+        {0x8DBE, VK_FORMAT_BC5_SNORM_BLOCK},               /* GL_COMPRESSED_SIGNED_RG_RGTC2 */
+        {0x8E8C, VK_FORMAT_BC7_UNORM_BLOCK},               /* GL_COMPRESSED_RGBA_BPTC_UNORM */
+        {0x8E8D, VK_FORMAT_BC7_SRGB_BLOCK},                /* GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM */
+        {0x8E8E, VK_FORMAT_BC6H_SFLOAT_BLOCK},             /* GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT */
+        {0x8E8F, VK_FORMAT_BC6H_UFLOAT_BLOCK},             /* GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT */
+        {0x8D64, VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK},       /* GL_ETC1_RGB8_OES */
+        {0x9274, VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK},       /* GL_COMPRESSED_RGB8_ETC2 */
+        {0x9275, VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK},        /* GL_COMPRESSED_SRGB8_ETC2 */
+        {0x9276, VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK},     /* GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2 */
+        {0x9277, VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK},      /* GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2 */
+        {0x9278, VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK},     /* GL_COMPRESSED_RGBA8_ETC2_EAC */
+        {0x9279, VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK},      /* GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC */
+        {0x9270, VK_FORMAT_EAC_R11_UNORM_BLOCK},           /* GL_COMPRESSED_R11_EAC */
+        {0x9271, VK_FORMAT_EAC_R11_SNORM_BLOCK},           /* GL_COMPRESSED_SIGNED_R11_EAC */
+        {0x9272, VK_FORMAT_EAC_R11G11_UNORM_BLOCK},        /* GL_COMPRESSED_RG11_EAC */
+        {0x9273, VK_FORMAT_EAC_R11G11_SNORM_BLOCK},        /* GL_COMPRESSED_SIGNED_RG11_EAC */
+    };
+
+    for (const auto &format : formats)
+        if (format.gl == internal_format) return format.vk;
+
+    /* GL_COMPRESSED_RGBA_ASTC_4x4_KHR and GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR onwards, in Vulkan's order */
+    if (internal_format >= 0x93B0 && internal_format <= 0x93BD)
+        return (VkFormat)(VK_FORMAT_ASTC_4x4_UNORM_BLOCK + 2 * (internal_format - 0x93B0));
+    if (internal_format >= 0x93D0 && internal_format <= 0x93DD)
+        return (VkFormat)(VK_FORMAT_ASTC_4x4_SRGB_BLOCK + 2 * (internal_format - 0x93D0));
+
+    return VK_FORMAT_UNDEFINED;
+}
+
+/* Check a level against the size of its blocks and add it */
+static bool add_ktx_level(image_file &image, size_t offset, uint64_t size) {
+    const uint32_t level = (uint32_t)image.levels.size();
+    const uint32_t width = std::max(image.width >> level, 1);
+    const uint32_t height = std::max(image.height >> level, 1);
+
+    uint32_t block_width, block_height, block_size;
+    get_format_block(image.vk_format, block_width, block_height, block_size);
+    const uint64_t expected =
+        (uint64_t)((width + block_width - 1) / block_width) * ((height + block_height - 1) / block_height) * block_size;
+
+    if (size != expected || offset > image.size || size > image.size - offset) {
+        printf("Bad KTX level %u\n", level);
+        return false;
+    }
+
+    image_level l;
+    l.offset = offset;
+    l.size = (size_t)size;
+    l.width = width;
+    l.height = height;
+    image.levels.push_back(l);
+
+    return true;
+}
+
+static bool open_ktx(image_file &image) {
+    const unsigned char *header = image.contents;
+    if (image.size < 64) {
+        printf("Bad KTX header\n");
+        return false;
+    }
+
+    /* Files written on big-endian machines have their header words swapped */
+    const bool swap = read_le32(header + 12) == 0x01020304;
+    if (!swap && read_le32(header + 12) != 0x04030201) {
+        printf("Bad KTX endianness\n");
+        return false;
+    }
+    auto word = [&](size_t offset) { return swap ? read_be32(image.contents + offset) : read_le32(image.contents + offset); };
+
+    image.format = IMAGE_FORMAT_KTX;
+    image.vk_format = ktx_gl_format(word(28));
+    image.width = (int)std::min<uint32_t>(word(36), 1u << 30);
+    image.height = (int)std::min<uint32_t>(word(40), 1u << 30);
+
+    if (image.vk_format == VK_FORMAT_UNDEFINED) {
+        printf("Unhandled KTX internal format 0x%x\n", word(28));
+        return false;
+    }
+    if (swap && word(20) != 1) {
+        printf("Byte swapped KTX files are not supported\n");
+        return false;
+    }
+    if (word(44) > 1 || word(48) != 0 || word(52) != 1) {
+        printf("Only 2D KTX textures are supported\n");
+        return false;
+    }
+
+    const uint32_t level_count = std::max(word(56), 1u);
+    size_t offset = 64 + (size_t)word(60);
+    for (uint32_t level = 0; level < level_count && level < 32; level++) {
+        if (offset > image.size - 4) {
+            printf("Bad KTX level %u\n", level);
+            return false;
+        }
+        const uint32_t size = word(offset);
+        if (!add_ktx_level(image, offset + 4, size)) return false;
+
+        /* Levels are padded to 4 bytes */
+        offset += 4 + (((size_t)size + 3) & ~(size_t)3);
+    }
+
+    return true;
+}
+
+static bool open_ktx2(image_file &image) {
+    const unsigned char *header = image.contents;
+    if (image.size < 80) {
+        printf("Bad KTX2 header\n");
+        return false;
+    }
+
+    image.format = IMAGE_FORMAT_KTX;
+    image.vk_format = (VkFormat)read_le32(header + 12);
+    image.width = (int)std::min<uint32_t>(read_le32(header + 20), 1u << 30);
+    image.height = (int)std::min<uint32_t>(read_le32(header + 24), 1u << 30);
+
+    uint32_t block_width, block_height, block_size;
+    if (!get_format_block(image.vk_format, block_width, block_height, block_size)) {
+        printf("Unhandled KTX2 format %u\n", read_le32(header + 12));
+        return false;
+    }
+    if (read_le32(header + 28) > 1 || read_le32(header + 32) > 1 || read_le32(header + 36) != 1) {
+        printf("Only 2D KTX2 textures are supported\n");
+        return false;
+    }
+    if (read_le32(header + 44) != 0) {
+        printf("Supercompressed KTX2 files are not supported\n");
+        return false;
+    }
+
+    const uint32_t level_count = std::max(read_le32(header + 40), 1u);
+    if (level_count > 32 || image.size < 80 + 24 * (size_t)level_count) {
+        printf("Bad KTX2 level index\n");
+        return false;
+    }
+    for (uint32_t level = 0; level < level_count; level++) {
+        const unsigned char *index = header + 80 + 24 * level;
+        const uint64_t offset = read_le64(index);
+        if (offset > image.size || !add_ktx_level(image, (size_t)offset, read_le64(index + 8))) return false;
+    }
+
+    return true;
+}
+
+bool open_image(char const *const filename, image_file &image) {
+    image = image_file();
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER size;
+        HANDLE mapping = NULL;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0) mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping) {
+            image.contents = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            image.size = (size_t)size.QuadPart;
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+    }
+    image.mapped = image.contents != NULL;
+#elif defined(__ANDROID__)
+    /* Assets are read into memory */
+    FILE *fPtr = AndroidFopen(filename, "rb");
+    if (fPtr) {
+        unsigned char chunk[64 * 1024];
+        size_t count;
+        while ((count = fread(chunk, 1, sizeof(chunk), fPtr)) > 0) image.buffer.insert(image.buffer.end(), chunk, chunk + count);
+        fclose(fPtr);
+    }
+    if (!image.buffer.empty()) {
+        image.contents = image.buffer.data();
+        image.size = image.buffer.size();
+    }
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+                image.contents = (const unsigned char *)map;
+                image.size = (size_t)st.st_size;
+                image.mapped = true;
+            }
+        }
+        close(fd);
+    }
+#endif
+
+    if (!image.contents) {
+        printf("Bad filename in open_image: %s\n", filename);
+        return false;
+    }
+
+    bool ok;
+    if (image.size >= 2 && image.contents[0] == 'P' && image.contents[1] == '6') {
+        ok = open_ppm(image);
+    } else if (image.size >= 8 && !memcmp(image.contents, "\x89PNG\r\n\x1a\n", 8)) {
+        ok = open_png(image);
+    } else if (image.size >= 12 && !memcmp(image.contents, ktx_identifier, 12)) {
+        ok = open_ktx(image);
+    } else if (image.size >= 12 && !memcmp(image.contents, ktx2_identifier, 12)) {
+        ok = open_ktx2(image);
+    } else {
+        printf("Unhandled image file format: %s\n", filename);
+        ok = false;
+    }
+
+    if (ok && (image.width <= 0 || image.width > saneDimension)) {
+        printf("Width seems wrong.  Update open_image if not: %d\n", image.width);
+        ok = false;
+    }
+    if (ok && (image.height <= 0 || image.height > saneDimension)) {
+        printf("Height seems wrong.  Update open_image if not: %d\n", image.height);
+        ok = false;
+    }
+
+    if (!ok) close_image(image);
+    return ok;
+}
+
+bool read_image(const image_file &image, uint64_t rowPitch, unsigned char *dataPtr) {
+    assert(image.contents);
+
+    if (image.format == IMAGE_FORMAT_PNG) return read_png_pixels(image, rowPitch, dataPtr);
+    if (image.format == IMAGE_FORMAT_KTX) return read_image_level(image, 0, rowPitch, dataPtr);
+
+    read_ppm_pixels(image, rowPitch, dataPtr);
+    return true;
+}
+
+bool read_image_level(const image_file &image, uint32_t level, uint64_t rowPitch, unsigned char *dataPtr) {
+    assert(image.contents);
+
+    if (image.format != IMAGE_FORMAT_KTX) return level == 0 && read_image(image, rowPitch, dataPtr);
+    if (level >= image.levels.size()) return false;
+
+    const image_level &l = image.levels[level];
+    return decode_texel_blocks(image.vk_format, l.width, l.height, image.contents + l.offset, rowPitch, dataPtr);
+}
+
+void close_image(image_file &image) {
+    if (image.mapped) {
+#if defined(_WIN32)
+        UnmapViewOfFile(image.contents);
+#elif !defined(__ANDROID__)
+        munmap((void *)image.contents, image.size);
+#endif
+    }
+
+    image = image_file();
+}
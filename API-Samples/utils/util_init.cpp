@@ -24,6 +24,7 @@ samples "init" utility functions
 */
 
 #include <cstdlib>
+#include <algorithm>
 #include <assert.h>
 #include <string.h>
 #include "util_init.hpp"
@@ -222,6 +223,15 @@ VkResult init_device(struct sample_info &info) {
     queue_info.pQueuePriorities = queue_priorities;
     queue_info.queueFamilyIndex = info.graphics_queue_family_index;
 
+    /* Enable whichever compressed texture formats the device has, so
+     * init_texture can sample KTX files without decoding them */
+    VkPhysicalDeviceFeatures supported_features;
+    vkGetPhysicalDeviceFeatures(info.gpus[0], &supported_features);
+    info.enabled_features = {};
+    info.enabled_features.textureCompressionETC2 = supported_features.textureCompressionETC2;
+    info.enabled_features.textureCompressionASTC_LDR = supported_features.textureCompressionASTC_LDR;
+    info.enabled_features.textureCompressionBC = supported_features.textureCompressionBC;
+
     VkDeviceCreateInfo device_info = {};
     device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     device_info.pNext = NULL;
@@ -229,7 +239,7 @@ VkResult init_device(struct sample_info &info) {
     device_info.pQueueCreateInfos = &queue_info;
     device_info.enabledExtensionCount = info.device_extension_names.size();
     device_info.ppEnabledExtensionNames = device_info.enabledExtensionCount ? info.device_extension_names.data() : NULL;
-    device_info.pEnabledFeatures = NULL;
+    device_info.pEnabledFeatures = &info.enabled_features;
 
     res = vkCreateDevice(info.gpus[0], &device_info, NULL, &info.device);
     assert(res == VK_SUCCESS);
@@ -640,12 +650,6 @@ void init_depth_buffer(struct sample_info &info) {
     image_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
     image_info.flags = 0;
 
-    VkMemoryAllocateInfo mem_alloc = {};
-    mem_alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    mem_alloc.pNext = NULL;
-    mem_alloc.allocationSize = 0;
-    mem_alloc.memoryTypeIndex = 0;
-
     VkImageViewCreateInfo view_info = {};
     view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     view_info.pNext = NULL;
@@ -676,18 +680,14 @@ void init_depth_buffer(struct sample_info &info) {
 
     vkGetImageMemoryRequirements(info.device, info.depth.image, &mem_reqs);
 
-    mem_alloc.allocationSize = mem_reqs.size;
-    /* Use the memory properties to determine the type of memory required */
-    pass =
-        memory_type_from_properties(info, mem_reqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &mem_alloc.memoryTypeIndex);
+    /* Allocate device local memory from the samples' memory pools */
+    pass = allocate_device_memory(info, mem_reqs, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                  image_info.tiling == VK_IMAGE_TILING_OPTIMAL, info.depth.alloc);
     assert(pass);
-
-    /* Allocate memory */
-    res = vkAllocateMemory(info.device, &mem_alloc, NULL, &info.depth.mem);
-    assert(res == VK_SUCCESS);
+    info.depth.mem = info.depth.alloc.memory;
 
     /* Bind memory */
-    res = vkBindImageMemory(info.device, info.depth.image, info.depth.mem, 0);
+    res = vkBindImageMemory(info.device, info.depth.image, info.depth.alloc.memory, info.depth.alloc.offset);
     assert(res == VK_SUCCESS);
 
     /* Create image view */
@@ -1080,29 +1080,15 @@ void init_uniform_buffer(struct sample_info &info) {
     VkMemoryRequirements mem_reqs;
     vkGetBufferMemoryRequirements(info.device, info.uniform_data.buf, &mem_reqs);
 
-    VkMemoryAllocateInfo alloc_info = {};
-    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    alloc_info.pNext = NULL;
-    alloc_info.memoryTypeIndex = 0;
-
-    alloc_info.allocationSize = mem_reqs.size;
-    pass = memory_type_from_properties(info, mem_reqs.memoryTypeBits,
-                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                       &alloc_info.memoryTypeIndex);
+    pass = allocate_device_memory(info, mem_reqs, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                  false, info.uniform_data.alloc);
     assert(pass && "No mappable, coherent memory");
+    info.uniform_data.mem = info.uniform_data.alloc.memory;
 
-    res = vkAllocateMemory(info.device, &alloc_info, NULL, &(info.uniform_data.mem));
-    assert(res == VK_SUCCESS);
+    /* Host visible pool memory stays mapped */
+    memcpy(info.uniform_data.alloc.mapped, &info.MVP, sizeof(info.MVP));
 
-    uint8_t *pData;
-    res = vkMapMemory(info.device, info.uniform_data.mem, 0, mem_reqs.size, 0, (void **)&pData);
-    assert(res == VK_SUCCESS);
-
-    memcpy(pData, &info.MVP, sizeof(info.MVP));
-
-    vkUnmapMemory(info.device, info.uniform_data.mem);
-
-    res = vkBindBufferMemory(info.device, info.uniform_data.buf, info.uniform_data.mem, 0);
+    res = vkBindBufferMemory(info.device, info.uniform_data.buf, info.uniform_data.alloc.memory, info.uniform_data.alloc.offset);
     assert(res == VK_SUCCESS);
 
     info.uniform_data.buffer_info.buffer = info.uniform_data.buf;
@@ -1312,12 +1298,7 @@ void execute_queue_command_buffer(struct sample_info &info) {
 
     /* Queue the command buffer for execution */
     const VkCommandBuffer cmd_bufs[] = {info.cmd};
-    VkFenceCreateInfo fenceInfo;
-    VkFence drawFence;
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.pNext = NULL;
-    fenceInfo.flags = 0;
-    vkCreateFence(info.device, &fenceInfo, NULL, &drawFence);
+    VkFence drawFence = acquire_fence(info);
 
     VkPipelineStageFlags pipe_stage_flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
     VkSubmitInfo submit_info[1] = {};
@@ -1339,7 +1320,7 @@ void execute_queue_command_buffer(struct sample_info &info) {
     } while (res == VK_TIMEOUT);
     assert(res == VK_SUCCESS);
 
-    vkDestroyFence(info.device, drawFence, NULL);
+    release_fence(info, drawFence);
 }
 
 void init_device_queue(struct sample_info &info) {
@@ -1373,31 +1354,17 @@ void init_vertex_buffer(struct sample_info &info, const void *vertexData, uint32
     VkMemoryRequirements mem_reqs;
     vkGetBufferMemoryRequirements(info.device, info.vertex_buffer.buf, &mem_reqs);
 
-    VkMemoryAllocateInfo alloc_info = {};
-    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    alloc_info.pNext = NULL;
-    alloc_info.memoryTypeIndex = 0;
-
-    alloc_info.allocationSize = mem_reqs.size;
-    pass = memory_type_from_properties(info, mem_reqs.memoryTypeBits,
-                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                       &alloc_info.memoryTypeIndex);
+    pass = allocate_device_memory(info, mem_reqs, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                  false, info.vertex_buffer.alloc);
     assert(pass && "No mappable, coherent memory");
-
-    res = vkAllocateMemory(info.device, &alloc_info, NULL, &(info.vertex_buffer.mem));
-    assert(res == VK_SUCCESS);
+    info.vertex_buffer.mem = info.vertex_buffer.alloc.memory;
     info.vertex_buffer.buffer_info.range = mem_reqs.size;
     info.vertex_buffer.buffer_info.offset = 0;
 
-    uint8_t *pData;
-    res = vkMapMemory(info.device, info.vertex_buffer.mem, 0, mem_reqs.size, 0, (void **)&pData);
-    assert(res == VK_SUCCESS);
-
-    memcpy(pData, vertexData, dataSize);
+    /* Host visible pool memory stays mapped */
+    memcpy(info.vertex_buffer.alloc.mapped, vertexData, dataSize);
 
-    vkUnmapMemory(info.device, info.vertex_buffer.mem);
-
-    res = vkBindBufferMemory(info.device, info.vertex_buffer.buf, info.vertex_buffer.mem, 0);
+    res = vkBindBufferMemory(info.device, info.vertex_buffer.buf, info.vertex_buffer.alloc.memory, info.vertex_buffer.alloc.offset);
     assert(res == VK_SUCCESS);
 
     info.vi_binding.binding = 0;
@@ -1681,8 +1648,10 @@ void init_sampler(struct sample_info &info, VkSampler &sampler) {
     VkSamplerCreateInfo samplerCreateInfo = {};
     samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
     samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
-    samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
-    samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    /* Textures only get mip chains worth filtering across with --mipmaps,
+     * init_image then also requires linear filtering of their formats */
+    samplerCreateInfo.minFilter = info.generate_mipmaps ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+    samplerCreateInfo.mipmapMode = info.generate_mipmaps ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
     samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
     samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
     samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
@@ -1691,7 +1660,7 @@ void init_sampler(struct sample_info &info, VkSampler &sampler) {
     samplerCreateInfo.maxAnisotropy = 1;
     samplerCreateInfo.compareOp = VK_COMPARE_OP_NEVER;
     samplerCreateInfo.minLod = 0.0;
-    samplerCreateInfo.maxLod = 0.0;
+    samplerCreateInfo.maxLod = info.generate_mipmaps ? VK_LOD_CLAMP_NONE : 0.0f;
     samplerCreateInfo.compareEnable = VK_FALSE;
     samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
 
@@ -1715,80 +1684,130 @@ void init_buffer(struct sample_info &info, texture_object &texObj) {
     res = vkCreateBuffer(info.device, &buffer_create_info, NULL, &texObj.buffer);
     assert(res == VK_SUCCESS);
 
-    VkMemoryAllocateInfo mem_alloc = {};
-    mem_alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    mem_alloc.pNext = NULL;
-    mem_alloc.allocationSize = 0;
-    mem_alloc.memoryTypeIndex = 0;
-
     VkMemoryRequirements mem_reqs;
     vkGetBufferMemoryRequirements(info.device, texObj.buffer, &mem_reqs);
-    mem_alloc.allocationSize = mem_reqs.size;
     texObj.buffer_size = mem_reqs.size;
 
+    /* allocate memory */
     VkFlags requirements = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    pass = memory_type_from_properties(info, mem_reqs.memoryTypeBits, requirements, &mem_alloc.memoryTypeIndex);
+    pass = allocate_device_memory(info, mem_reqs, requirements, false, texObj.buffer_alloc);
     assert(pass && "No mappable, coherent memory");
-
-    /* allocate memory */
-    res = vkAllocateMemory(info.device, &mem_alloc, NULL, &(texObj.buffer_memory));
-    assert(res == VK_SUCCESS);
+    texObj.buffer_memory = texObj.buffer_alloc.memory;
 
     /* bind memory */
-    res = vkBindBufferMemory(info.device, texObj.buffer, texObj.buffer_memory, 0);
+    res = vkBindBufferMemory(info.device, texObj.buffer, texObj.buffer_alloc.memory, texObj.buffer_alloc.offset);
     assert(res == VK_SUCCESS);
 }
 
+/* Compressed formats also need their feature enabled on the device */
+static bool compressed_format_enabled(const struct sample_info &info, VkFormat format) {
+    if (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK)
+        return info.enabled_features.textureCompressionBC;
+    if (format >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK && format <= VK_FORMAT_EAC_R11G11_SNORM_BLOCK)
+        return info.enabled_features.textureCompressionETC2;
+    if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK)
+        return info.enabled_features.textureCompressionASTC_LDR;
+    return true;
+}
+
 void init_image(struct sample_info &info, texture_object &texObj, const char *textureName, VkImageUsageFlags extraUsages,
                 VkFormatFeatureFlags extraFeatures) {
     VkResult U_ASSERT_ONLY res;
     bool U_ASSERT_ONLY pass;
     std::string filename = get_base_data_dir();
 
-    if (textureName == nullptr)
-        filename.append("lunarg.ppm");
-    else
-        filename.append(textureName);
+    if (textureName == nullptr) textureName = info.texture_name ? info.texture_name : "lunarg.ppm";
+    filename.append(textureName);
 
-    if (!read_ppm(filename.c_str(), texObj.tex_width, texObj.tex_height, 0, NULL)) {
+    /* The file stays open, and mapped, until its texels are written */
+    image_file image;
+    if (!open_image(filename.c_str(), image)) {
         std::cout << "Try relative path\n";
         filename = "../../API-Samples/data/";
-        if (textureName == nullptr)
-            filename.append("lunarg.ppm");
-        else
-            filename.append(textureName);
-        if (!read_ppm(filename.c_str(), texObj.tex_width, texObj.tex_height, 0, NULL)) {
+        filename.append(textureName);
+        if (!open_image(filename.c_str(), image)) {
             std::cout << "Could not read texture file " << filename;
             exit(-1);
         }
     }
+    texObj.tex_width = image.width;
+    texObj.tex_height = image.height;
+
+    /* KTX files bring their own format and mip levels, other files are
+     * decoded to RGBA8 */
+    VkFormat format = image.levels.empty() ? VK_FORMAT_R8G8B8A8_UNORM : image.vk_format;
+    const uint32_t mip_levels = image.levels.empty() ? 1 : (uint32_t)image.levels.size();
 
     VkFormatProperties formatProps;
-    vkGetPhysicalDeviceFormatProperties(info.gpus[0], VK_FORMAT_R8G8B8A8_UNORM, &formatProps);
+    vkGetPhysicalDeviceFormatProperties(info.gpus[0], format, &formatProps);
 
-    /* See if we can use a linear tiled image for a texture, if not, we will
-     * need a staging buffer for the texture data */
     VkFormatFeatureFlags allFeatures = (VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | extraFeatures);
-    texObj.needs_staging = ((formatProps.linearTilingFeatures & allFeatures) != allFeatures);
+    if (info.generate_mipmaps) allFeatures |= VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+    /* Decode compressed texels on the CPU when the device can't sample them */
+    bool decode = false;
+    if (!image.levels.empty() &&
+        (!compressed_format_enabled(info, format) || (formatProps.optimalTilingFeatures & allFeatures) != allFeatures)) {
+        const VkFormat decoded_format = get_decoded_format(format);
+        if (format == VK_FORMAT_BC6H_UFLOAT_BLOCK || format == VK_FORMAT_BC6H_SFLOAT_BLOCK) {
+            std::cout << "BC6H texture " << filename << " is not supported by the device, and HDR textures aren't decoded "
+                      << "on the CPU\n";
+            exit(-1);
+        }
+        if (decoded_format == VK_FORMAT_UNDEFINED || decoded_format == format) {
+            std::cout << "Texture format of " << filename << " is not supported\n";
+            exit(-1);
+        }
+        format = decoded_format;
+        decode = true;
+        vkGetPhysicalDeviceFormatProperties(info.gpus[0], format, &formatProps);
+    }
 
+    /* With --mipmaps, the levels below a single level image are filled in
+     * on the GPU, by blits or by a compute downsample */
+    mipmap_method mipmaps = MIPMAP_NONE;
+    uint32_t image_levels = mip_levels;
+    if (info.generate_mipmaps && mip_levels == 1) {
+        uint32_t block_width, block_height, block_size;
+        if (get_format_block(format, block_width, block_height, block_size) && block_width == 1)
+            mipmaps = get_mipmap_method(info, format);
+
+        if (mipmaps == MIPMAP_NONE)
+            std::cout << "Can't generate mipmaps for the format of " << filename << "\n";
+        else
+            image_levels = get_mip_level_count(texObj.tex_width, texObj.tex_height);
+
+        if (image_levels == 1) mipmaps = MIPMAP_NONE;
+    }
+
+    /* See if we can use a linear tiled image for a texture, if not, we will
+     * need a staging buffer for the texture data.  KTX levels, and images
+     * that get mipmaps, are always staged. */
+    texObj.needs_staging = !image.levels.empty() || mipmaps != MIPMAP_NONE ||
+                           ((formatProps.linearTilingFeatures & allFeatures) != allFeatures);
+
+    /* Staged uploads go through info.uploads, texObj keeps no buffer of its own */
+    texObj.buffer = VK_NULL_HANDLE;
+    texObj.buffer_memory = VK_NULL_HANDLE;
+    texObj.buffer_size = 0;
+    texObj.buffer_alloc = {};
+    texObj.upload_ticket = 0;
     if (texObj.needs_staging) {
         assert((formatProps.optimalTilingFeatures & allFeatures) == allFeatures);
-        init_buffer(info, texObj);
         extraUsages |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-    } else {
-        texObj.buffer = VK_NULL_HANDLE;
-        texObj.buffer_memory = VK_NULL_HANDLE;
     }
+    if (mipmaps == MIPMAP_BLIT) extraUsages |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    if (mipmaps == MIPMAP_COMPUTE) extraUsages |= VK_IMAGE_USAGE_STORAGE_BIT;
 
     VkImageCreateInfo image_create_info = {};
     image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     image_create_info.pNext = NULL;
     image_create_info.imageType = VK_IMAGE_TYPE_2D;
-    image_create_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+    image_create_info.format = format;
     image_create_info.extent.width = texObj.tex_width;
     image_create_info.extent.height = texObj.tex_height;
     image_create_info.extent.depth = 1;
-    image_create_info.mipLevels = 1;
+    image_create_info.mipLevels = image_levels;
     image_create_info.arrayLayers = 1;
     image_create_info.samples = NUM_SAMPLES;
     image_create_info.tiling = texObj.needs_staging ? VK_IMAGE_TILING_OPTIMAL : VK_IMAGE_TILING_LINEAR;
@@ -1799,12 +1818,6 @@ void init_image(struct sample_info &info, texture_object &texObj, const char *te
     image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     image_create_info.flags = 0;
 
-    VkMemoryAllocateInfo mem_alloc = {};
-    mem_alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    mem_alloc.pNext = NULL;
-    mem_alloc.allocationSize = 0;
-    mem_alloc.memoryTypeIndex = 0;
-
     VkMemoryRequirements mem_reqs;
 
     res = vkCreateImage(info.device, &image_create_info, NULL, &texObj.image);
@@ -1812,140 +1825,140 @@ void init_image(struct sample_info &info, texture_object &texObj, const char *te
 
     vkGetImageMemoryRequirements(info.device, texObj.image, &mem_reqs);
 
-    mem_alloc.allocationSize = mem_reqs.size;
-
+    /* allocate memory */
     VkFlags requirements = texObj.needs_staging ? 0 : (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    pass = memory_type_from_properties(info, mem_reqs.memoryTypeBits, requirements, &mem_alloc.memoryTypeIndex);
+    pass = allocate_device_memory(info, mem_reqs, requirements, texObj.needs_staging, texObj.image_alloc);
     assert(pass);
-
-    /* allocate memory */
-    res = vkAllocateMemory(info.device, &mem_alloc, NULL, &(texObj.image_memory));
-    assert(res == VK_SUCCESS);
+    texObj.image_memory = texObj.image_alloc.memory;
 
     /* bind memory */
-    res = vkBindImageMemory(info.device, texObj.image, texObj.image_memory, 0);
-    assert(res == VK_SUCCESS);
-
-    res = vkEndCommandBuffer(info.cmd);
+    res = vkBindImageMemory(info.device, texObj.image, texObj.image_alloc.memory, texObj.image_alloc.offset);
     assert(res == VK_SUCCESS);
-    const VkCommandBuffer cmd_bufs[] = {info.cmd};
-    VkFenceCreateInfo fenceInfo;
-    VkFence cmdFence;
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.pNext = NULL;
-    fenceInfo.flags = 0;
-    vkCreateFence(info.device, &fenceInfo, NULL, &cmdFence);
 
-    VkSubmitInfo submit_info[1] = {};
-    submit_info[0].pNext = NULL;
-    submit_info[0].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit_info[0].waitSemaphoreCount = 0;
-    submit_info[0].pWaitSemaphores = NULL;
-    submit_info[0].pWaitDstStageMask = NULL;
-    submit_info[0].commandBufferCount = 1;
-    submit_info[0].pCommandBuffers = cmd_bufs;
-    submit_info[0].signalSemaphoreCount = 0;
-    submit_info[0].pSignalSemaphores = NULL;
-
-    /* Queue the command buffer for execution */
-    res = vkQueueSubmit(info.graphics_queue, 1, submit_info, cmdFence);
-    assert(res == VK_SUCCESS);
-
-    VkImageSubresource subres = {};
-    subres.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    subres.mipLevel = 0;
-    subres.arrayLayer = 0;
-
-    VkSubresourceLayout layout = {};
-    void *data;
     if (!texObj.needs_staging) {
         /* Get the subresource layout so we know what the row pitch is */
-        vkGetImageSubresourceLayout(info.device, texObj.image, &subres, &layout);
-    }
+        VkImageSubresource subres = {};
+        subres.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        subres.mipLevel = 0;
+        subres.arrayLayer = 0;
 
-    /* Make sure command buffer is finished before mapping */
-    do {
-        res = vkWaitForFences(info.device, 1, &cmdFence, VK_TRUE, FENCE_TIMEOUT);
-    } while (res == VK_TIMEOUT);
-    assert(res == VK_SUCCESS);
+        VkSubresourceLayout layout = {};
+        vkGetImageSubresourceLayout(info.device, texObj.image, &subres, &layout);
 
-    vkDestroyFence(info.device, cmdFence, NULL);
+        /* Decode the image file into the mappable image's memory, which stays mapped */
+        if (!read_image(image, layout.rowPitch, (unsigned char *)texObj.image_alloc.mapped + layout.offset)) {
+            std::cout << "Could not load texture file " << filename << "\n";
+            exit(-1);
+        }
 
-    if (texObj.needs_staging) {
-        res = vkMapMemory(info.device, texObj.buffer_memory, 0, texObj.buffer_size, 0, &data);
+        /* If we can use the linear tiled image as a texture, just do it */
+        texObj.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        set_image_layout(info, texObj.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_PREINITIALIZED, texObj.imageLayout,
+                         VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
     } else {
-        res = vkMapMemory(info.device, texObj.image_memory, 0, mem_reqs.size, 0, &data);
-    }
-    assert(res == VK_SUCCESS);
+        /* Read every level into the upload ring, and record the copies in the
+         * upload command buffer instead of waiting for a submit of our own */
+        uint32_t block_width, block_height, block_size;
+        pass = get_format_block(format, block_width, block_height, block_size);
+        assert(pass);
+
+        VkDeviceSize alignment = std::max<VkDeviceSize>(4, info.gpu_props.limits.optimalBufferCopyOffsetAlignment);
+        alignment = std::max<VkDeviceSize>(alignment, block_size);
+
+        std::vector<VkBufferImageCopy> copy_regions(mip_levels);
+        VkDeviceSize upload_size = 0;
+        for (uint32_t level = 0; level < mip_levels; level++) {
+            const uint32_t width = std::max(texObj.tex_width >> level, 1);
+            const uint32_t height = std::max(texObj.tex_height >> level, 1);
+            const uint32_t row_blocks = (width + block_width - 1) / block_width;
+            const uint32_t column_blocks = (height + block_height - 1) / block_height;
+
+            upload_size = (upload_size + alignment - 1) / alignment * alignment;
+
+            VkBufferImageCopy &copy_region = copy_regions[level];
+            copy_region.bufferOffset = upload_size;
+            copy_region.bufferRowLength = row_blocks * block_width;
+            copy_region.bufferImageHeight = column_blocks * block_height;
+            copy_region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            copy_region.imageSubresource.mipLevel = level;
+            copy_region.imageSubresource.baseArrayLayer = 0;
+            copy_region.imageSubresource.layerCount = 1;
+            copy_region.imageOffset.x = 0;
+            copy_region.imageOffset.y = 0;
+            copy_region.imageOffset.z = 0;
+            copy_region.imageExtent.width = width;
+            copy_region.imageExtent.height = height;
+            copy_region.imageExtent.depth = 1;
+
+            upload_size += (VkDeviceSize)row_blocks * column_blocks * block_size;
+        }
 
-    /* Read the ppm file into the mappable image's memory */
-    if (!read_ppm(filename.c_str(), texObj.tex_width, texObj.tex_height,
-                  texObj.needs_staging ? (texObj.tex_width * 4) : layout.rowPitch, (unsigned char *)data)) {
-        std::cout << "Could not load texture file lunarg.ppm\n";
-        exit(-1);
-    }
+        upload_region region;
+        pass = begin_upload(info, upload_size, alignment, region);
+        assert(pass && "No mappable, coherent memory");
 
-    vkUnmapMemory(info.device, texObj.needs_staging ? texObj.buffer_memory : texObj.image_memory);
+        for (uint32_t level = 0; level < mip_levels; level++) {
+            VkBufferImageCopy &copy_region = copy_regions[level];
+            unsigned char *data = (unsigned char *)region.data + copy_region.bufferOffset;
 
-    VkCommandBufferBeginInfo cmd_buf_info = {};
-    cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    cmd_buf_info.pNext = NULL;
-    cmd_buf_info.flags = 0;
-    cmd_buf_info.pInheritanceInfo = NULL;
+            /* Compressed levels the device samples are copied as they are */
+            if (!image.levels.empty() && !decode) {
+                memcpy(data, image.contents + image.levels[level].offset, image.levels[level].size);
+            } else if (!read_image_level(image, level, copy_region.imageExtent.width * 4, data)) {
+                std::cout << "Could not load texture file " << filename << "\n";
+                exit(-1);
+            }
 
-    res = vkResetCommandBuffer(info.cmd, 0);
-    res = vkBeginCommandBuffer(info.cmd, &cmd_buf_info);
-    assert(res == VK_SUCCESS);
+            copy_region.bufferOffset += region.offset;
+        }
 
-    if (!texObj.needs_staging) {
-        /* If we can use the linear tiled image as a texture, just do it */
-        texObj.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        set_image_layout(info, texObj.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_PREINITIALIZED, texObj.imageLayout,
-                         VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
-    } else {
         /* Since we're going to blit to the texture image, set its layout to
          * DESTINATION_OPTIMAL */
-        set_image_layout(info, texObj.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+        set_image_layout(info, region.cmd, texObj.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
 
-        VkBufferImageCopy copy_region;
-        copy_region.bufferOffset = 0;
-        copy_region.bufferRowLength = texObj.tex_width;
-        copy_region.bufferImageHeight = texObj.tex_height;
-        copy_region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        copy_region.imageSubresource.mipLevel = 0;
-        copy_region.imageSubresource.baseArrayLayer = 0;
-        copy_region.imageSubresource.layerCount = 1;
-        copy_region.imageOffset.x = 0;
-        copy_region.imageOffset.y = 0;
-        copy_region.imageOffset.z = 0;
-        copy_region.imageExtent.width = texObj.tex_width;
-        copy_region.imageExtent.height = texObj.tex_height;
-        copy_region.imageExtent.depth = 1;
-
-        /* Put the copy command into the command buffer */
-        vkCmdCopyBufferToImage(info.cmd, texObj.buffer, texObj.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy_region);
+        /* Put the copy commands into the command buffer */
+        vkCmdCopyBufferToImage(region.cmd, region.buffer, texObj.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mip_levels,
+                               copy_regions.data());
 
         /* Set the layout for the texture image from DESTINATION_OPTIMAL to
-         * SHADER_READ_ONLY */
+         * SHADER_READ_ONLY, generating the other levels on the way */
         texObj.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        set_image_layout(info, texObj.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texObj.imageLayout,
-                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        mipmap_resources mipmap_objects;
+        if (mipmaps != MIPMAP_NONE) {
+            generate_mipmaps(info, region.cmd, texObj.image, format, texObj.tex_width, texObj.tex_height, image_levels, mipmaps,
+                             mipmap_objects);
+        } else {
+            set_image_layout(info, region.cmd, texObj.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                             texObj.imageLayout, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        }
+
+        /* Submit without waiting.  Samples submit their own command buffers
+         * right after, and the queue runs the upload first. */
+        texObj.upload_ticket = flush_uploads(info);
+
+        /* Except for the compute downsample, whose objects go once it's done */
+        if (mipmaps == MIPMAP_COMPUTE) {
+            wait_upload(info, texObj.upload_ticket);
+            destroy_mipmap_resources(info, mipmap_objects);
+        }
     }
 
+    close_image(image);
+
     VkImageViewCreateInfo view_info = {};
     view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     view_info.pNext = NULL;
     view_info.image = VK_NULL_HANDLE;
     view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    view_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+    view_info.format = format;
     view_info.components.r = VK_COMPONENT_SWIZZLE_R;
     view_info.components.g = VK_COMPONENT_SWIZZLE_G;
     view_info.components.b = VK_COMPONENT_SWIZZLE_B;
     view_info.components.a = VK_COMPONENT_SWIZZLE_A;
     view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     view_info.subresourceRange.baseMipLevel = 0;
-    view_info.subresourceRange.levelCount = 1;
+    view_info.subresourceRange.levelCount = image_levels;
     view_info.subresourceRange.baseArrayLayer = 0;
     view_info.subresourceRange.layerCount = 1;
 
@@ -2058,9 +2071,20 @@ void destroy_pipeline(struct sample_info &info) { vkDestroyPipeline(info.device,
 
 void destroy_pipeline_cache(struct sample_info &info) { vkDestroyPipelineCache(info.device, info.pipelineCache, NULL); }
 
+/*
+ * Memory from allocate_device_memory goes back to its pool.  Samples that
+ * allocate the memory of info's resources themselves still free it here.
+ */
+static void free_memory(struct sample_info &info, device_allocation &alloc, VkDeviceMemory mem) {
+    if (alloc.block)
+        free_device_memory(info, alloc);
+    else
+        vkFreeMemory(info.device, mem, NULL);
+}
+
 void destroy_uniform_buffer(struct sample_info &info) {
     vkDestroyBuffer(info.device, info.uniform_data.buf, NULL);
-    vkFreeMemory(info.device, info.uniform_data.mem, NULL);
+    free_memory(info, info.uniform_data.alloc, info.uniform_data.mem);
 }
 
 void destroy_descriptor_and_pipeline_layouts(struct sample_info &info) {
@@ -2085,12 +2109,12 @@ void destroy_command_pool(struct sample_info &info) { vkDestroyCommandPool(info.
 void destroy_depth_buffer(struct sample_info &info) {
     vkDestroyImageView(info.device, info.depth.view, NULL);
     vkDestroyImage(info.device, info.depth.image, NULL);
-    vkFreeMemory(info.device, info.depth.mem, NULL);
+    free_memory(info, info.depth.alloc, info.depth.mem);
 }
 
 void destroy_vertex_buffer(struct sample_info &info) {
     vkDestroyBuffer(info.device, info.vertex_buffer.buf, NULL);
-    vkFreeMemory(info.device, info.vertex_buffer.mem, NULL);
+    free_memory(info, info.vertex_buffer.alloc, info.vertex_buffer.mem);
 }
 
 void destroy_swap_chain(struct sample_info &info) {
@@ -2111,6 +2135,8 @@ void destroy_renderpass(struct sample_info &info) { vkDestroyRenderPass(info.dev
 
 void destroy_device(struct sample_info &info) {
     vkDeviceWaitIdle(info.device);
+    destroy_upload_manager(info);
+    free_all_device_memory(info);
     vkDestroyDevice(info.device, NULL);
 }
 
@@ -2121,8 +2147,8 @@ void destroy_textures(struct sample_info &info) {
         vkDestroySampler(info.device, info.textures[i].sampler, NULL);
         vkDestroyImageView(info.device, info.textures[i].view, NULL);
         vkDestroyImage(info.device, info.textures[i].image, NULL);
-        vkFreeMemory(info.device, info.textures[i].image_memory, NULL);
+        free_memory(info, info.textures[i].image_alloc, info.textures[i].image_memory);
         vkDestroyBuffer(info.device, info.textures[i].buffer, NULL);
-        vkFreeMemory(info.device, info.textures[i].buffer_memory, NULL);
+        free_memory(info, info.textures[i].buffer_alloc, info.textures[i].buffer_memory);
     }
 }
@@ -0,0 +1,200 @@
+/*
+ * Vulkan Samples
+ *
+ * Copyright (C) 2015-2016 Valve Corporation
+ * Copyright (C) 2015-2016 LunarG, Inc.
+ * Copyright (C) 2015-2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+VULKAN_SAMPLE_DESCRIPTION
+samples device memory sub-allocator
+*/
+
+#include <assert.h>
+#include <algorithm>
+#include "util.hpp"
+#include "util_buddy.hpp"
+
+/* Smallest range handed out, order 0 of every block */
+#define MIN_ALLOCATION_SIZE 256
+
+/* Preferred block size, reduced on small heaps */
+#define BLOCK_SIZE (16 * 1024 * 1024)
+
+struct device_memory_block {
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    void *mapped;
+
+    bool dedicated;
+    uint32_t allocation_count;
+
+    /* free ranges of the block, unused when dedicated */
+    buddy_allocator buddy;
+};
+
+static VkDeviceSize block_size_for_type(const struct sample_info &info, uint32_t type_index) {
+    const uint32_t heap_index = info.memory_properties.memoryTypes[type_index].heapIndex;
+    const VkDeviceSize heap_size = info.memory_properties.memoryHeaps[heap_index].size;
+
+    /* Use at most an eighth of the heap per block */
+    VkDeviceSize size = BLOCK_SIZE;
+    while (size > MIN_ALLOCATION_SIZE && size > heap_size / 8) size /= 2;
+    return size;
+}
+
+static device_memory_block *create_block(struct sample_info &info, uint32_t type_index, VkDeviceSize size, bool dedicated) {
+    VkMemoryAllocateInfo mem_alloc = {};
+    mem_alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    mem_alloc.pNext = NULL;
+    mem_alloc.allocationSize = size;
+    mem_alloc.memoryTypeIndex = type_index;
+
+    VkDeviceMemory memory;
+    VkResult res = vkAllocateMemory(info.device, &mem_alloc, NULL, &memory);
+    if (res != VK_SUCCESS) return NULL;
+
+    void *mapped = NULL;
+    if (info.memory_properties.memoryTypes[type_index].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        res = vkMapMemory(info.device, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+        if (res != VK_SUCCESS) {
+            vkFreeMemory(info.device, memory, NULL);
+            return NULL;
+        }
+    }
+
+    device_memory_block *block = new device_memory_block;
+    block->memory = memory;
+    block->size = size;
+    block->mapped = mapped;
+    block->dedicated = dedicated;
+    block->allocation_count = 0;
+    if (!dedicated) buddy_init(block->buddy, MIN_ALLOCATION_SIZE, size);
+
+    return block;
+}
+
+static void destroy_block(struct sample_info &info, device_memory_block *block) {
+    if (block->mapped) vkUnmapMemory(info.device, block->memory);
+    vkFreeMemory(info.device, block->memory, NULL);
+    delete block;
+}
+
+bool allocate_device_memory(struct sample_info &info, const VkMemoryRequirements &mem_reqs, VkFlags requirements_mask,
+                            bool optimal_image, device_allocation &alloc) {
+    device_memory_allocator &allocator = info.memory_allocator;
+
+    uint32_t type_index;
+    if (!memory_type_from_properties(info, mem_reqs.memoryTypeBits, requirements_mask, &type_index)) return false;
+
+    if (allocator.pools.empty()) allocator.pools.resize(2 * VK_MAX_MEMORY_TYPES);
+    std::vector<device_memory_block *> &pool = allocator.pools[2 * type_index + (optimal_image ? 1 : 0)];
+
+    const VkDeviceSize block_size = block_size_for_type(info, type_index);
+    const uint32_t order = buddy_order(MIN_ALLOCATION_SIZE, std::max(mem_reqs.size, mem_reqs.alignment));
+
+    device_memory_block *block = NULL;
+    VkDeviceSize offset = 0;
+
+    if (!allocator.dedicated && ((VkDeviceSize)MIN_ALLOCATION_SIZE << order) <= block_size / 2) {
+        for (auto b : pool) {
+            if (!b->dedicated && buddy_alloc(b->buddy, order, offset)) {
+                block = b;
+                break;
+            }
+        }
+
+        if (!block) {
+            block = create_block(info, type_index, block_size, false);
+            if (block) {
+                pool.push_back(block);
+                buddy_alloc(block->buddy, order, offset);
+            }
+        }
+    }
+
+    /* Too large for a block, or out of memory for a new one */
+    if (!block) {
+        block = create_block(info, type_index, mem_reqs.size, true);
+        if (!block) return false;
+        pool.push_back(block);
+        offset = 0;
+    }
+
+    block->allocation_count++;
+
+    alloc.memory = block->memory;
+    alloc.offset = offset;
+    alloc.size = mem_reqs.size;
+    alloc.mapped = block->mapped ? (char *)block->mapped + offset : NULL;
+    alloc.block = block;
+    alloc.order = order;
+
+    allocator.allocation_count++;
+    allocator.bytes_used += mem_reqs.size;
+    if (!block->dedicated) allocator.bytes_wasted += ((VkDeviceSize)MIN_ALLOCATION_SIZE << order) - mem_reqs.size;
+
+    return true;
+}
+
+void free_device_memory(struct sample_info &info, device_allocation &alloc) {
+    device_memory_allocator &allocator = info.memory_allocator;
+    device_memory_block *block = alloc.block;
+    if (!block) return;
+
+    allocator.allocation_count--;
+    allocator.bytes_used -= alloc.size;
+
+    block->allocation_count--;
+    if (block->dedicated) {
+        for (auto &pool : allocator.pools) pool.erase(std::remove(pool.begin(), pool.end(), block), pool.end());
+        destroy_block(info, block);
+    } else {
+        allocator.bytes_wasted -= ((VkDeviceSize)MIN_ALLOCATION_SIZE << alloc.order) - alloc.size;
+        buddy_free(block->buddy, alloc.order, alloc.offset);
+    }
+
+    alloc = {};
+}
+
+void free_all_device_memory(struct sample_info &info) {
+    device_memory_allocator &allocator = info.memory_allocator;
+
+    for (auto &pool : allocator.pools) {
+        for (auto block : pool) destroy_block(info, block);
+        pool.clear();
+    }
+
+    allocator.allocation_count = 0;
+    allocator.bytes_used = 0;
+    allocator.bytes_wasted = 0;
+}
+
+void get_device_memory_stats(const struct sample_info &info, device_memory_stats &stats) {
+    const device_memory_allocator &allocator = info.memory_allocator;
+
+    stats = {};
+    for (const auto &pool : allocator.pools) {
+        for (auto block : pool) {
+            stats.block_count++;
+            stats.bytes_allocated += block->size;
+        }
+    }
+
+    stats.allocation_count = allocator.allocation_count;
+    stats.bytes_used = allocator.bytes_used;
+    stats.bytes_wasted = allocator.bytes_wasted;
+}
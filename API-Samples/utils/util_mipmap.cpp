@@ -0,0 +1,282 @@
+/*
+ * Vulkan Samples
+ *
+ * Copyright (C) 2015-2016 Valve Corporation
+ * Copyright (C) 2015-2016 LunarG, Inc.
+ * Copyright (C) 2015-2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+VULKAN_SAMPLE_DESCRIPTION
+samples mipmap generation
+*/
+
+#include <assert.h>
+#include <algorithm>
+#include "util.hpp"
+
+#include "mipmap_downsample.comp.h"
+
+/* Workgroup size of mipmap_downsample.comp */
+#define DOWNSAMPLE_GROUP_SIZE 8
+
+static void set_mip_layout(VkCommandBuffer cmd, VkImage image, uint32_t base_level, uint32_t level_count,
+                           VkImageLayout old_image_layout, VkImageLayout new_image_layout, VkAccessFlags src_access,
+                           VkAccessFlags dst_access, VkPipelineStageFlags src_stages, VkPipelineStageFlags dest_stages) {
+    VkImageMemoryBarrier image_memory_barrier = {};
+    image_memory_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    image_memory_barrier.pNext = NULL;
+    image_memory_barrier.srcAccessMask = src_access;
+    image_memory_barrier.dstAccessMask = dst_access;
+    image_memory_barrier.oldLayout = old_image_layout;
+    image_memory_barrier.newLayout = new_image_layout;
+    image_memory_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_memory_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_memory_barrier.image = image;
+    image_memory_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    image_memory_barrier.subresourceRange.baseMipLevel = base_level;
+    image_memory_barrier.subresourceRange.levelCount = level_count;
+    image_memory_barrier.subresourceRange.baseArrayLayer = 0;
+    image_memory_barrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(cmd, src_stages, dest_stages, 0, 0, NULL, 0, NULL, 1, &image_memory_barrier);
+}
+
+uint32_t get_mip_level_count(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    while ((std::max(width, height) >> levels) > 0) levels++;
+    return levels;
+}
+
+mipmap_method get_mipmap_method(struct sample_info &info, VkFormat format) {
+    VkFormatProperties formatProps;
+    vkGetPhysicalDeviceFormatProperties(info.gpus[0], format, &formatProps);
+
+    const VkFormatFeatureFlags blit = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+    if ((formatProps.optimalTilingFeatures & blit) == blit) return MIPMAP_BLIT;
+
+    /* mipmap_downsample.comp reads and writes rgba8, and is recorded with
+     * the uploads for the graphics queue */
+    const bool compute_queue = (info.queue_props[info.graphics_queue_family_index].queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+    if (format == VK_FORMAT_R8G8B8A8_UNORM && compute_queue &&
+        (formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT))
+        return MIPMAP_COMPUTE;
+
+    return MIPMAP_NONE;
+}
+
+static void generate_mipmaps_blit(struct sample_info &info, VkCommandBuffer cmd, VkImage image, VkFormat format, uint32_t width,
+                                  uint32_t height, uint32_t levels) {
+    VkFormatProperties formatProps;
+    vkGetPhysicalDeviceFormatProperties(info.gpus[0], format, &formatProps);
+    const bool linear = (formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) != 0;
+    const VkFilter filter = linear ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+    for (uint32_t level = 1; level < levels; level++) {
+        /* The previous level becomes the source of this one, then is done */
+        set_mip_layout(cmd, image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        VkImageBlit region;
+        region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.srcSubresource.mipLevel = level - 1;
+        region.srcSubresource.baseArrayLayer = 0;
+        region.srcSubresource.layerCount = 1;
+        region.srcOffsets[0].x = 0;
+        region.srcOffsets[0].y = 0;
+        region.srcOffsets[0].z = 0;
+        region.srcOffsets[1].x = std::max(width >> (level - 1), 1u);
+        region.srcOffsets[1].y = std::max(height >> (level - 1), 1u);
+        region.srcOffsets[1].z = 1;
+        region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.dstSubresource.mipLevel = level;
+        region.dstSubresource.baseArrayLayer = 0;
+        region.dstSubresource.layerCount = 1;
+        region.dstOffsets[0].x = 0;
+        region.dstOffsets[0].y = 0;
+        region.dstOffsets[0].z = 0;
+        region.dstOffsets[1].x = std::max(width >> level, 1u);
+        region.dstOffsets[1].y = std::max(height >> level, 1u);
+        region.dstOffsets[1].z = 1;
+
+        vkCmdBlitImage(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region,
+                       filter);
+
+        set_mip_layout(cmd, image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                       VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    }
+
+    set_mip_layout(cmd, image, levels - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                   VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
+
+static void generate_mipmaps_compute(struct sample_info &info, VkCommandBuffer cmd, VkImage image, VkFormat format, uint32_t width,
+                                     uint32_t height, uint32_t levels, mipmap_resources &resources) {
+    VkResult U_ASSERT_ONLY res;
+
+    VkDescriptorSetLayoutBinding bindings[2] = {};
+    for (uint32_t i = 0; i < 2; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[i].pImmutableSamplers = NULL;
+    }
+
+    VkDescriptorSetLayoutCreateInfo descriptor_layout = {};
+    descriptor_layout.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptor_layout.pNext = NULL;
+    descriptor_layout.bindingCount = 2;
+    descriptor_layout.pBindings = bindings;
+    res = vkCreateDescriptorSetLayout(info.device, &descriptor_layout, NULL, &resources.desc_layout);
+    assert(res == VK_SUCCESS);
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info = {};
+    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_info.pNext = NULL;
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts = &resources.desc_layout;
+    res = vkCreatePipelineLayout(info.device, &pipeline_layout_info, NULL, &resources.pipeline_layout);
+    assert(res == VK_SUCCESS);
+
+    VkShaderModuleCreateInfo module_info = {};
+    module_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    module_info.pNext = NULL;
+    module_info.codeSize = sizeof(mipmap_downsample_comp);
+    module_info.pCode = mipmap_downsample_comp;
+    res = vkCreateShaderModule(info.device, &module_info, NULL, &resources.module);
+    assert(res == VK_SUCCESS);
+
+    VkComputePipelineCreateInfo pipeline_info = {};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.pNext = NULL;
+    pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = resources.module;
+    pipeline_info.stage.pName = "main";
+    pipeline_info.layout = resources.pipeline_layout;
+    res = vkCreateComputePipelines(info.device, VK_NULL_HANDLE, 1, &pipeline_info, NULL, &resources.pipeline);
+    assert(res == VK_SUCCESS);
+
+    VkDescriptorPoolSize type_count;
+    type_count.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    type_count.descriptorCount = 2 * (levels - 1);
+
+    VkDescriptorPoolCreateInfo descriptor_pool = {};
+    descriptor_pool.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptor_pool.pNext = NULL;
+    descriptor_pool.maxSets = levels - 1;
+    descriptor_pool.poolSizeCount = 1;
+    descriptor_pool.pPoolSizes = &type_count;
+    res = vkCreateDescriptorPool(info.device, &descriptor_pool, NULL, &resources.desc_pool);
+    assert(res == VK_SUCCESS);
+
+    /* A view of each level */
+    resources.views.resize(levels);
+    for (uint32_t level = 0; level < levels; level++) {
+        VkImageViewCreateInfo view_info = {};
+        view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_info.pNext = NULL;
+        view_info.image = image;
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format = format;
+        view_info.components.r = VK_COMPONENT_SWIZZLE_R;
+        view_info.components.g = VK_COMPONENT_SWIZZLE_G;
+        view_info.components.b = VK_COMPONENT_SWIZZLE_B;
+        view_info.components.a = VK_COMPONENT_SWIZZLE_A;
+        view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        view_info.subresourceRange.baseMipLevel = level;
+        view_info.subresourceRange.levelCount = 1;
+        view_info.subresourceRange.baseArrayLayer = 0;
+        view_info.subresourceRange.layerCount = 1;
+        res = vkCreateImageView(info.device, &view_info, NULL, &resources.views[level]);
+        assert(res == VK_SUCCESS);
+    }
+
+    /* Every level is read and written by the shader in GENERAL */
+    set_mip_layout(cmd, image, 0, levels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
+                   VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                   VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, resources.pipeline);
+
+    for (uint32_t level = 1; level < levels; level++) {
+        VkDescriptorSet desc_set;
+        VkDescriptorSetAllocateInfo alloc_info = {};
+        alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        alloc_info.pNext = NULL;
+        alloc_info.descriptorPool = resources.desc_pool;
+        alloc_info.descriptorSetCount = 1;
+        alloc_info.pSetLayouts = &resources.desc_layout;
+        res = vkAllocateDescriptorSets(info.device, &alloc_info, &desc_set);
+        assert(res == VK_SUCCESS);
+
+        VkDescriptorImageInfo image_info[2];
+        VkWriteDescriptorSet writes[2] = {};
+        for (uint32_t i = 0; i < 2; i++) {
+            image_info[i].sampler = VK_NULL_HANDLE;
+            image_info[i].imageView = resources.views[level - 1 + i];
+            image_info[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].pNext = NULL;
+            writes[i].dstSet = desc_set;
+            writes[i].dstBinding = i;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            writes[i].pImageInfo = &image_info[i];
+        }
+        vkUpdateDescriptorSets(info.device, 2, writes, 0, NULL);
+
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, resources.pipeline_layout, 0, 1, &desc_set, 0, NULL);
+
+        const uint32_t level_width = std::max(width >> level, 1u);
+        const uint32_t level_height = std::max(height >> level, 1u);
+        vkCmdDispatch(cmd, (level_width + DOWNSAMPLE_GROUP_SIZE - 1) / DOWNSAMPLE_GROUP_SIZE,
+                      (level_height + DOWNSAMPLE_GROUP_SIZE - 1) / DOWNSAMPLE_GROUP_SIZE, 1);
+
+        /* The next dispatch reads this level */
+        set_mip_layout(cmd, image, level, 1, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT,
+                       VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+
+    set_mip_layout(cmd, image, 0, levels, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                   VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
+
+void generate_mipmaps(struct sample_info &info, VkCommandBuffer cmd, VkImage image, VkFormat format, uint32_t width,
+                      uint32_t height, uint32_t levels, mipmap_method method, mipmap_resources &resources) {
+    resources = mipmap_resources();
+
+    if (method == MIPMAP_BLIT)
+        generate_mipmaps_blit(info, cmd, image, format, width, height, levels);
+    else
+        generate_mipmaps_compute(info, cmd, image, format, width, height, levels, resources);
+}
+
+void destroy_mipmap_resources(struct sample_info &info, mipmap_resources &resources) {
+    for (auto view : resources.views) vkDestroyImageView(info.device, view, NULL);
+    if (resources.desc_pool != VK_NULL_HANDLE) vkDestroyDescriptorPool(info.device, resources.desc_pool, NULL);
+    if (resources.pipeline != VK_NULL_HANDLE) vkDestroyPipeline(info.device, resources.pipeline, NULL);
+    if (resources.module != VK_NULL_HANDLE) vkDestroyShaderModule(info.device, resources.module, NULL);
+    if (resources.pipeline_layout != VK_NULL_HANDLE) vkDestroyPipelineLayout(info.device, resources.pipeline_layout, NULL);
+    if (resources.desc_layout != VK_NULL_HANDLE) vkDestroyDescriptorSetLayout(info.device, resources.desc_layout, NULL);
+
+    resources = mipmap_resources();
+}
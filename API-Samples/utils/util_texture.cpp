@@ -0,0 +1,1150 @@
+/*
+ * Vulkan Samples
+ *
+ * Copyright (C) 2015-2016 Valve Corporation
+ * Copyright (C) 2015-2016 LunarG, Inc.
+ * Copyright (C) 2015-2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+VULKAN_SAMPLE_DESCRIPTION
+samples compressed texture formats
+*/
+
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include "util.hpp"
+
+/* Texels of a decoded block, row-major, RGBA8, 4x4 but for ASTC */
+typedef unsigned char texel_block[12 * 12][4];
+
+static int clamp_int(int value, int low, int high) { return std::min(std::max(value, low), high); }
+
+static uint64_t read_be64(const unsigned char *p) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) value = (value << 8) | p[i];
+    return value;
+}
+
+/* Rounded division for both signs */
+static int divide_round(int numerator, int denominator) {
+    return numerator >= 0 ? (numerator + denominator / 2) / denominator : -((-numerator + denominator / 2) / denominator);
+}
+
+static void expand_565(uint16_t color, int rgb[3]) {
+    const int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+/*
+ * BC1 color block.  BC2 and BC3 always use four colors, BC1 falls back to
+ * three colors and black, transparent for the RGBA formats, when color0 is
+ * not greater than color1.
+ */
+static void decode_bc1(const unsigned char *src, texel_block texels, bool four_colors, bool transparent_black) {
+    const uint16_t c0 = src[0] | (src[1] << 8);
+    const uint16_t c1 = src[2] | (src[3] << 8);
+
+    int colors[4][4];
+    expand_565(c0, colors[0]);
+    expand_565(c1, colors[1]);
+    for (int i = 0; i < 4; i++) colors[i][3] = 255;
+
+    for (int c = 0; c < 3; c++) {
+        if (four_colors || c0 > c1) {
+            colors[2][c] = (2 * colors[0][c] + colors[1][c] + 1) / 3;
+            colors[3][c] = (colors[0][c] + 2 * colors[1][c] + 1) / 3;
+        } else {
+            colors[2][c] = (colors[0][c] + colors[1][c] + 1) / 2;
+            colors[3][c] = 0;
+        }
+    }
+    if (!four_colors && c0 <= c1 && transparent_black) colors[3][3] = 0;
+
+    const uint32_t indices = src[4] | (src[5] << 8) | (src[6] << 16) | ((uint32_t)src[7] << 24);
+    for (int i = 0; i < 16; i++) {
+        const int *color = colors[(indices >> (2 * i)) & 3];
+        for (int c = 0; c < 4; c++) texels[i][c] = (unsigned char)color[c];
+    }
+}
+
+/* BC2 explicit 4-bit alpha */
+static void decode_bc2_alpha(const unsigned char *src, texel_block texels) {
+    for (int i = 0; i < 16; i++) texels[i][3] = (unsigned char)(((src[i / 2] >> (4 * (i & 1))) & 15) * 17);
+}
+
+/* BC3 alpha, BC4 and the channels of BC5: two endpoints and 3-bit indices */
+static void decode_bc4(const unsigned char *src, texel_block texels, int channel, bool snorm) {
+    int values[8];
+    values[0] = snorm ? std::max((int)(signed char)src[0], -127) : src[0];
+    values[1] = snorm ? std::max((int)(signed char)src[1], -127) : src[1];
+
+    if (values[0] > values[1]) {
+        for (int i = 1; i < 7; i++) values[i + 1] = divide_round((7 - i) * values[0] + i * values[1], 7);
+    } else {
+        for (int i = 1; i < 5; i++) values[i + 1] = divide_round((5 - i) * values[0] + i * values[1], 5);
+        values[6] = snorm ? -127 : 0;
+        values[7] = snorm ? 127 : 255;
+    }
+
+    uint64_t indices = 0;
+    for (int i = 7; i >= 2; i--) indices = (indices << 8) | src[i];
+    for (int i = 0; i < 16; i++) texels[i][channel] = (unsigned char)values[(indices >> (3 * i)) & 7];
+}
+
+static const int etc1_modifiers[8][4] = {{2, 8, -2, -8},     {5, 17, -5, -17},   {9, 29, -9, -29},   {13, 42, -13, -42},
+                                         {18, 60, -18, -60}, {24, 80, -24, -80}, {33, 106, -33, -106}, {47, 183, -47, -183}};
+
+static const int etc2_distances[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+
+static int extend_bits(int value, int bits) { return (value << (8 - bits)) | (value >> (2 * bits - 8)); }
+
+/* The 2-bit index of texel x, y, stored column-major with the high bits first */
+static int etc_index(uint64_t block, int x, int y) {
+    const int i = x * 4 + y;
+    return (int)(((block >> (16 + i)) & 1) << 1 | ((block >> i) & 1));
+}
+
+/*
+ * ETC2 RGB block, ETC1 individual and differential modes plus the T, H and
+ * planar modes that overflowing differential colors select.  With punch
+ * through alpha the differential bit says whether the block is opaque, and
+ * index 2 of a non-opaque block is transparent black.
+ */
+static void decode_etc2_rgb(const unsigned char *src, texel_block texels, bool punchthrough) {
+    const uint64_t b = read_be64(src);
+    const bool differential = (b >> 33) & 1;
+    const bool opaque = !punchthrough || differential;
+
+    int paint[4][3];
+    bool use_paint = false;
+
+    if (!punchthrough && !differential) {
+        /* ETC1 individual mode */
+        int base[2][3];
+        for (int c = 0; c < 3; c++) {
+            base[0][c] = extend_bits((b >> (60 - 8 * c)) & 15, 4);
+            base[1][c] = extend_bits((b >> (56 - 8 * c)) & 15, 4);
+        }
+        const bool flip = (b >> 32) & 1;
+        for (int y = 0; y < 4; y++) {
+            for (int x = 0; x < 4; x++) {
+                const int sub = (flip ? y : x) >= 2;
+                const int modifier = etc1_modifiers[(b >> (sub ? 34 : 37)) & 7][etc_index(b, x, y)];
+                for (int c = 0; c < 3; c++) texels[y * 4 + x][c] = (unsigned char)clamp_int(base[sub][c] + modifier, 0, 255);
+                texels[y * 4 + x][3] = 255;
+            }
+        }
+        return;
+    }
+
+    int base5[3], delta[3];
+    for (int c = 0; c < 3; c++) {
+        base5[c] = (b >> (59 - 8 * c)) & 31;
+        delta[c] = (b >> (56 - 8 * c)) & 7;
+        if (delta[c] >= 4) delta[c] -= 8;
+    }
+
+    if (base5[0] + delta[0] < 0 || base5[0] + delta[0] > 31) {
+        /* T mode */
+        const int c0[3] = {extend_bits((int)(((b >> 59) & 3) << 2 | ((b >> 56) & 3)), 4), extend_bits((b >> 52) & 15, 4),
+                           extend_bits((b >> 48) & 15, 4)};
+        const int c1[3] = {extend_bits((b >> 44) & 15, 4), extend_bits((b >> 40) & 15, 4), extend_bits((b >> 36) & 15, 4)};
+        const int d = etc2_distances[((b >> 34) & 3) << 1 | ((b >> 32) & 1)];
+        for (int c = 0; c < 3; c++) {
+            paint[0][c] = c0[c];
+            paint[1][c] = clamp_int(c1[c] + d, 0, 255);
+            paint[2][c] = c1[c];
+            paint[3][c] = clamp_int(c1[c] - d, 0, 255);
+        }
+        use_paint = true;
+    } else if (base5[1] + delta[1] < 0 || base5[1] + delta[1] > 31) {
+        /* H mode */
+        const int c0[3] = {extend_bits((b >> 59) & 15, 4), extend_bits((int)(((b >> 56) & 7) << 1 | ((b >> 52) & 1)), 4),
+                           extend_bits((int)(((b >> 51) & 1) << 3 | ((b >> 48) & 3) << 1 | ((b >> 47) & 1)), 4)};
+        const int c1[3] = {extend_bits((b >> 43) & 15, 4), extend_bits((int)(((b >> 40) & 7) << 1 | ((b >> 39) & 1)), 4),
+                           extend_bits((b >> 35) & 15, 4)};
+        const int order = ((c0[0] << 16) | (c0[1] << 8) | c0[2]) >= ((c1[0] << 16) | (c1[1] << 8) | c1[2]);
+        const int d = etc2_distances[((b >> 34) & 1) << 2 | ((b >> 32) & 1) << 1 | order];
+        for (int c = 0; c < 3; c++) {
+            paint[0][c] = clamp_int(c0[c] + d, 0, 255);
+            paint[1][c] = clamp_int(c0[c] - d, 0, 255);
+            paint[2][c] = clamp_int(c1[c] + d, 0, 255);
+            paint[3][c] = clamp_int(c1[c] - d, 0, 255);
+        }
+        use_paint = true;
+    } else if (base5[2] + delta[2] < 0 || base5[2] + delta[2] > 31) {
+        /* Planar mode, always opaque */
+        const int o[3] = {extend_bits((b >> 57) & 63, 6), extend_bits((int)(((b >> 56) & 1) << 6 | ((b >> 49) & 63)), 7),
+                          extend_bits((int)(((b >> 48) & 1) << 5 | ((b >> 43) & 3) << 3 | ((b >> 39) & 7)), 6)};
+        const int h[3] = {extend_bits((int)(((b >> 34) & 31) << 1 | ((b >> 32) & 1)), 6), extend_bits((b >> 25) & 127, 7),
+                          extend_bits((b >> 19) & 63, 6)};
+        const int v[3] = {extend_bits((b >> 13) & 63, 6), extend_bits((b >> 6) & 127, 7), extend_bits(b & 63, 6)};
+        for (int y = 0; y < 4; y++) {
+            for (int x = 0; x < 4; x++) {
+                for (int c = 0; c < 3; c++) {
+                    const int value = (x * (h[c] - o[c]) + y * (v[c] - o[c]) + 4 * o[c] + 2) >> 2;
+                    texels[y * 4 + x][c] = (unsigned char)clamp_int(value, 0, 255);
+                }
+                texels[y * 4 + x][3] = 255;
+            }
+        }
+        return;
+    }
+
+    if (use_paint) {
+        for (int y = 0; y < 4; y++) {
+            for (int x = 0; x < 4; x++) {
+                const int index = etc_index(b, x, y);
+                unsigned char *texel = texels[y * 4 + x];
+                if (!opaque && index == 2) {
+                    texel[0] = texel[1] = texel[2] = texel[3] = 0;
+                    continue;
+                }
+                for (int c = 0; c < 3; c++) texel[c] = (unsigned char)paint[index][c];
+                texel[3] = 255;
+            }
+        }
+        return;
+    }
+
+    /* ETC1 differential mode */
+    int base[2][3];
+    for (int c = 0; c < 3; c++) {
+        base[0][c] = extend_bits(base5[c], 5);
+        base[1][c] = extend_bits(base5[c] + delta[c], 5);
+    }
+    const bool flip = (b >> 32) & 1;
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            const int sub = (flip ? y : x) >= 2;
+            const int index = etc_index(b, x, y);
+            unsigned char *texel = texels[y * 4 + x];
+            if (!opaque && index == 2) {
+                texel[0] = texel[1] = texel[2] = texel[3] = 0;
+                continue;
+            }
+            /* Non-opaque blocks have no small modifiers */
+            const int modifier = (!opaque && index == 0) ? 0 : etc1_modifiers[(b >> (sub ? 34 : 37)) & 7][index];
+            for (int c = 0; c < 3; c++) texel[c] = (unsigned char)clamp_int(base[sub][c] + modifier, 0, 255);
+            texel[3] = 255;
+        }
+    }
+}
+
+static const int eac_modifiers[16][8] = {
+    {-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12}, {-2, -5, -8, -13, 1, 4, 7, 12}, {-2, -4, -6, -13, 1, 3, 5, 12},
+    {-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10},  {-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10},
+    {-2, -6, -8, -10, 1, 5, 7, 9},  {-2, -5, -8, -10, 1, 4, 7, 9},   {-2, -4, -8, -10, 1, 3, 7, 9},  {-2, -5, -7, -10, 1, 4, 6, 9},
+    {-3, -4, -7, -10, 2, 3, 6, 9},  {-1, -2, -3, -10, 0, 1, 2, 9},   {-4, -6, -8, -9, 3, 5, 7, 8},   {-3, -5, -7, -9, 2, 4, 6, 8}};
+
+/*
+ * EAC block, the alpha of ETC2 RGBA8 or an 11-bit channel of the R11 and
+ * RG11 formats, reduced to 8 bits.
+ */
+static void decode_eac(const unsigned char *src, texel_block texels, int channel, bool eleven_bits, bool snorm) {
+    const uint64_t b = read_be64(src);
+    const int base = (int)(b >> 56);
+    const int multiplier = (b >> 52) & 15;
+    const int *modifiers = eac_modifiers[(b >> 48) & 15];
+
+    for (int x = 0; x < 4; x++) {
+        for (int y = 0; y < 4; y++) {
+            const int modifier = modifiers[(b >> (45 - 3 * (x * 4 + y))) & 7];
+            int value;
+            if (!eleven_bits) {
+                value = clamp_int(base + modifier * multiplier, 0, 255);
+            } else if (!snorm) {
+                const int scaled = multiplier ? modifier * multiplier * 8 : modifier;
+                value = (clamp_int(base * 8 + 4 + scaled, 0, 2047) * 255 + 1023) / 2047;
+            } else {
+                const int scaled = multiplier ? modifier * multiplier * 8 : modifier;
+                value = divide_round(clamp_int(std::max((int)(signed char)base, -127) * 8 + scaled, -1023, 1023) * 127, 1023);
+            }
+            texels[y * 4 + x][channel] = (unsigned char)value;
+        }
+    }
+}
+
+/* Bits of a 128-bit block, least significant first, as BC7 and ASTC store them */
+static uint32_t get_bits(const unsigned char *src, int first, int count) {
+    uint32_t value = 0;
+    for (int i = 0; i < count; i++) value |= (uint32_t)((src[(first + i) >> 3] >> ((first + i) & 7)) & 1) << i;
+    return value;
+}
+
+/*
+ * BC7 modes: subsets, partition, rotation and index selection bits, color
+ * and alpha bits, P-bits per endpoint or per subset, index bits.
+ */
+static const struct {
+    uint8_t subsets, partition_bits, rotation_bits, index_selection_bits;
+    uint8_t color_bits, alpha_bits, endpoint_pbits, shared_pbits, index_bits, index_bits2;
+} bc7_modes[8] = {{3, 4, 0, 0, 4, 0, 1, 0, 3, 0}, {2, 6, 0, 0, 6, 0, 0, 1, 3, 0}, {3, 6, 0, 0, 5, 0, 0, 0, 2, 0},
+                  {2, 6, 0, 0, 7, 0, 1, 0, 2, 0}, {1, 0, 2, 1, 5, 6, 0, 0, 2, 3}, {1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+                  {1, 0, 0, 0, 7, 7, 1, 0, 4, 0}, {2, 6, 0, 0, 5, 5, 1, 0, 2, 0}};
+
+/* Subset 1 texels of the two subset partitions */
+static const uint16_t bc7_partitions2[64] = {
+    0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+    0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+    0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+    0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22};
+
+/* Subsets of the three subset partitions, two bits per texel */
+static const uint32_t bc7_partitions3[64] = {
+    0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050, 0xAA550000, 0xAA555500,
+    0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250, 0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0,
+    0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500, 0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414,
+    0x50A4A450, 0x6A5A0200, 0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+    0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600, 0xAA444444, 0x54A854A8,
+    0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000, 0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000,
+    0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254};
+
+/* Anchor texels, whose indices drop their top bit, of subset 1 and 2 */
+static const uint8_t bc7_anchors2[64] = {15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 2,  8, 2,  2, 8,
+                                         8,  15, 2,  8,  2,  2,  8,  8,  2,  2,  15, 15, 6,  8,  2,  8,  15, 15, 2, 8,  2, 2,
+                                         2,  15, 15, 6,  6,  2,  6,  8,  15, 15, 2,  2,  15, 15, 15, 15, 15, 2,  2, 15};
+static const uint8_t bc7_anchors3_1[64] = {3, 3,  15, 15, 8, 3,  15, 15, 8, 8,  6,  6,  6, 5, 3,  3,  3,  3,  8,  15, 3, 3,
+                                           6, 10, 5,  8,  8, 6,  8,  5,  15, 15, 8, 15, 3, 5, 6,  10, 8,  15, 15, 3,  15, 5,
+                                           15, 15, 15, 15, 3, 15, 5,  5,  5,  8,  5, 10, 5, 10, 8, 13, 15, 12, 3,  3};
+static const uint8_t bc7_anchors3_2[64] = {15, 8,  8, 3,  15, 15, 3,  8,  15, 15, 15, 15, 15, 15, 15, 8,  15, 8, 15, 3, 15, 8,
+                                           15, 8,  3, 15, 6,  10, 15, 15, 10, 8,  15, 3,  15, 10, 10, 8,  9,  10, 6, 15, 8, 15,
+                                           3,  6,  6, 8,  15, 3,  15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3,  15, 15, 8};
+
+static const int bc7_weights2[4] = {0, 21, 43, 64};
+static const int bc7_weights3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+static const int bc7_weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+static const int *bc7_weights(int bits) { return bits == 2 ? bc7_weights2 : bits == 3 ? bc7_weights3 : bc7_weights4; }
+
+/*
+ * BC7 block.  The mode is the position of the lowest set bit, endpoints
+ * follow channel by channel and the indices texel by texel.  Blocks with
+ * no mode bit set decode to transparent black.
+ */
+static void decode_bc7(const unsigned char *src, texel_block texels) {
+    int mode = 0;
+    while (mode < 8 && !get_bits(src, mode, 1)) mode++;
+    if (mode == 8) {
+        memset(texels, 0, 16 * 4);
+        return;
+    }
+
+    const auto &m = bc7_modes[mode];
+    int pos = mode + 1;
+    const int partition = get_bits(src, pos, m.partition_bits);
+    pos += m.partition_bits;
+    const int rotation = get_bits(src, pos, m.rotation_bits);
+    pos += m.rotation_bits;
+    const int index_selection = get_bits(src, pos, m.index_selection_bits);
+    pos += m.index_selection_bits;
+
+    const int endpoint_count = m.subsets * 2;
+    int endpoints[6][4];
+    for (int c = 0; c < 4; c++) {
+        const int bits = c < 3 ? m.color_bits : m.alpha_bits;
+        for (int i = 0; i < endpoint_count; i++) {
+            endpoints[i][c] = get_bits(src, pos, bits);
+            pos += bits;
+        }
+    }
+
+    int pbits[6] = {};
+    if (m.endpoint_pbits) {
+        for (int i = 0; i < endpoint_count; i++) pbits[i] = get_bits(src, pos++, 1);
+    } else if (m.shared_pbits) {
+        for (int i = 0; i < m.subsets; i++) pbits[2 * i] = pbits[2 * i + 1] = get_bits(src, pos++, 1);
+    }
+
+    for (int i = 0; i < endpoint_count; i++) {
+        for (int c = 0; c < 4; c++) {
+            int bits = c < 3 ? m.color_bits : m.alpha_bits;
+            if (!bits) {
+                endpoints[i][c] = 255;
+                continue;
+            }
+            if (m.endpoint_pbits || m.shared_pbits) {
+                endpoints[i][c] = (endpoints[i][c] << 1) | pbits[i];
+                bits++;
+            }
+            endpoints[i][c] = (endpoints[i][c] << (8 - bits)) | (endpoints[i][c] >> (2 * bits - 8));
+        }
+    }
+
+    int subsets[16], indices[16], indices2[16];
+    for (int i = 0; i < 16; i++) {
+        if (m.subsets == 2)
+            subsets[i] = (bc7_partitions2[partition] >> i) & 1;
+        else if (m.subsets == 3)
+            subsets[i] = (bc7_partitions3[partition] >> (2 * i)) & 3;
+        else
+            subsets[i] = 0;
+    }
+    for (int i = 0; i < 16; i++) {
+        const bool anchor = i == 0 || (m.subsets == 2 && i == bc7_anchors2[partition]) ||
+                            (m.subsets == 3 && (i == bc7_anchors3_1[partition] || i == bc7_anchors3_2[partition]));
+        const int bits = m.index_bits - anchor;
+        indices[i] = get_bits(src, pos, bits);
+        pos += bits;
+    }
+    for (int i = 0; i < 16 && m.index_bits2; i++) {
+        const int bits = m.index_bits2 - (i == 0);
+        indices2[i] = get_bits(src, pos, bits);
+        pos += bits;
+    }
+
+    /* The index selection bit swaps which indices color and alpha use */
+    const int *color_weights = bc7_weights(m.index_bits2 && index_selection ? m.index_bits2 : m.index_bits);
+    const int *alpha_weights = bc7_weights(m.index_bits2 && !index_selection ? m.index_bits2 : m.index_bits);
+    for (int i = 0; i < 16; i++) {
+        const int *e0 = endpoints[2 * subsets[i]], *e1 = endpoints[2 * subsets[i] + 1];
+        const int color_index = m.index_bits2 && index_selection ? indices2[i] : indices[i];
+        const int alpha_index = m.index_bits2 && !index_selection ? indices2[i] : indices[i];
+        for (int c = 0; c < 4; c++) {
+            const int w = c < 3 ? color_weights[color_index] : alpha_weights[alpha_index];
+            texels[i][c] = (unsigned char)(((64 - w) * e0[c] + w * e1[c] + 32) >> 6);
+        }
+        if (rotation) std::swap(texels[i][rotation - 1], texels[i][3]);
+    }
+}
+
+/* ASTC integer sequence ranges, from 2 to 256 values: bits and a trit or quint */
+static const struct {
+    uint8_t bits, trits, quints;
+} astc_ranges[21] = {{1, 0, 0}, {0, 1, 0}, {2, 0, 0}, {0, 0, 1}, {1, 1, 0}, {3, 0, 0}, {1, 0, 1},
+                     {2, 1, 0}, {4, 0, 0}, {2, 0, 1}, {3, 1, 0}, {5, 0, 0}, {3, 0, 1}, {4, 1, 0},
+                     {6, 0, 0}, {4, 0, 1}, {5, 1, 0}, {7, 0, 0}, {5, 0, 1}, {6, 1, 0}, {8, 0, 0}};
+
+/* Color endpoint ranges start at 6 values */
+#define ASTC_MIN_COLOR_RANGE 4
+
+static int astc_sequence_bits(int count, int range) {
+    const auto &r = astc_ranges[range];
+    return count * r.bits + (r.trits ? (8 * count + 4) / 5 : 0) + (r.quints ? (7 * count + 2) / 3 : 0);
+}
+
+/*
+ * Decode count values of an integer sequence at bit first.  Trits come
+ * five to 8 bits and quints three to 7 bits, interleaved with the low bits
+ * of the values.
+ */
+static void astc_decode_sequence(const unsigned char *src, int first, int count, int range, int *values) {
+    const auto &r = astc_ranges[range];
+    const int end = first + astc_sequence_bits(count, range);
+    auto read = [&](int &pos, int bits) {
+        const int available = clamp_int(end - pos, 0, bits);
+        const uint32_t value = get_bits(src, pos, available);
+        pos += bits;
+        return (int)value;
+    };
+
+    int pos = first;
+    if (!r.trits && !r.quints) {
+        for (int i = 0; i < count; i++) values[i] = read(pos, r.bits);
+        return;
+    }
+
+    const int group = r.trits ? 5 : 3;
+    static const int trit_bits[5] = {2, 2, 1, 2, 1};
+    static const int quint_bits[3] = {3, 2, 2};
+    for (int i = 0; i < count; i += group) {
+        int low[5], packed = 0, shift = 0;
+        for (int j = 0; j < group; j++) {
+            low[j] = read(pos, r.bits);
+            const int bits = r.trits ? trit_bits[j] : quint_bits[j];
+            packed |= read(pos, bits) << shift;
+            shift += bits;
+        }
+
+        int high[5];
+        if (r.trits) {
+            int c;
+            if (((packed >> 2) & 7) == 7) {
+                c = ((packed >> 3) & 0x1C) | (packed & 3);
+                high[4] = high[3] = 2;
+            } else {
+                c = packed & 31;
+                if (((packed >> 5) & 3) == 3) {
+                    high[4] = 2;
+                    high[3] = (packed >> 7) & 1;
+                } else {
+                    high[4] = (packed >> 7) & 1;
+                    high[3] = (packed >> 5) & 3;
+                }
+            }
+            if ((c & 3) == 3) {
+                high[2] = 2;
+                high[1] = (c >> 4) & 1;
+                high[0] = (((c >> 3) & 1) << 1) | (((c >> 2) & 1) & ~((c >> 3) & 1));
+            } else if (((c >> 2) & 3) == 3) {
+                high[2] = high[1] = 2;
+                high[0] = c & 3;
+            } else {
+                high[2] = (c >> 4) & 1;
+                high[1] = (c >> 2) & 3;
+                high[0] = (((c >> 1) & 1) << 1) | ((c & 1) & ~((c >> 1) & 1));
+            }
+        } else {
+            if (((packed >> 1) & 3) == 3 && ((packed >> 5) & 3) == 0) {
+                const int q0 = packed & 1;
+                high[2] = (q0 << 2) | ((((packed >> 4) & 1) & ~q0) << 1) | (((packed >> 3) & 1) & ~q0);
+                high[1] = high[0] = 4;
+            } else {
+                int c;
+                if (((packed >> 1) & 3) == 3) {
+                    high[2] = 4;
+                    c = (((packed >> 3) & 3) << 3) | ((~packed >> 5) & 3) << 1 | (packed & 1);
+                } else {
+                    high[2] = (packed >> 5) & 3;
+                    c = packed & 31;
+                }
+                if ((c & 7) == 5) {
+                    high[1] = 4;
+                    high[0] = (c >> 3) & 3;
+                } else {
+                    high[1] = (c >> 3) & 3;
+                    high[0] = c & 7;
+                }
+            }
+        }
+
+        for (int j = 0; j < group && i + j < count; j++) values[i + j] = (high[j] << r.bits) | low[j];
+    }
+}
+
+/* Repeat the bits of value until it is to bits wide */
+static int replicate_bits(int value, int bits, int to) {
+    int result = 0;
+    for (int shift = to - bits; shift > -bits; shift -= bits) result |= shift >= 0 ? value << shift : value >> -shift;
+    return result;
+}
+
+/* Color endpoint values to 0..255 */
+static int astc_unquantize_color(int value, int range) {
+    const auto &r = astc_ranges[range];
+    if (!r.trits && !r.quints) return replicate_bits(value, r.bits, 8);
+
+    static const int trit_scales[7] = {0, 204, 93, 44, 22, 11, 5};
+    static const int quint_scales[6] = {0, 113, 54, 26, 13, 6};
+    const int low = value & ((1 << r.bits) - 1);
+    const int high = value >> r.bits;
+    const int a = (low & 1) ? 0x1FF : 0;
+    const int b = low >> 1;
+
+    /* The low bits spread over the 9-bit result */
+    int spread = 0;
+    if (r.trits) {
+        if (r.bits == 2) spread = b * 0x116;
+        if (r.bits == 3) spread = (b << 7) | (b << 2) | b;
+        if (r.bits == 4) spread = (b << 6) | b;
+        if (r.bits == 5) spread = (b << 5) | (b >> 2);
+        if (r.bits == 6) spread = (b << 4) | (b >> 4);
+    } else {
+        if (r.bits == 2) spread = b * 0x10C;
+        if (r.bits == 3) spread = (b << 7) | (b << 1) | (b >> 1);
+        if (r.bits == 4) spread = (b << 6) | (b >> 1);
+        if (r.bits == 5) spread = (b << 5) | (b >> 3);
+    }
+
+    const int t = (high * (r.trits ? trit_scales[r.bits] : quint_scales[r.bits]) + spread) ^ a;
+    return (a & 0x80) | (t >> 2);
+}
+
+/* Weights to 0..64 */
+static int astc_unquantize_weight(int value, int range) {
+    const auto &r = astc_ranges[range];
+    int result;
+    if (!r.trits && !r.quints) {
+        result = replicate_bits(value, r.bits, 6);
+    } else if (r.bits == 0) {
+        static const int trits[3] = {0, 32, 63};
+        static const int quints[5] = {0, 16, 32, 47, 63};
+        result = r.trits ? trits[value] : quints[value];
+    } else {
+        static const int trit_scales[4] = {0, 50, 23, 11};
+        static const int quint_scales[3] = {0, 28, 13};
+        const int low = value & ((1 << r.bits) - 1);
+        const int high = value >> r.bits;
+        const int a = (low & 1) ? 0x7F : 0;
+        const int b = low >> 1;
+
+        int spread = 0;
+        if (r.trits && r.bits == 2) spread = b * 0x45;
+        if (r.trits && r.bits == 3) spread = (b << 5) | b;
+        if (r.quints && r.bits == 2) spread = b * 0x42;
+
+        const int t = (high * (r.trits ? trit_scales[r.bits] : quint_scales[r.bits]) + spread) ^ a;
+        result = (a & 0x20) | (t >> 2);
+    }
+    return result > 32 ? result + 1 : result;
+}
+
+/* Weight grid and dual plane of a block mode, false when it's reserved */
+static bool astc_block_mode(int mode, int &grid_width, int &grid_height, bool &dual_plane, int &weight_range) {
+    int range = (mode >> 4) & 1;
+    bool high_precision = (mode >> 9) & 1;
+    dual_plane = (mode >> 10) & 1;
+    const int a = (mode >> 5) & 3;
+
+    if (mode & 3) {
+        range |= (mode & 3) << 1;
+        const int b = (mode >> 7) & 3;
+        switch ((mode >> 2) & 3) {
+            case 0:
+                grid_width = b + 4;
+                grid_height = a + 2;
+                break;
+            case 1:
+                grid_width = b + 8;
+                grid_height = a + 2;
+                break;
+            case 2:
+                grid_width = a + 2;
+                grid_height = b + 8;
+                break;
+            default:
+                if (mode & 0x100) {
+                    grid_width = (b & 1) + 2;
+                    grid_height = a + 2;
+                } else {
+                    grid_width = a + 2;
+                    grid_height = (b & 1) + 6;
+                }
+                break;
+        }
+    } else {
+        range |= ((mode >> 2) & 3) << 1;
+        if (((mode >> 2) & 3) == 0) return false;
+
+        const int b = (mode >> 9) & 3;
+        switch ((mode >> 7) & 3) {
+            case 0:
+                grid_width = 12;
+                grid_height = a + 2;
+                break;
+            case 1:
+                grid_width = a + 2;
+                grid_height = 12;
+                break;
+            case 2:
+                grid_width = a + 6;
+                grid_height = b + 6;
+                dual_plane = high_precision = false;
+                break;
+            default:
+                if (a > 1) return false;
+                grid_width = a ? 10 : 6;
+                grid_height = a ? 6 : 10;
+                break;
+        }
+    }
+
+    /* 2 to 8 values, or 10 to 32 with the precision bit */
+    weight_range = range - 2 + (high_precision ? 6 : 0);
+    return true;
+}
+
+/* The hash that spreads the texels of a block over its partitions */
+static int astc_select_partition(int seed, int x, int y, int partitions, bool small_block) {
+    if (small_block) {
+        x <<= 1;
+        y <<= 1;
+    }
+    seed += (partitions - 1) * 1024;
+
+    uint32_t rnum = seed;
+    rnum ^= rnum >> 15;
+    rnum -= rnum << 17;
+    rnum += rnum << 7;
+    rnum += rnum << 4;
+    rnum ^= rnum >> 5;
+    rnum += rnum << 16;
+    rnum ^= rnum >> 7;
+    rnum ^= rnum >> 3;
+    rnum ^= rnum << 6;
+    rnum ^= rnum >> 17;
+
+    int seeds[8];
+    for (int i = 0; i < 8; i++) {
+        seeds[i] = (rnum >> (4 * i)) & 15;
+        seeds[i] *= seeds[i];
+    }
+    const int sh1 = (seed & 1) ? ((seed & 2) ? 4 : 5) : (partitions == 3 ? 6 : 5);
+    const int sh2 = (seed & 1) ? (partitions == 3 ? 6 : 5) : ((seed & 2) ? 4 : 5);
+    for (int i = 0; i < 8; i++) seeds[i] >>= (i & 1) ? sh2 : sh1;
+
+    const int a = (seeds[0] * x + seeds[1] * y + (rnum >> 14)) & 0x3F;
+    const int b = (seeds[2] * x + seeds[3] * y + (rnum >> 10)) & 0x3F;
+    const int c = partitions < 3 ? 0 : (seeds[4] * x + seeds[5] * y + (rnum >> 6)) & 0x3F;
+    const int d = partitions < 4 ? 0 : (seeds[6] * x + seeds[7] * y + (rnum >> 2)) & 0x3F;
+
+    if (a >= b && a >= c && a >= d) return 0;
+    if (b >= c && b >= d) return 1;
+    if (c >= d) return 2;
+    return 3;
+}
+
+static void astc_blue_contract(int e[4]) {
+    e[0] = (e[0] + e[2]) >> 1;
+    e[1] = (e[1] + e[2]) >> 1;
+}
+
+/* Move the top bit of the offset a to the base b, leaving a signed 6-bit offset */
+static void astc_bit_transfer_signed(int &a, int &b) {
+    b = (b >> 1) | (a & 0x80);
+    a = (a >> 1) & 0x3F;
+    if (a & 0x20) a -= 0x40;
+}
+
+static void astc_set(int e[4], int r, int g, int b, int a) {
+    e[0] = r;
+    e[1] = g;
+    e[2] = b;
+    e[3] = a;
+}
+
+/* The endpoints of an LDR color endpoint mode, false for the HDR modes */
+static bool astc_decode_endpoints(int mode, int *v, int e0[4], int e1[4]) {
+    switch (mode) {
+        case 0:
+            astc_set(e0, v[0], v[0], v[0], 255);
+            astc_set(e1, v[1], v[1], v[1], 255);
+            return true;
+        case 1: {
+            const int l0 = (v[0] >> 2) | (v[1] & 0xC0);
+            const int l1 = std::min(l0 + (v[1] & 0x3F), 255);
+            astc_set(e0, l0, l0, l0, 255);
+            astc_set(e1, l1, l1, l1, 255);
+            return true;
+        }
+        case 4:
+            astc_set(e0, v[0], v[0], v[0], v[2]);
+            astc_set(e1, v[1], v[1], v[1], v[3]);
+            return true;
+        case 5:
+            astc_bit_transfer_signed(v[1], v[0]);
+            astc_bit_transfer_signed(v[3], v[2]);
+            astc_set(e0, v[0], v[0], v[0], v[2]);
+            astc_set(e1, v[0] + v[1], v[0] + v[1], v[0] + v[1], v[2] + v[3]);
+            break;
+        case 6:
+            astc_set(e0, (v[0] * v[3]) >> 8, (v[1] * v[3]) >> 8, (v[2] * v[3]) >> 8, 255);
+            astc_set(e1, v[0], v[1], v[2], 255);
+            return true;
+        case 10:
+            astc_set(e0, (v[0] * v[3]) >> 8, (v[1] * v[3]) >> 8, (v[2] * v[3]) >> 8, v[4]);
+            astc_set(e1, v[0], v[1], v[2], v[5]);
+            return true;
+        case 8:
+        case 12: {
+            const int a0 = mode == 12 ? v[6] : 255, a1 = mode == 12 ? v[7] : 255;
+            if (v[1] + v[3] + v[5] >= v[0] + v[2] + v[4]) {
+                astc_set(e0, v[0], v[2], v[4], a0);
+                astc_set(e1, v[1], v[3], v[5], a1);
+            } else {
+                astc_set(e0, v[1], v[3], v[5], a1);
+                astc_set(e1, v[0], v[2], v[4], a0);
+                astc_blue_contract(e0);
+                astc_blue_contract(e1);
+            }
+            return true;
+        }
+        case 9:
+        case 13: {
+            astc_bit_transfer_signed(v[1], v[0]);
+            astc_bit_transfer_signed(v[3], v[2]);
+            astc_bit_transfer_signed(v[5], v[4]);
+            if (mode == 13) astc_bit_transfer_signed(v[7], v[6]);
+            const int base[4] = {v[0], v[2], v[4], mode == 13 ? v[6] : 255};
+            const int offset[4] = {v[0] + v[1], v[2] + v[3], v[4] + v[5], mode == 13 ? v[6] + v[7] : 255};
+            if (v[1] + v[3] + v[5] >= 0) {
+                astc_set(e0, base[0], base[1], base[2], base[3]);
+                astc_set(e1, offset[0], offset[1], offset[2], offset[3]);
+            } else {
+                astc_set(e0, offset[0], offset[1], offset[2], offset[3]);
+                astc_set(e1, base[0], base[1], base[2], base[3]);
+                astc_blue_contract(e0);
+                astc_blue_contract(e1);
+            }
+            break;
+        }
+        default:
+            return false;
+    }
+
+    for (int c = 0; c < 4; c++) {
+        e0[c] = clamp_int(e0[c], 0, 255);
+        e1[c] = clamp_int(e1[c], 0, 255);
+    }
+    return true;
+}
+
+/*
+ * ASTC block of the LDR profile, of any 2D footprint.  Reserved and out of
+ * range blocks decode to the error color, magenta, as do the texels of
+ * partitions with HDR endpoints.  Texels keep the top 8 bits of the 16-bit
+ * results, like the 8-bit decode mode of the format.
+ */
+static void decode_astc(const unsigned char *src, int block_width, int block_height, bool srgb, texel_block texels) {
+    static const unsigned char error_color[4] = {255, 0, 255, 255};
+    const int texel_count = block_width * block_height;
+    auto error = [&]() {
+        for (int i = 0; i < texel_count; i++) memcpy(texels[i], error_color, 4);
+    };
+
+    const int block_mode = get_bits(src, 0, 11);
+    if ((block_mode & 0x1FF) == 0x1FC) {
+        /* Void extent, a constant color; HDR ones don't fit the LDR profile.
+         * Extents other than all ones must not be empty. */
+        const uint32_t s_low = get_bits(src, 12, 13), s_high = get_bits(src, 25, 13);
+        const uint32_t t_low = get_bits(src, 38, 13), t_high = get_bits(src, 51, 13);
+        const bool all_ones = (s_low & s_high & t_low & t_high) == 0x1FFF;
+        if ((block_mode & 0x200) || get_bits(src, 10, 2) != 3 || (!all_ones && (s_low >= s_high || t_low >= t_high)))
+            return error();
+        for (int i = 0; i < texel_count; i++)
+            for (int c = 0; c < 4; c++) texels[i][c] = (unsigned char)get_bits(src, 64 + 16 * c + 8, 8);
+        return;
+    }
+
+    int grid_width, grid_height, weight_range;
+    bool dual_plane;
+    if (!astc_block_mode(block_mode, grid_width, grid_height, dual_plane, weight_range)) return error();
+
+    const int planes = dual_plane ? 2 : 1;
+    const int weight_count = grid_width * grid_height * planes;
+    const int partitions = get_bits(src, 11, 2) + 1;
+    if (grid_width > block_width || grid_height > block_height || weight_count > 64 || (dual_plane && partitions == 4))
+        return error();
+    const int weight_bits = astc_sequence_bits(weight_count, weight_range);
+    if (weight_bits < 24 || weight_bits > 96) return error();
+
+    /* Color endpoint modes, which can spill below the weights */
+    int below_weights = 128 - weight_bits;
+    int modes[4];
+    int color_first;
+    if (partitions == 1) {
+        modes[0] = get_bits(src, 13, 4);
+        color_first = 17;
+    } else {
+        const int selector = get_bits(src, 23, 2);
+        color_first = 29;
+        if (selector == 0) {
+            for (int i = 0; i < partitions; i++) modes[i] = get_bits(src, 25, 4);
+        } else {
+            const int extra_bits = 3 * partitions - 4;
+            below_weights -= extra_bits;
+            const int encoded = get_bits(src, 25, 4) | (get_bits(src, below_weights, extra_bits) << 4);
+            for (int i = 0; i < partitions; i++) {
+                const int class_offset = (encoded >> i) & 1;
+                const int m = (encoded >> (partitions + 2 * i)) & 3;
+                modes[i] = ((selector - 1 + class_offset) << 2) | m;
+            }
+        }
+    }
+    int plane2_channel = -1;
+    if (dual_plane) {
+        below_weights -= 2;
+        plane2_channel = get_bits(src, below_weights, 2);
+    }
+
+    /* The color values take the largest range that fits their bits */
+    int color_count = 0;
+    for (int i = 0; i < partitions; i++) color_count += ((modes[i] >> 2) + 1) * 2;
+    if (color_count > 18) return error();
+    int color_range = 20;
+    while (color_range >= ASTC_MIN_COLOR_RANGE && astc_sequence_bits(color_count, color_range) > below_weights - color_first)
+        color_range--;
+    if (color_range < ASTC_MIN_COLOR_RANGE) return error();
+
+    int values[18];
+    astc_decode_sequence(src, color_first, color_count, color_range, values);
+    for (int i = 0; i < color_count; i++) values[i] = astc_unquantize_color(values[i], color_range);
+
+    int endpoints[4][2][4];
+    bool hdr[4];
+    for (int i = 0, first = 0; i < partitions; i++) {
+        hdr[i] = !astc_decode_endpoints(modes[i], values + first, endpoints[i][0], endpoints[i][1]);
+        first += ((modes[i] >> 2) + 1) * 2;
+    }
+
+    /* Weights are stored from the top bit down */
+    unsigned char reversed[16];
+    for (int i = 0; i < 16; i++) {
+        unsigned char byte = src[15 - i], bits = 0;
+        for (int j = 0; j < 8; j++) bits |= ((byte >> j) & 1) << (7 - j);
+        reversed[i] = bits;
+    }
+    int weights[64];
+    astc_decode_sequence(reversed, 0, weight_count, weight_range, weights);
+
+    /* Grid weights of each plane, padded for the infill to read past the edges */
+    int grid[2][64 + 16] = {};
+    for (int i = 0; i < weight_count; i++) grid[i % planes][i / planes] = astc_unquantize_weight(weights[i], weight_range);
+
+    const int ds = (1024 + block_width / 2) / (block_width - 1);
+    const int dt = (1024 + block_height / 2) / (block_height - 1);
+    const bool small_block = texel_count < 31;
+    const int seed = get_bits(src, 13, 10);
+
+    for (int t = 0; t < block_height; t++) {
+        for (int s = 0; s < block_width; s++) {
+            /* Bilinear infill of the weight grid */
+            const int gs = (ds * s * (grid_width - 1) + 32) >> 6;
+            const int gt = (dt * t * (grid_height - 1) + 32) >> 6;
+            const int fs = gs & 15, ft = gt & 15;
+            const int v0 = (gs >> 4) + (gt >> 4) * grid_width;
+            const int w11 = (fs * ft + 8) >> 4;
+            const int w10 = ft - w11, w01 = fs - w11, w00 = 16 - fs - ft + w11;
+            int plane_weights[2];
+            for (int p = 0; p < planes; p++) {
+                const int *g = grid[p];
+                plane_weights[p] =
+                    (g[v0] * w00 + g[v0 + 1] * w01 + g[v0 + grid_width] * w10 + g[v0 + grid_width + 1] * w11 + 8) >> 4;
+            }
+
+            const int partition = partitions > 1 ? astc_select_partition(seed, s, t, partitions, small_block) : 0;
+            const int i = t * block_width + s;
+            if (hdr[partition]) {
+                memcpy(texels[i], error_color, 4);
+                continue;
+            }
+            for (int c = 0; c < 4; c++) {
+                const int w = c == plane2_channel ? plane_weights[1] : plane_weights[0];
+                const int e0 = endpoints[partition][0][c], e1 = endpoints[partition][1][c];
+                const int c0 = srgb ? (e0 << 8) | 0x80 : e0 * 257;
+                const int c1 = srgb ? (e1 << 8) | 0x80 : e1 * 257;
+                texels[i][c] = (unsigned char)(((c0 * (64 - w) + c1 * w + 32) / 64) >> 8);
+            }
+        }
+    }
+}
+
+/* Fill the channels single and two channel formats leave out, 0 and 1 */
+static void fill_channels(texel_block texels, int first, bool snorm) {
+    for (int i = 0; i < 16; i++) {
+        for (int c = first; c < 3; c++) texels[i][c] = 0;
+        texels[i][3] = snorm ? 127 : 255;
+    }
+}
+
+static bool decode_block(VkFormat format, uint32_t block_width, uint32_t block_height, const unsigned char *src,
+                         texel_block texels) {
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            decode_bc1(src, texels, false, false);
+            return true;
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            decode_bc1(src, texels, false, true);
+            return true;
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+            decode_bc1(src + 8, texels, true, false);
+            decode_bc2_alpha(src, texels);
+            return true;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            decode_bc1(src + 8, texels, true, false);
+            decode_bc4(src, texels, 3, false);
+            return true;
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+            decode_bc4(src, texels, 0, format == VK_FORMAT_BC4_SNORM_BLOCK);
+            fill_channels(texels, 1, format == VK_FORMAT_BC4_SNORM_BLOCK);
+            return true;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+            decode_bc4(src, texels, 0, format == VK_FORMAT_BC5_SNORM_BLOCK);
+            decode_bc4(src + 8, texels, 1, format == VK_FORMAT_BC5_SNORM_BLOCK);
+            fill_channels(texels, 2, format == VK_FORMAT_BC5_SNORM_BLOCK);
+            return true;
+        case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+            decode_etc2_rgb(src, texels, false);
+            return true;
+        case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+            decode_etc2_rgb(src, texels, true);
+            return true;
+        case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+            decode_etc2_rgb(src + 8, texels, false);
+            decode_eac(src, texels, 3, false, false);
+            return true;
+        case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+        case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+            decode_eac(src, texels, 0, true, format == VK_FORMAT_EAC_R11_SNORM_BLOCK);
+            fill_channels(texels, 1, format == VK_FORMAT_EAC_R11_SNORM_BLOCK);
+            return true;
+        case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+        case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+            decode_eac(src, texels, 0, true, format == VK_FORMAT_EAC_R11G11_SNORM_BLOCK);
+            decode_eac(src + 8, texels, 1, true, format == VK_FORMAT_EAC_R11G11_SNORM_BLOCK);
+            fill_channels(texels, 2, format == VK_FORMAT_EAC_R11G11_SNORM_BLOCK);
+            return true;
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            decode_bc7(src, texels);
+            return true;
+        default:
+            break;
+    }
+
+    if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK) {
+        /* The UNORM and SRGB formats alternate */
+        decode_astc(src, block_width, block_height, (format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) & 1, texels);
+        return true;
+    }
+
+    return false;
+}
+
+bool get_format_block(VkFormat format, uint32_t &block_width, uint32_t &block_height, uint32_t &block_size) {
+    /* Footprints of the ASTC formats, UNORM and SRGB alternating from 4x4 */
+    static const uint8_t astc_footprints[14][2] = {{4, 4},  {5, 4},  {5, 5},  {6, 5},   {6, 6},   {8, 5},   {8, 6},
+                                                   {8, 8},  {10, 5}, {10, 6}, {10, 8},  {10, 10}, {12, 10}, {12, 12}};
+
+    block_width = 4;
+    block_height = 4;
+
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_R8G8B8A8_SNORM:
+            block_width = 1;
+            block_height = 1;
+            block_size = 4;
+            return true;
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+        case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+        case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+            block_size = 8;
+            return true;
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+        case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+        case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+        case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+        case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+            block_size = 16;
+            return true;
+        default:
+            break;
+    }
+
+    if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK) {
+        const uint8_t *footprint = astc_footprints[(format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) / 2];
+        block_width = footprint[0];
+        block_height = footprint[1];
+        block_size = 16;
+        return true;
+    }
+
+    return false;
+}
+
+VkFormat get_decoded_format(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+        case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+        case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return VK_FORMAT_R8G8B8A8_SRGB;
+        case VK_FORMAT_R8G8B8A8_SNORM:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+        case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+        case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+            return VK_FORMAT_R8G8B8A8_SNORM;
+        default:
+            break;
+    }
+
+    /* ASTC decodes for the LDR profile.  BC6H is HDR, which RGBA8 can't
+     * hold, so it has no decoded format. */
+    if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK)
+        return (format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) & 1 ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+
+    return VK_FORMAT_UNDEFINED;
+}
+
+bool decode_texel_blocks(VkFormat format, uint32_t width, uint32_t height, const unsigned char *blocks, uint64_t rowPitch,
+                         unsigned char *dataPtr) {
+    uint32_t block_width, block_height, block_size;
+    if (get_decoded_format(format) == VK_FORMAT_UNDEFINED || !get_format_block(format, block_width, block_height, block_size))
+        return false;
+
+    if (block_width == 1) {
+        for (uint32_t y = 0; y < height; y++) memcpy(dataPtr + rowPitch * y, blocks + (size_t)width * 4 * y, width * 4);
+        return true;
+    }
+
+    texel_block texels;
+    for (uint32_t y = 0; y < height; y += block_height) {
+        const uint32_t rows = std::min(height - y, block_height);
+        for (uint32_t x = 0; x < width; x += block_width) {
+            if (!decode_block(format, block_width, block_height, blocks, texels)) return false;
+            blocks += block_size;
+
+            /* Partial blocks at the right and bottom edges */
+            const uint32_t columns = std::min(width - x, block_width);
+            for (uint32_t row = 0; row < rows; row++)
+                memcpy(dataPtr + rowPitch * (y + row) + x * 4, texels[row * block_width], columns * 4);
+        }
+    }
+
+    return true;
+}
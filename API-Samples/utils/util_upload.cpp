@@ -0,0 +1,296 @@
+/*
+ * Vulkan Samples
+ *
+ * Copyright (C) 2015-2016 Valve Corporation
+ * Copyright (C) 2015-2016 LunarG, Inc.
+ * Copyright (C) 2015-2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+VULKAN_SAMPLE_DESCRIPTION
+samples batched upload manager
+*/
+
+#include <assert.h>
+#include "util.hpp"
+
+/* Initial size of the staging ring, grown for larger uploads */
+#define UPLOAD_RING_SIZE (4 * 1024 * 1024)
+
+static bool create_ring(struct sample_info &info, VkDeviceSize size) {
+    upload_manager &up = info.uploads;
+    VkResult U_ASSERT_ONLY res;
+
+    VkBufferCreateInfo buf_info = {};
+    buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buf_info.pNext = NULL;
+    buf_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    buf_info.size = size;
+    buf_info.queueFamilyIndexCount = 0;
+    buf_info.pQueueFamilyIndices = NULL;
+    buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    buf_info.flags = 0;
+    res = vkCreateBuffer(info.device, &buf_info, NULL, &up.buffer);
+    assert(res == VK_SUCCESS);
+
+    VkMemoryRequirements mem_reqs;
+    vkGetBufferMemoryRequirements(info.device, up.buffer, &mem_reqs);
+
+    if (!allocate_device_memory(info, mem_reqs, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, false,
+                                up.alloc)) {
+        vkDestroyBuffer(info.device, up.buffer, NULL);
+        up.buffer = VK_NULL_HANDLE;
+        return false;
+    }
+
+    res = vkBindBufferMemory(info.device, up.buffer, up.alloc.memory, up.alloc.offset);
+    assert(res == VK_SUCCESS);
+
+    up.size = size;
+    up.head = 0;
+    up.tail = 0;
+
+    return true;
+}
+
+static void destroy_ring(struct sample_info &info) {
+    upload_manager &up = info.uploads;
+
+    vkDestroyBuffer(info.device, up.buffer, NULL);
+    free_device_memory(info, up.alloc);
+    up.buffer = VK_NULL_HANDLE;
+    up.size = 0;
+}
+
+static void init_upload_manager(struct sample_info &info) {
+    upload_manager &up = info.uploads;
+    if (up.next_ticket) return;
+
+    VkCommandPoolCreateInfo cmd_pool_info = {};
+    cmd_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    cmd_pool_info.pNext = NULL;
+    cmd_pool_info.queueFamilyIndex = info.graphics_queue_family_index;
+    cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    VkResult U_ASSERT_ONLY res = vkCreateCommandPool(info.device, &cmd_pool_info, NULL, &up.cmd_pool);
+    assert(res == VK_SUCCESS);
+
+    up.buffer = VK_NULL_HANDLE;
+    up.alloc = {};
+    up.size = 0;
+    up.head = 0;
+    up.tail = 0;
+    up.next_ticket = 1;
+    up.cmd = VK_NULL_HANDLE;
+}
+
+/* Wait for the oldest batch and recycle its fence, command buffer and ring space */
+static void retire_batch(struct sample_info &info, bool wait) {
+    upload_manager &up = info.uploads;
+    upload_batch &batch = up.in_flight.front();
+    VkResult res;
+
+    if (wait) {
+        do {
+            res = vkWaitForFences(info.device, 1, &batch.fence, VK_TRUE, FENCE_TIMEOUT);
+        } while (res == VK_TIMEOUT);
+        assert(res == VK_SUCCESS);
+    }
+
+    release_fence(info, batch.fence);
+    res = vkResetCommandBuffer(batch.cmd, 0);
+    assert(res == VK_SUCCESS);
+    up.free_cmds.push_back(batch.cmd);
+    up.tail = batch.ring_end;
+
+    up.in_flight.erase(up.in_flight.begin());
+}
+
+static void retire_completed_batches(struct sample_info &info) {
+    upload_manager &up = info.uploads;
+
+    while (!up.in_flight.empty() && vkGetFenceStatus(info.device, up.in_flight.front().fence) == VK_SUCCESS)
+        retire_batch(info, false);
+}
+
+static void begin_batch(struct sample_info &info) {
+    upload_manager &up = info.uploads;
+    VkResult U_ASSERT_ONLY res;
+
+    if (up.free_cmds.empty()) {
+        VkCommandBufferAllocateInfo cmd = {};
+        cmd.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cmd.pNext = NULL;
+        cmd.commandPool = up.cmd_pool;
+        cmd.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        cmd.commandBufferCount = 1;
+
+        res = vkAllocateCommandBuffers(info.device, &cmd, &up.cmd);
+        assert(res == VK_SUCCESS);
+    } else {
+        up.cmd = up.free_cmds.back();
+        up.free_cmds.pop_back();
+    }
+
+    VkCommandBufferBeginInfo cmd_buf_info = {};
+    cmd_buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    cmd_buf_info.pNext = NULL;
+    cmd_buf_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    cmd_buf_info.pInheritanceInfo = NULL;
+
+    res = vkBeginCommandBuffer(up.cmd, &cmd_buf_info);
+    assert(res == VK_SUCCESS);
+}
+
+bool begin_upload(struct sample_info &info, VkDeviceSize size, VkDeviceSize alignment, upload_region &region) {
+    upload_manager &up = info.uploads;
+
+    init_upload_manager(info);
+    retire_completed_batches(info);
+
+    if (alignment == 0) alignment = 1;
+
+    /* Wait for everything in flight and start over with a large enough ring */
+    if (size > up.size) {
+        if (up.buffer != VK_NULL_HANDLE) {
+            wait_upload(info, up.next_ticket);
+            destroy_ring(info);
+        }
+
+        VkDeviceSize ring_size = UPLOAD_RING_SIZE;
+        while (ring_size < size) ring_size *= 2;
+        if (!create_ring(info, ring_size)) return false;
+    }
+
+    uint64_t pos;
+    while (true) {
+        /* Aligned offset in the ring, wrapping when the end is too close */
+        const VkDeviceSize head_offset = up.head % up.size;
+        const VkDeviceSize offset = (head_offset + alignment - 1) / alignment * alignment;
+        pos = up.head - head_offset + (offset + size <= up.size ? offset : up.size);
+
+        if (pos + size - up.tail <= up.size) break;
+
+        /* Out of space, wait for the oldest batch, submitting the current one if that is all there is */
+        if (up.in_flight.empty()) {
+            if (up.cmd == VK_NULL_HANDLE) {
+                up.head = 0;
+                up.tail = 0;
+                continue;
+            }
+            flush_uploads(info);
+        }
+        retire_batch(info, true);
+    }
+
+    if (up.cmd == VK_NULL_HANDLE) begin_batch(info);
+
+    up.head = pos + size;
+
+    region.data = (char *)up.alloc.mapped + pos % up.size;
+    region.buffer = up.buffer;
+    region.offset = pos % up.size;
+    region.cmd = up.cmd;
+    region.ticket = up.next_ticket;
+
+    return true;
+}
+
+uint64_t flush_uploads(struct sample_info &info) {
+    upload_manager &up = info.uploads;
+    VkResult U_ASSERT_ONLY res;
+
+    /* Nothing recorded since the last flush */
+    if (!up.next_ticket) return 0;
+    if (up.cmd == VK_NULL_HANDLE) return up.next_ticket - 1;
+
+    res = vkEndCommandBuffer(up.cmd);
+    assert(res == VK_SUCCESS);
+
+    upload_batch batch;
+    batch.ticket = up.next_ticket;
+    batch.cmd = up.cmd;
+    batch.fence = acquire_fence(info);
+    batch.ring_end = up.head;
+
+    VkSubmitInfo submit_info = {};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.pNext = NULL;
+    submit_info.waitSemaphoreCount = 0;
+    submit_info.pWaitSemaphores = NULL;
+    submit_info.pWaitDstStageMask = NULL;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &batch.cmd;
+    submit_info.signalSemaphoreCount = 0;
+    submit_info.pSignalSemaphores = NULL;
+
+    res = vkQueueSubmit(info.graphics_queue, 1, &submit_info, batch.fence);
+    assert(res == VK_SUCCESS);
+
+    up.in_flight.push_back(batch);
+    up.cmd = VK_NULL_HANDLE;
+
+    return up.next_ticket++;
+}
+
+void wait_upload(struct sample_info &info, uint64_t ticket) {
+    upload_manager &up = info.uploads;
+    if (!up.next_ticket) return;
+
+    if (ticket >= up.next_ticket) flush_uploads(info);
+
+    while (!up.in_flight.empty() && up.in_flight.front().ticket <= ticket) retire_batch(info, true);
+}
+
+VkFence acquire_fence(struct sample_info &info) {
+    upload_manager &up = info.uploads;
+    VkFence fence;
+
+    if (!up.free_fences.empty()) {
+        fence = up.free_fences.back();
+        up.free_fences.pop_back();
+        return fence;
+    }
+
+    VkFenceCreateInfo fenceInfo;
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.pNext = NULL;
+    fenceInfo.flags = 0;
+    VkResult U_ASSERT_ONLY res = vkCreateFence(info.device, &fenceInfo, NULL, &fence);
+    assert(res == VK_SUCCESS);
+
+    return fence;
+}
+
+void release_fence(struct sample_info &info, VkFence fence) {
+    VkResult U_ASSERT_ONLY res = vkResetFences(info.device, 1, &fence);
+    assert(res == VK_SUCCESS);
+    info.uploads.free_fences.push_back(fence);
+}
+
+void destroy_upload_manager(struct sample_info &info) {
+    upload_manager &up = info.uploads;
+
+    if (up.next_ticket) {
+        wait_upload(info, up.next_ticket);
+        if (up.buffer != VK_NULL_HANDLE) destroy_ring(info);
+        vkDestroyCommandPool(info.device, up.cmd_pool, NULL);
+        up.free_cmds.clear();
+        up.next_ticket = 0;
+    }
+
+    for (auto fence : up.free_fences) vkDestroyFence(info.device, fence, NULL);
+    up.free_fences.clear();
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "Simd.h"
+#include "Frustum.h"
+
+Frustum::Frustum(const glm::mat4 &view_projection, float pixel_scale, float min_size) {
+    const glm::vec4 x_row(view_projection[0][0], view_projection[1][0], view_projection[2][0], view_projection[3][0]);
+    const glm::vec4 y_row(view_projection[0][1], view_projection[1][1], view_projection[2][1], view_projection[3][1]);
+    const glm::vec4 z_row(view_projection[0][2], view_projection[1][2], view_projection[2][2], view_projection[3][2]);
+    w_row_ = glm::vec4(view_projection[0][3], view_projection[1][3], view_projection[2][3], view_projection[3][3]);
+
+    planes_[0] = w_row_ + x_row;
+    planes_[1] = w_row_ - x_row;
+    planes_[2] = w_row_ + y_row;
+    planes_[3] = w_row_ - y_row;
+    planes_[4] = z_row;
+    planes_[5] = w_row_ - z_row;
+    for (auto &plane : planes_) plane /= glm::length(glm::vec3(plane));
+
+    min_radius_ = min_size * 0.5f / pixel_scale;
+}
+
+template <typename F>
+int Frustum::cull_lanes(const Spheres &spheres, int first, int *visible) const {
+    const F x = F::load(&spheres.x[first]);
+    const F y = F::load(&spheres.y[first]);
+    const F z = F::load(&spheres.z[first]);
+    const F radius = F::load(&spheres.radius[first]);
+
+    // behind the near plane, w is not positive and nothing is too small
+    const F w = F(w_row_.x) * x + F(w_row_.y) * y + F(w_row_.z) * z + F(w_row_.w);
+    typename F::Mask culled = F(min_radius_) * w > radius;
+
+    for (const auto &plane : planes_) {
+        const F dist = F(plane.x) * x + F(plane.y) * y + F(plane.z) * z + F(plane.w);
+        culled = F::mask_or(culled, F(0.0f) > dist + radius);
+    }
+
+    const int culled_bits = F::mask_bits(culled);
+    int count = 0;
+    for (int lane = 0; lane < F::width; lane++) {
+        if (!(culled_bits & (1 << lane))) visible[count++] = first + lane;
+    }
+
+    return count;
+}
+
+int Frustum::cull(const Spheres &spheres, int count, int *visible) const {
+    int visible_count = 0;
+
+    int i = 0;
+    for (; i + simd::Wide::width <= count; i += simd::Wide::width)
+        visible_count += cull_lanes<simd::Wide>(spheres, i, visible + visible_count);
+    for (; i < count; i++) visible_count += cull_lanes<simd::F1>(spheres, i, visible + visible_count);
+
+    return visible_count;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+// Culls bounding spheres against the view frustum and against a minimum
+// projected size, simd::Wide spheres at a time.
+class Frustum {
+   public:
+    // view_projection maps to Vulkan clip space, where 0 <= z <= w.  Spheres
+    // less than min_size pixels across are culled, given pixel_scale pixels
+    // per unit of length at a clip space w of 1.
+    Frustum(const glm::mat4 &view_projection, float pixel_scale, float min_size);
+
+    // bounding spheres in structure of arrays
+    struct Spheres {
+        const float *x;
+        const float *y;
+        const float *z;
+        const float *radius;
+    };
+
+    // write the indices of the spheres that are not culled to visible and
+    // return how many there are
+    int cull(const Spheres &spheres, int count, int *visible) const;
+
+   private:
+    template <typename F>
+    int cull_lanes(const Spheres &spheres, int first, int *visible) const;
+
+    // left, right, top, bottom, near and far, pointing inwards and with unit
+    // normals
+    glm::vec4 planes_[6];
+    // the row of view_projection giving w
+    glm::vec4 w_row_;
+    // a sphere at w is too small below this radius times w
+    float min_radius_;
+};
+
+#endif  // FRUSTUM_H
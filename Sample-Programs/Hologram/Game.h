@@ -17,6 +17,8 @@
 #ifndef GAME_H
 #define GAME_H
 
+#include <algorithm>
+#include <ostream>
 #include <string>
 #include <vector>
 
@@ -28,15 +30,45 @@ class Game {
     Game &operator=(const Game &game) = delete;
     virtual ~Game() {}
 
+    // FIFO is used when the preferred mode is not supported
+    enum PresentMode {
+        PRESENT_MODE_FIFO,
+        PRESENT_MODE_FIFO_RELAXED,
+        PRESENT_MODE_MAILBOX,
+        PRESENT_MODE_IMMEDIATE,
+    };
+
     struct Settings {
         std::string name;
         int initial_width;
         int initial_height;
         int queue_count;
+        // swapchain images to ask for; clamped to what the surface allows
         int back_buffer_count;
+        // how many presents the CPU may get ahead of before it waits for
+        // one to complete; back_buffer_count + 1 when zero
+        int max_frames_ahead;
+        int frames_in_flight;
+        int object_count;
         int ticks_per_second;
-        bool vsync;
+        PresentMode present_mode;
+        // a --present-mode value that names no mode, for which FIFO is used
+        std::string unknown_present_mode;
+        // when non-zero, sleep between frames to present at most this many
+        // frames per second, right before handling input
+        int max_fps;
         bool animate;
+        bool batched_simulation;
+        // run the batched simulation in a compute shader, optionally
+        // checking it against the CPU at exit
+        bool gpu_simulation;
+        bool gpu_simulation_check;
+
+        // seed the simulation with seed instead of std::random_device
+        bool fixed_seed;
+        unsigned int seed;
+        // tick exactly once per frame regardless of elapsed time
+        bool replay;
 
         bool validate;
         bool validate_verbose;
@@ -44,12 +76,23 @@ class Game {
         bool no_tick;
         bool no_render;
         bool no_present;
+
+        // render offscreen without a window system
+        bool headless;
+        // stop after this many frames when non-zero
+        int max_frame_count;
+
+        // write a Chrome trace of the profiled scopes when non-empty
+        std::string trace_file;
     };
     const Settings &settings() const { return settings_; }
 
     virtual void attach_shell(Shell &shell) { shell_ = &shell; }
     virtual void detach_shell() { shell_ = nullptr; }
 
+    // Frames rendered to the old swapchain may still be in flight when
+    // detach_swapchain is called during a resize.  The old images stay valid
+    // until settings().frames_in_flight more frames have been rendered.
     virtual void attach_swapchain() {}
     virtual void detach_swapchain() {}
 
@@ -69,6 +112,9 @@ class Game {
 
     virtual void on_frame(float frame_pred) {}
 
+    // append to the periodic FPS log line; counters are for the period
+    virtual void on_profile(std::ostream &os) {}
+
    protected:
     Game(const std::string &name, const std::vector<std::string> &args) : settings_(), shell_(nullptr) {
         settings_.name = name;
@@ -76,9 +122,20 @@ class Game {
         settings_.initial_height = 1024;
         settings_.queue_count = 1;
         settings_.back_buffer_count = 1;
+        settings_.max_frames_ahead = 0;
+        settings_.frames_in_flight = 2;
+        settings_.object_count = 5000;
         settings_.ticks_per_second = 30;
-        settings_.vsync = true;
+        settings_.present_mode = PRESENT_MODE_MAILBOX;
+        settings_.max_fps = 0;
         settings_.animate = true;
+        settings_.batched_simulation = false;
+        settings_.gpu_simulation = false;
+        settings_.gpu_simulation_check = false;
+
+        settings_.fixed_seed = false;
+        settings_.seed = 0;
+        settings_.replay = false;
 
         settings_.validate = false;
         settings_.validate_verbose = false;
@@ -87,6 +144,9 @@ class Game {
         settings_.no_render = false;
         settings_.no_present = false;
 
+        settings_.headless = false;
+        settings_.max_frame_count = 0;
+
         parse_args(args);
     }
 
@@ -97,13 +157,60 @@ class Game {
     void parse_args(const std::vector<std::string> &args) {
         for (auto it = args.begin(); it != args.end(); ++it) {
             if (*it == "-b") {
-                settings_.vsync = false;
+                settings_.present_mode = PRESENT_MODE_IMMEDIATE;
+            } else if (*it == "--present-mode") {
+                ++it;
+                if (*it == "fifo") {
+                    settings_.present_mode = PRESENT_MODE_FIFO;
+                } else if (*it == "fifo-relaxed") {
+                    settings_.present_mode = PRESENT_MODE_FIFO_RELAXED;
+                } else if (*it == "mailbox") {
+                    settings_.present_mode = PRESENT_MODE_MAILBOX;
+                } else if (*it == "immediate") {
+                    settings_.present_mode = PRESENT_MODE_IMMEDIATE;
+                } else {
+                    settings_.present_mode = PRESENT_MODE_FIFO;
+                    settings_.unknown_present_mode = *it;
+                }
+            } else if (*it == "--back-buffers") {
+                ++it;
+                settings_.back_buffer_count = std::max(1, std::stoi(*it));
+            } else if (*it == "--max-frames-ahead") {
+                ++it;
+                settings_.max_frames_ahead = std::max(1, std::min(std::stoi(*it), 16));
+            } else if (*it == "--max-fps") {
+                ++it;
+                settings_.max_fps = std::max(0, std::stoi(*it));
             } else if (*it == "-w") {
                 ++it;
                 settings_.initial_width = std::stoi(*it);
             } else if (*it == "-h") {
                 ++it;
                 settings_.initial_height = std::stoi(*it);
+            } else if (*it == "--queues") {
+                ++it;
+                settings_.queue_count = std::max(1, std::min(std::stoi(*it), 16));
+            } else if (*it == "--frames-in-flight") {
+                ++it;
+                settings_.frames_in_flight = std::max(1, std::min(std::stoi(*it), 8));
+            } else if (*it == "--objects") {
+                ++it;
+                settings_.object_count = std::max(1, std::stoi(*it));
+            } else if (*it == "--batched-sim") {
+                settings_.batched_simulation = true;
+            } else if (*it == "--gpu-sim") {
+                settings_.batched_simulation = true;
+                settings_.gpu_simulation = true;
+            } else if (*it == "--gpu-sim-check") {
+                settings_.batched_simulation = true;
+                settings_.gpu_simulation = true;
+                settings_.gpu_simulation_check = true;
+            } else if (*it == "--seed") {
+                ++it;
+                settings_.fixed_seed = true;
+                settings_.seed = static_cast<unsigned int>(std::stoul(*it));
+            } else if (*it == "--replay") {
+                settings_.replay = true;
             } else if ((*it == "-v") || (*it == "--validate")) {
                 settings_.validate = true;
             } else if (*it == "-vv") {
@@ -115,6 +222,14 @@ class Game {
                 settings_.no_render = true;
             } else if (*it == "-np") {
                 settings_.no_present = true;
+            } else if (*it == "--headless") {
+                settings_.headless = true;
+            } else if (*it == "--frames") {
+                ++it;
+                settings_.max_frame_count = std::stoi(*it);
+            } else if (*it == "--trace") {
+                ++it;
+                settings_.trace_file = *it;
             }
         }
     }
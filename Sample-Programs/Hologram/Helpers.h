@@ -102,6 +102,17 @@ inline VkResult get(VkDevice dev, VkSwapchainKHR swapchain, std::vector<VkImage>
     return vk::GetSwapchainImagesKHR(dev, swapchain, &count, images.data());
 }
 
+inline VkResult get(VkDevice dev, VkPipelineCache cache, std::vector<uint8_t> &data) {
+    size_t size = 0;
+    vk::GetPipelineCacheData(dev, cache, &size, nullptr);
+
+    data.resize(size);
+    VkResult res = vk::GetPipelineCacheData(dev, cache, &size, data.data());
+    data.resize(size);
+
+    return res;
+}
+
 }  // namespace vk
 
 #endif  // HELPERS_H
@@ -15,7 +15,17 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
 
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -27,26 +37,133 @@
 
 namespace {
 
-// TODO do not rely on compiler to use std140 layout
-// TODO move lower frequency data to another descriptor set
+// std140 layout of camera_block in Hologram.vert and Hologram.push_constant.vert
+struct CameraParamBlock {
+    float view_projection[4 * 4];
+};
+
+// std140 layout of param_block in Hologram.vert and Hologram.push_constant.vert
 struct ShaderParamBlock {
-    float light_pos[4];
+    // rows of the affine model matrix
+    float model[3 * 4];
+    float light_pos[3];
+    float alpha;
+    float light_color[3];
+};
+static_assert(sizeof(ShaderParamBlock) == 76, "ShaderParamBlock must match std140");
+
+// std430 layout of instance_params in Hologram.instanced.vert
+struct InstanceParamBlock {
+    float light_pos[3];
+    float alpha;
     float light_color[4];
     float model[4 * 4];
-    float view_projection[4 * 4];
-    float alpha;
 };
 
+// push constants of Hologram.sim.comp
+struct SimTickParams {
+    float time;
+    uint32_t count;
+    uint32_t fade;
+};
+
+// local_size_x of Hologram.sim.comp
+const uint32_t sim_group_size = 64;
+
+// how far the GPU simulation may drift from the CPU
+const float sim_check_tolerance = 1e-3f;
+
+// Return the first memory type allowed by type_bits that has all of the
+// preferred flags, or else the first that has all of the required flags.
+uint32_t find_memory_type(const std::vector<VkMemoryPropertyFlags> &mem_flags, uint32_t type_bits,
+                          VkMemoryPropertyFlags preferred, VkMemoryPropertyFlags required) {
+    for (auto flags : {preferred, required}) {
+        for (uint32_t idx = 0; idx < mem_flags.size(); idx++) {
+            if ((type_bits & (1 << idx)) && (mem_flags[idx] & flags) == flags) return idx;
+        }
+    }
+
+    throw std::runtime_error("failed to find a memory type");
+}
+
+void pack_params(const Simulation::Object &obj, const glm::mat4 &model, float alpha, ShaderParamBlock &params) {
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 4; col++) params.model[4 * row + col] = model[col][row];
+    }
+    memcpy(params.light_pos, glm::value_ptr(obj.light_pos), sizeof(obj.light_pos));
+    params.alpha = alpha;
+    memcpy(params.light_color, glm::value_ptr(obj.light_color), sizeof(obj.light_color));
+}
+
+void pack_instance(const Simulation::Object &obj, const glm::mat4 &model, float alpha, InstanceParamBlock &params) {
+    memcpy(params.light_pos, glm::value_ptr(obj.light_pos), sizeof(obj.light_pos));
+    memcpy(params.light_color, glm::value_ptr(obj.light_color), sizeof(obj.light_color));
+    memcpy(params.model, glm::value_ptr(model), sizeof(model));
+    params.alpha = alpha;
+}
+
+// Return true when data starts with a pipeline cache header for the device
+// and driver of props.
+bool pipeline_cache_compatible(const std::vector<uint8_t> &data, const VkPhysicalDeviceProperties &props) {
+    // VkPipelineCacheHeaderVersionOne
+    const size_t header_size = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+    if (data.size() < header_size) return false;
+
+    uint32_t header[4];
+    memcpy(header, data.data(), sizeof(header));
+
+    return header[0] >= header_size && header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && header[2] == props.vendorID &&
+           header[3] == props.deviceID && memcmp(data.data() + sizeof(header), props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+// objects are handed to workers in chunks of this size
+const int object_chunk_size = 256;
+
+// Uniform buffers for the objects are split into blocks, and the same block
+// of all frames shares an allocation of at most this size.  Vulkan 1.0
+// cannot query the largest allocation a device allows, so stay well below
+// what implementations handle.
+const VkDeviceSize max_frame_data_block_size = 64 * 1024 * 1024;
+
+// the coarsest LOD whose error projects to less than this many pixels is
+// drawn
+const float max_lod_pixel_error = 0.5f;
+
+// objects less than this many pixels across are not drawn
+const float min_object_pixel_size = 1.0f;
+
 }  // namespace
 
 Hologram::Hologram(const std::vector<std::string> &args)
     : Game("Hologram", args),
       multithread_(true),
       use_push_constants_(false),
+      use_instancing_(false),
+      use_gpu_simulation_(settings_.gpu_simulation),
+      use_sim_thread_(false),
+      use_lod_(true),
+      use_culling_(true),
+      mesh_flags_(0),
+      pipeline_cache_file_("Hologram.pipeline_cache"),
+      tick_interval_(1.0f / settings_.ticks_per_second),
+      sim_seed_(settings_.fixed_seed ? settings_.seed : std::random_device()()),
+      sim_tick_count_(0),
       sim_paused_(false),
       sim_fade_(false),
-      sim_(5000),
+      sim_(settings_.object_count, settings_.batched_simulation, sim_seed_),
       camera_(2.5f),
+      sim_snapshot_(nullptr),
+      sim_blend_(1.0f),
+      sim_pending_ticks_(0),
+      sim_draw_semaphore_(VK_NULL_HANDLE),
+      sim_submit_count_(0),
+      upload_bytes_(0),
+      triangle_count_(0),
+      visible_count_(0),
+      culled_count_(0),
+      profile_frame_count_(0),
+      profile_gpu_time_(0.0),
+      profile_gpu_frame_count_(0),
       frame_data_(),
       render_pass_clear_value_({{0.0f, 0.1f, 0.2f, 1.0f}}),
       render_pass_begin_info_(),
@@ -57,8 +174,36 @@ Hologram::Hologram(const std::vector<std::string> &args)
             multithread_ = false;
         else if (*it == "-p")
             use_push_constants_ = true;
+        else if (*it == "-i")
+            use_instancing_ = true;
+        else if (*it == "--sim-thread")
+            use_sim_thread_ = true;
+        else if (*it == "--packed-vertices")
+            mesh_flags_ |= Meshes::FLAG_PACKED_VERTICES;
+        else if (*it == "--optimize-meshes")
+            mesh_flags_ |= Meshes::FLAG_OPTIMIZE;
+        else if (*it == "--optimize-overdraw")
+            mesh_flags_ |= Meshes::FLAG_OPTIMIZE | Meshes::FLAG_OPTIMIZE_OVERDRAW;
+        else if (*it == "--no-lod")
+            use_lod_ = false;
+        else if (*it == "--no-cull")
+            use_culling_ = false;
+        else if (*it == "--pipeline-cache")
+            pipeline_cache_file_ = *++it;
+        else if (*it == "--no-pipeline-cache")
+            pipeline_cache_file_.clear();
     }
 
+    // the GPU simulation has no CPU ticks to move, and replays tick in
+    // lockstep with frames
+    if (use_gpu_simulation_ || settings_.replay) use_sim_thread_ = false;
+
+    // the GPU simulation writes what instancing reads
+    if (use_gpu_simulation_) use_instancing_ = true;
+
+    // instancing does not use per-object push constants
+    if (use_instancing_) use_push_constants_ = false;
+
     init_workers();
 }
 
@@ -74,19 +219,24 @@ void Hologram::init_workers() {
     }
 
     assert(sim_.objects().size() <= INT32_MAX);
-    const int object_per_worker = static_cast<int>(sim_.objects().size() / worker_count);
-    int object_begin = 0, object_end = 0;
-
-    workers_.reserve(worker_count);
-    for (int i = 0; i < worker_count; i++) {
-        object_begin = object_end;
-        if (i < worker_count - 1)
-            object_end += object_per_worker;
-        else
-            object_end = static_cast<int>(sim_.objects().size());
 
-        Worker *worker = new Worker(*this, i, object_begin, object_end);
-        workers_.emplace_back(std::unique_ptr<Worker>(worker));
+    // the sim thread workers come out of the same cores as the recording
+    // workers, a third of them, so that the two pools don't oversubscribe
+    int sim_worker_count = 0;
+    if (use_sim_thread_) {
+        sim_worker_count = std::max(1, worker_count / 3);
+        worker_count = std::max(1, worker_count - sim_worker_count);
+    }
+
+    job_pool_.reset(new JobPool(worker_count));
+
+    if (use_sim_thread_) {
+        // sim thread workers are traced after the recording workers
+        sim_thread_.reset(new SimulationThread(sim_, sim_worker_count, object_chunk_size, [this](int worker, int begin, int end) {
+            Profiler::Timer timer(shell_->profiler(), Profiler::SCOPE_SIMULATE,
+                                  Profiler::TRACK_WORKER + job_pool_->worker_count() + worker);
+            update_simulation(begin, end);
+        }));
     }
 }
 
@@ -102,25 +252,91 @@ void Hologram::attach_shell(Shell &sh) {
 
     vk::GetPhysicalDeviceProperties(physical_dev_, &physical_dev_props_);
 
+    std::vector<VkQueueFamilyProperties> queue_families;
+    vk::get(physical_dev_, queue_families);
+    const uint32_t timestamp_bits = queue_families[queue_family_].timestampValidBits;
+    gpu_timing_ = (timestamp_bits > 0);
+    timestamp_mask_ = (timestamp_bits < 64) ? (uint64_t(1) << timestamp_bits) - 1 : UINT64_MAX;
+
     if (use_push_constants_ && sizeof(ShaderParamBlock) > physical_dev_props_.limits.maxPushConstantsSize) {
         shell_->log(Shell::LOG_WARN, "cannot enable push constants");
         use_push_constants_ = false;
     }
 
+    if (use_instancing_ && sizeof(InstanceParamBlock) * sim_.objects().size() > physical_dev_props_.limits.maxStorageBufferRange) {
+        shell_->log(Shell::LOG_WARN, "cannot enable instancing");
+        use_instancing_ = false;
+    }
+
+    if (use_gpu_simulation_ &&
+        (!use_instancing_ || !(queue_families[queue_family_].queueFlags & VK_QUEUE_COMPUTE_BIT) ||
+         sizeof(Simulation::PackedState) * sim_.objects().size() > physical_dev_props_.limits.maxStorageBufferRange)) {
+        shell_->log(Shell::LOG_WARN, "cannot enable GPU simulation");
+        use_gpu_simulation_ = false;
+    }
+
+    // queues of the same family need no ownership transfers
+    sim_queue_ = (use_gpu_simulation_ && ctx.game_queues.size() > 1) ? ctx.game_queues[1] : VK_NULL_HANDLE;
+    {
+        std::stringstream ss;
+        ss << "queues: " << ctx.game_queues.size() << " of the game queue family, simulation "
+           << (sim_queue_ != VK_NULL_HANDLE ? "on its own queue" : (use_gpu_simulation_ ? "on the draw queue" : "on the CPU"));
+        shell_->log(Shell::LOG_INFO, ss.str().c_str());
+    }
+
     VkPhysicalDeviceMemoryProperties mem_props;
     vk::GetPhysicalDeviceMemoryProperties(physical_dev_, &mem_props);
     mem_flags_.reserve(mem_props.memoryTypeCount);
     for (uint32_t i = 0; i < mem_props.memoryTypeCount; i++) mem_flags_.push_back(mem_props.memoryTypes[i].propertyFlags);
 
-    meshes_ = new Meshes(dev_, mem_flags_);
+    meshes_ = new Meshes(ctx, mem_flags_, mesh_flags_);
+    {
+        // every object reads its whole mesh once per frame, at most
+        VkDeviceSize draw_size = 0;
+        for (const auto &obj : sim_.objects()) draw_size += meshes_->draw_size(obj.mesh);
+
+        std::stringstream ss;
+        ss << "meshes: " << meshes_->upload_size() << " bytes in " << (meshes_->device_local() ? "device local" : "host")
+           << " memory, " << (meshes_->staged() ? "staged" : "written in place") << " in " << meshes_->upload_time() * 1000.0
+           << " ms, " << (meshes_->packed_vertices() ? "packed" : "float") << " vertices, up to " << draw_size
+           << " bytes read per frame";
+        shell_->log(Shell::LOG_INFO, ss.str().c_str());
+    }
+    if (mesh_flags_ & Meshes::FLAG_OPTIMIZE) {
+        for (int i = 0; i < Meshes::MESH_COUNT; i++) {
+            const Meshes::Type type = static_cast<Meshes::Type>(i);
+            const auto &built = meshes_->built_cache_stats(type);
+            const auto &optimized = meshes_->cache_stats(type);
+
+            std::stringstream ss;
+            ss << Meshes::type_name(type) << ": ACMR " << built.acmr << " -> " << optimized.acmr << ", ATVR " << built.atvr
+               << " -> " << optimized.atvr;
+            shell_->log(Shell::LOG_INFO, ss.str().c_str());
+        }
+    }
 
     create_render_pass();
     create_shader_modules();
     create_descriptor_set_layout();
     create_pipeline_layout();
-    create_pipeline();
+    {
+        const size_t loaded_size = create_pipeline_cache();
+
+        const auto pipeline_begin = std::chrono::steady_clock::now();
+        create_pipeline();
+        if (use_gpu_simulation_) create_simulation_pipeline();
+        const double pipeline_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - pipeline_begin).count();
 
-    create_frame_data(2);
+        std::stringstream ss;
+        ss << "pipelines: created in " << pipeline_time * 1000.0 << " ms from a ";
+        if (loaded_size)
+            ss << "warm cache of " << loaded_size << " bytes";
+        else
+            ss << "cold cache";
+        shell_->log(Shell::LOG_INFO, ss.str().c_str());
+    }
+
+    create_frame_data(settings_.frames_in_flight);
 
     render_pass_begin_info_.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     render_pass_begin_info_.renderPass = render_pass_;
@@ -130,30 +346,42 @@ void Hologram::attach_shell(Shell &sh) {
     primary_cmd_begin_info_.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     primary_cmd_begin_info_.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    // we will render to the swapchain images
-    primary_cmd_submit_wait_stages_ = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-
     primary_cmd_submit_info_.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    primary_cmd_submit_info_.waitSemaphoreCount = 1;
-    primary_cmd_submit_info_.pWaitDstStageMask = &primary_cmd_submit_wait_stages_;
     primary_cmd_submit_info_.commandBufferCount = 1;
-    primary_cmd_submit_info_.signalSemaphoreCount = 1;
 
-    if (multithread_) {
-        for (auto &worker : workers_) worker->start();
-    }
+    std::stringstream ss;
+    ss << "simulation seed " << sim_seed_;
+    shell_->log(Shell::LOG_INFO, ss.str().c_str());
+
+    if (multithread_) job_pool_->start();
+    if (sim_thread_) sim_thread_->start();
 }
 
 void Hologram::detach_shell() {
-    if (multithread_) {
-        for (auto &worker : workers_) worker->stop();
+    if (sim_thread_) sim_thread_->stop();
+    if (multithread_) job_pool_->stop();
+
+    // compare across runs with the same --seed and --replay
+    if (!use_gpu_simulation_ || settings_.gpu_simulation_check) {
+        // the sim thread drops ticks when it falls behind
+        const uint64_t tick_count = sim_thread_ ? sim_thread_->tick_count() : sim_tick_count_;
+
+        std::stringstream ss;
+        ss << "simulation checksum after " << tick_count << " ticks: " << std::hex << std::setw(16) << std::setfill('0')
+           << sim_.checksum();
+        shell_->log(Shell::LOG_INFO, ss.str().c_str());
     }
 
+    if (use_gpu_simulation_ && settings_.gpu_simulation_check) check_simulation();
+
     destroy_frame_data();
 
+    if (use_gpu_simulation_) destroy_simulation_pipeline();
     vk::DestroyPipeline(dev_, pipeline_, nullptr);
+    destroy_pipeline_cache();
     vk::DestroyPipelineLayout(dev_, pipeline_layout_, nullptr);
     if (!use_push_constants_) vk::DestroyDescriptorSetLayout(dev_, desc_set_layout_, nullptr);
+    if (!use_instancing_) vk::DestroyDescriptorSetLayout(dev_, camera_desc_set_layout_, nullptr);
     vk::DestroyShaderModule(dev_, fs_, nullptr);
     vk::DestroyShaderModule(dev_, vs_, nullptr);
     vk::DestroyRenderPass(dev_, render_pass_, nullptr);
@@ -170,7 +398,8 @@ void Hologram::create_render_pass() {
     attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
     attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // offscreen images are never presented
+    attachment.finalLayout = settings_.headless ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     VkAttachmentReference attachment_ref = {};
     attachment_ref.attachment = 0;
@@ -210,6 +439,10 @@ void Hologram::create_shader_modules() {
 #include "Hologram.push_constant.vert.h"
         sh_info.codeSize = sizeof(Hologram_push_constant_vert);
         sh_info.pCode = Hologram_push_constant_vert;
+    } else if (use_instancing_) {
+#include "Hologram.instanced.vert.h"
+        sh_info.codeSize = sizeof(Hologram_instanced_vert);
+        sh_info.pCode = Hologram_instanced_vert;
     } else {
 #include "Hologram.vert.h"
         sh_info.codeSize = sizeof(Hologram_vert);
@@ -224,19 +457,29 @@ void Hologram::create_shader_modules() {
 }
 
 void Hologram::create_descriptor_set_layout() {
-    if (use_push_constants_) return;
-
     VkDescriptorSetLayoutBinding layout_binding = {};
-    layout_binding.binding = 0;
-    layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-    layout_binding.descriptorCount = 1;
-    layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
     VkDescriptorSetLayoutCreateInfo layout_info = {};
     layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     layout_info.bindingCount = 1;
     layout_info.pBindings = &layout_binding;
 
+    // the camera changes once per frame
+    if (!use_instancing_) {
+        layout_binding.binding = 0;
+        layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        layout_binding.descriptorCount = 1;
+        layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+        vk::assert_success(vk::CreateDescriptorSetLayout(dev_, &layout_info, nullptr, &camera_desc_set_layout_));
+    }
+
+    if (use_push_constants_) return;
+
+    layout_binding.binding = 0;
+    layout_binding.descriptorType = use_instancing_ ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    layout_binding.descriptorCount = 1;
+    layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
     vk::assert_success(vk::CreateDescriptorSetLayout(dev_, &layout_info, nullptr, &desc_set_layout_));
 }
 
@@ -246,16 +489,32 @@ void Hologram::create_pipeline_layout() {
     VkPipelineLayoutCreateInfo pipeline_layout_info = {};
     pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 
+    // camera in set 0 and objects in set 1
+    const VkDescriptorSetLayout set_layouts[2] = {camera_desc_set_layout_, desc_set_layout_};
+
     if (use_push_constants_) {
         push_const_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
         push_const_range.offset = 0;
         push_const_range.size = sizeof(ShaderParamBlock);
 
+        pipeline_layout_info.setLayoutCount = 1;
+        pipeline_layout_info.pSetLayouts = set_layouts;
         pipeline_layout_info.pushConstantRangeCount = 1;
         pipeline_layout_info.pPushConstantRanges = &push_const_range;
-    } else {
+    } else if (use_instancing_) {
         pipeline_layout_info.setLayoutCount = 1;
         pipeline_layout_info.pSetLayouts = &desc_set_layout_;
+
+        // view projection is shared by all instances
+        push_const_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        push_const_range.offset = 0;
+        push_const_range.size = sizeof(camera_.view_projection);
+
+        pipeline_layout_info.pushConstantRangeCount = 1;
+        pipeline_layout_info.pPushConstantRanges = &push_const_range;
+    } else {
+        pipeline_layout_info.setLayoutCount = 2;
+        pipeline_layout_info.pSetLayouts = set_layouts;
     }
 
     vk::assert_success(vk::CreatePipelineLayout(dev_, &pipeline_layout_info, nullptr, &pipeline_layout_));
@@ -267,6 +526,20 @@ void Hologram::create_pipeline() {
     stage_info[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
     stage_info[0].module = vs_;
     stage_info[0].pName = "main";
+
+    // packed_normals
+    const VkBool32 packed_normals = meshes_->packed_vertices();
+    VkSpecializationMapEntry spec_entry = {};
+    spec_entry.constantID = 0;
+    spec_entry.offset = 0;
+    spec_entry.size = sizeof(packed_normals);
+
+    VkSpecializationInfo spec_info = {};
+    spec_info.mapEntryCount = 1;
+    spec_info.pMapEntries = &spec_entry;
+    spec_info.dataSize = sizeof(packed_normals);
+    spec_info.pData = &packed_normals;
+    stage_info[0].pSpecializationInfo = &spec_info;
     stage_info[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     stage_info[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     stage_info[1].module = fs_;
@@ -335,7 +608,63 @@ void Hologram::create_pipeline() {
     pipeline_info.layout = pipeline_layout_;
     pipeline_info.renderPass = render_pass_;
     pipeline_info.subpass = 0;
-    vk::assert_success(vk::CreateGraphicsPipelines(dev_, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipeline_));
+    vk::assert_success(vk::CreateGraphicsPipelines(dev_, pipeline_cache_, 1, &pipeline_info, nullptr, &pipeline_));
+}
+
+size_t Hologram::create_pipeline_cache() {
+    std::vector<uint8_t> data;
+    if (!pipeline_cache_file_.empty()) {
+        std::ifstream file(pipeline_cache_file_.c_str(), std::ios::binary);
+        if (file) data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+        // drivers must reject foreign data, but not all of them do
+        if (!data.empty() && !pipeline_cache_compatible(data, physical_dev_props_)) {
+            shell_->log(Shell::LOG_INFO, ("ignoring " + pipeline_cache_file_ + " from another device or driver").c_str());
+            data.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo cache_info = {};
+    cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_info.initialDataSize = data.size();
+    cache_info.pInitialData = data.data();
+    vk::assert_success(vk::CreatePipelineCache(dev_, &cache_info, nullptr, &pipeline_cache_));
+
+    return data.size();
+}
+
+void Hologram::destroy_pipeline_cache() {
+    std::vector<uint8_t> data;
+    if (!pipeline_cache_file_.empty() && vk::get(dev_, pipeline_cache_, data) == VK_SUCCESS && !data.empty()) {
+        // write a temporary file and rename it over the cache, so that
+        // another instance never reads a partial cache
+        const std::string tmp_file = pipeline_cache_file_ + ".tmp";
+        bool saved;
+        {
+            std::ofstream file(tmp_file.c_str(), std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char *>(data.data()), data.size());
+            file.close();
+            saved = !file.fail();
+        }
+
+        if (saved) {
+            saved = (std::rename(tmp_file.c_str(), pipeline_cache_file_.c_str()) == 0);
+#ifdef _WIN32
+            // rename does not replace files on Windows
+            if (!saved) {
+                std::remove(pipeline_cache_file_.c_str());
+                saved = (std::rename(tmp_file.c_str(), pipeline_cache_file_.c_str()) == 0);
+            }
+#endif
+        }
+
+        if (!saved) {
+            std::remove(tmp_file.c_str());
+            shell_->log(Shell::LOG_WARN, ("failed to write " + pipeline_cache_file_).c_str());
+        }
+    }
+
+    vk::DestroyPipelineCache(dev_, pipeline_cache_, nullptr);
 }
 
 void Hologram::create_frame_data(int count) {
@@ -344,12 +673,30 @@ void Hologram::create_frame_data(int count) {
     create_fences();
     create_command_buffers();
 
-    if (!use_push_constants_) {
+    if (gpu_timing_) {
+        VkQueryPoolCreateInfo query_pool_info = {};
+        query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        query_pool_info.queryCount = 2 * count;
+        vk::assert_success(vk::CreateQueryPool(dev_, &query_pool_info, nullptr, &query_pool_));
+    }
+
+    if (use_gpu_simulation_) {
+        create_simulation_buffers();
+        create_simulation_descriptor_sets();
+    } else if (!use_push_constants_) {
         create_buffers();
         create_buffer_memory();
         create_descriptor_sets();
     }
 
+    if (!use_instancing_) create_camera_data();
+
+    for (auto &data : frame_data_) {
+        data.params_tick = UINT64_MAX;
+        data.params_fade = sim_fade_;
+    }
+
     frame_data_index_ = 0;
 }
 
@@ -357,27 +704,65 @@ void Hologram::destroy_frame_data() {
     if (!use_push_constants_) {
         vk::DestroyDescriptorPool(dev_, desc_pool_, nullptr);
 
-        vk::UnmapMemory(dev_, frame_data_mem_);
-        vk::FreeMemory(dev_, frame_data_mem_, nullptr);
+        for (auto mem : frame_data_mems_) {
+            vk::UnmapMemory(dev_, mem);
+            vk::FreeMemory(dev_, mem, nullptr);
+        }
+        frame_data_mems_.clear();
 
-        for (auto &data : frame_data_) vk::DestroyBuffer(dev_, data.buf, nullptr);
+        for (auto &data : frame_data_) {
+            for (auto buf : data.bufs) vk::DestroyBuffer(dev_, buf, nullptr);
+        }
     }
 
+    if (use_gpu_simulation_) destroy_simulation_buffers();
+    if (!use_instancing_) destroy_camera_data();
+
+    if (gpu_timing_) vk::DestroyQueryPool(dev_, query_pool_, nullptr);
+
     for (auto cmd_pool : worker_cmd_pools_) vk::DestroyCommandPool(dev_, cmd_pool, nullptr);
     worker_cmd_pools_.clear();
     vk::DestroyCommandPool(dev_, primary_cmd_pool_, nullptr);
 
-    for (auto &data : frame_data_) vk::DestroyFence(dev_, data.fence, nullptr);
+    for (auto &data : frame_data_) {
+        destroy_retired(data);
+        vk::DestroyFence(dev_, data.fence, nullptr);
+        if (data.sim_semaphore != VK_NULL_HANDLE) vk::DestroySemaphore(dev_, data.sim_semaphore, nullptr);
+        if (data.draw_semaphore != VK_NULL_HANDLE) vk::DestroySemaphore(dev_, data.draw_semaphore, nullptr);
+    }
+    sim_draw_semaphore_ = VK_NULL_HANDLE;
 
     frame_data_.clear();
 }
 
+void Hologram::destroy_retired(FrameData &data) {
+    for (auto fb : data.retired_fbs) vk::DestroyFramebuffer(dev_, fb, nullptr);
+    for (auto view : data.retired_views) vk::DestroyImageView(dev_, view, nullptr);
+
+    data.retired_fbs.clear();
+    data.retired_views.clear();
+}
+
 void Hologram::create_fences() {
     VkFenceCreateInfo fence_info = {};
     fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    for (auto &data : frame_data_) vk::assert_success(vk::CreateFence(dev_, &fence_info, nullptr, &data.fence));
+    VkSemaphoreCreateInfo sem_info = {};
+    sem_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    for (auto &data : frame_data_) {
+        vk::assert_success(vk::CreateFence(dev_, &fence_info, nullptr, &data.fence));
+
+        data.sim_semaphore = VK_NULL_HANDLE;
+        data.draw_semaphore = VK_NULL_HANDLE;
+        data.sim_submitted = false;
+        if (sim_queue_ != VK_NULL_HANDLE) {
+            vk::assert_success(vk::CreateSemaphore(dev_, &sem_info, nullptr, &data.sim_semaphore));
+            vk::assert_success(vk::CreateSemaphore(dev_, &sem_info, nullptr, &data.draw_semaphore));
+        }
+    }
+    sim_draw_semaphore_ = VK_NULL_HANDLE;
 }
 
 void Hologram::create_command_buffers() {
@@ -386,112 +771,147 @@ void Hologram::create_command_buffers() {
     cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
     cmd_pool_info.queueFamilyIndex = queue_family_;
 
-    VkCommandBufferAllocateInfo cmd_info = {};
-    cmd_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    cmd_info.commandBufferCount = static_cast<uint32_t>(frame_data_.size());
+    vk::assert_success(vk::CreateCommandPool(dev_, &cmd_pool_info, nullptr, &primary_cmd_pool_));
 
-    // create command pools and buffers
-    std::vector<VkCommandPool> cmd_pools(workers_.size() + 1, VK_NULL_HANDLE);
-    std::vector<std::vector<VkCommandBuffer>> cmds_vec(workers_.size() + 1,
-                                                       std::vector<VkCommandBuffer>(frame_data_.size(), VK_NULL_HANDLE));
-    for (size_t i = 0; i < cmd_pools.size(); i++) {
-        auto &cmd_pool = cmd_pools[i];
-        auto &cmds = cmds_vec[i];
+    // secondary command buffers are allocated by the workers on demand
+    const int worker_count = job_pool_->worker_count();
+    worker_cmd_pools_.resize(worker_count, VK_NULL_HANDLE);
+    for (auto &cmd_pool : worker_cmd_pools_) vk::assert_success(vk::CreateCommandPool(dev_, &cmd_pool_info, nullptr, &cmd_pool));
 
-        vk::assert_success(vk::CreateCommandPool(dev_, &cmd_pool_info, nullptr, &cmd_pool));
-
-        cmd_info.commandPool = cmd_pool;
-        cmd_info.level = (cmd_pool == cmd_pools.back()) ? VK_COMMAND_BUFFER_LEVEL_PRIMARY : VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    VkCommandBufferAllocateInfo cmd_info = {};
+    cmd_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cmd_info.commandPool = primary_cmd_pool_;
+    cmd_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmd_info.commandBufferCount = 1;
 
-        vk::assert_success(vk::AllocateCommandBuffers(dev_, &cmd_info, cmds.data()));
-    }
+    const size_t chunk_count = (sim_.objects().size() + object_chunk_size - 1) / object_chunk_size;
+    for (auto &data : frame_data_) {
+        vk::assert_success(vk::AllocateCommandBuffers(dev_, &cmd_info, &data.primary_cmd));
+        data.sim_cmd = VK_NULL_HANDLE;
+        if (sim_queue_ != VK_NULL_HANDLE) vk::assert_success(vk::AllocateCommandBuffers(dev_, &cmd_info, &data.sim_cmd));
 
-    // update frame_data_
-    for (size_t i = 0; i < frame_data_.size(); i++) {
-        for (const auto &cmds : cmds_vec) {
-            if (cmds == cmds_vec.back()) {
-                frame_data_[i].primary_cmd = cmds[i];
-            } else {
-                frame_data_[i].worker_cmds.push_back(cmds[i]);
-            }
-        }
+        data.worker_cmds.resize(worker_count);
+        data.worker_cmd_counts.resize(worker_count, 0);
+        data.chunk_cmds.resize(chunk_count, VK_NULL_HANDLE);
     }
-
-    primary_cmd_pool_ = cmd_pools.back();
-    cmd_pools.pop_back();
-    worker_cmd_pools_ = cmd_pools;
 }
 
 void Hologram::create_buffers() {
-    // align object data to device limit
-    const VkDeviceSize &alignment = physical_dev_props_.limits.minUniformBufferOffsetAlignment;
+    const uint32_t object_count = static_cast<uint32_t>(sim_.objects().size());
 
-    aligned_object_data_size = sizeof(ShaderParamBlock);
-    if (aligned_object_data_size % alignment) aligned_object_data_size += alignment - (aligned_object_data_size % alignment);
+    if (use_instancing_) {
+        // instances are tightly packed in a single storage buffer
+        aligned_object_data_size = sizeof(InstanceParamBlock);
+        objects_per_block_ = object_count;
+
+        prepare_instances();
+    } else {
+        // align object data to device limit
+        const VkDeviceSize &alignment = physical_dev_props_.limits.minUniformBufferOffsetAlignment;
+
+        aligned_object_data_size = sizeof(ShaderParamBlock);
+        if (aligned_object_data_size % alignment) aligned_object_data_size += alignment - (aligned_object_data_size % alignment);
+
+        // split objects into blocks, whose allocations hold all frames
+        const VkDeviceSize block_size = max_frame_data_block_size / frame_data_.size();
+        objects_per_block_ = static_cast<uint32_t>(std::max(block_size / aligned_object_data_size, VkDeviceSize(1)));
+        if (objects_per_block_ > object_count) objects_per_block_ = object_count;
+    }
+    const uint32_t block_count = (object_count + objects_per_block_ - 1) / objects_per_block_;
 
     // update simulation
     assert(aligned_object_data_size <= UINT32_MAX);
-    sim_.set_frame_data_size(static_cast<uint32_t>(aligned_object_data_size));
+    sim_.set_frame_data_size(static_cast<uint32_t>(aligned_object_data_size), objects_per_block_);
 
     VkBufferCreateInfo buf_info = {};
     buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    buf_info.size = aligned_object_data_size * sim_.objects().size();
-    buf_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    buf_info.usage = use_instancing_ ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
     buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    for (auto &data : frame_data_) vk::assert_success(vk::CreateBuffer(dev_, &buf_info, nullptr, &data.buf));
-}
-
-void Hologram::create_buffer_memory() {
-    VkMemoryRequirements mem_reqs;
-    vk::GetBufferMemoryRequirements(dev_, frame_data_[0].buf, &mem_reqs);
-
-    VkDeviceSize aligned_size = mem_reqs.size;
-    if (aligned_size % mem_reqs.alignment) aligned_size += mem_reqs.alignment - (aligned_size % mem_reqs.alignment);
-
-    // allocate memory
-    VkMemoryAllocateInfo mem_info = {};
-    mem_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    mem_info.allocationSize = aligned_size * (frame_data_.size() - 1) + mem_reqs.size;
+    for (auto &data : frame_data_) {
+        data.bufs.resize(block_count);
+        for (uint32_t block = 0; block < block_count; block++) {
+            const uint32_t block_object_count = std::min(objects_per_block_, object_count - block * objects_per_block_);
+            buf_info.size = aligned_object_data_size * block_object_count;
 
-    for (uint32_t idx = 0; idx < mem_flags_.size(); idx++) {
-        if ((mem_reqs.memoryTypeBits & (1 << idx)) && (mem_flags_[idx] & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
-            (mem_flags_[idx] & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
-            // TODO is this guaranteed to exist?
-            mem_info.memoryTypeIndex = idx;
-            break;
+            vk::assert_success(vk::CreateBuffer(dev_, &buf_info, nullptr, &data.bufs[block]));
         }
     }
+}
 
-    vk::AllocateMemory(dev_, &mem_info, nullptr, &frame_data_mem_);
+void Hologram::prepare_instances() {
+    const auto &objects = sim_.objects();
 
-    void *ptr;
-    vk::MapMemory(dev_, frame_data_mem_, 0, VK_WHOLE_SIZE, 0, &ptr);
+    // group objects by mesh type, and keep the object order within a group
+    instance_order_.resize(objects.size());
+    for (size_t i = 0; i < objects.size(); i++) instance_order_[i] = static_cast<int>(i);
+    std::stable_sort(instance_order_.begin(), instance_order_.end(),
+                     [&objects](int a, int b) { return objects[a].mesh < objects[b].mesh; });
 
-    VkDeviceSize offset = 0;
-    for (auto &data : frame_data_) {
-        vk::BindBufferMemory(dev_, data.buf, frame_data_mem_, offset);
-        data.base = reinterpret_cast<uint8_t *>(ptr) + offset;
-        offset += aligned_size;
+    first_instances_.assign(Meshes::MESH_COUNT, 0);
+    instance_counts_.assign(Meshes::MESH_COUNT, 0);
+    for (const auto &obj : objects) instance_counts_[obj.mesh]++;
+    for (int type = 1; type < Meshes::MESH_COUNT; type++)
+        first_instances_[type] = first_instances_[type - 1] + instance_counts_[type - 1];
+}
+
+void Hologram::create_buffer_memory() {
+    const size_t block_count = frame_data_[0].bufs.size();
+    frame_data_mems_.resize(block_count, VK_NULL_HANDLE);
+    for (auto &data : frame_data_) data.bases.resize(block_count);
+
+    // the same block of all frames share an allocation
+    for (size_t block = 0; block < block_count; block++) {
+        VkMemoryRequirements mem_reqs;
+        vk::GetBufferMemoryRequirements(dev_, frame_data_[0].bufs[block], &mem_reqs);
+
+        VkDeviceSize aligned_size = mem_reqs.size;
+        if (aligned_size % mem_reqs.alignment) aligned_size += mem_reqs.alignment - (aligned_size % mem_reqs.alignment);
+
+        // allocate memory
+        const VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        VkMemoryAllocateInfo mem_info = {};
+        mem_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        mem_info.allocationSize = aligned_size * (frame_data_.size() - 1) + mem_reqs.size;
+        mem_info.memoryTypeIndex = find_memory_type(mem_flags_, mem_reqs.memoryTypeBits, flags, flags);
+
+        VkDeviceMemory &mem = frame_data_mems_[block];
+        vk::assert_success(vk::AllocateMemory(dev_, &mem_info, nullptr, &mem));
+
+        void *ptr;
+        vk::assert_success(vk::MapMemory(dev_, mem, 0, VK_WHOLE_SIZE, 0, &ptr));
+
+        VkDeviceSize offset = 0;
+        for (auto &data : frame_data_) {
+            vk::BindBufferMemory(dev_, data.bufs[block], mem, offset);
+            data.bases[block] = reinterpret_cast<uint8_t *>(ptr) + offset;
+            offset += aligned_size;
+        }
     }
 }
 
 void Hologram::create_descriptor_sets() {
+    const size_t block_count = frame_data_[0].bufs.size();
+    const size_t set_count = frame_data_.size() * block_count;
+
+    const VkDescriptorType desc_type =
+        use_instancing_ ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+
     VkDescriptorPoolSize desc_pool_size = {};
-    desc_pool_size.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-    assert(frame_data_.size() <= UINT32_MAX);
-    desc_pool_size.descriptorCount = static_cast<uint32_t>(frame_data_.size());
+    desc_pool_size.type = desc_type;
+    assert(set_count <= UINT32_MAX);
+    desc_pool_size.descriptorCount = static_cast<uint32_t>(set_count);
 
     VkDescriptorPoolCreateInfo desc_pool_info = {};
     desc_pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    desc_pool_info.maxSets = static_cast<uint32_t>(frame_data_.size());
+    desc_pool_info.maxSets = static_cast<uint32_t>(set_count);
     desc_pool_info.poolSizeCount = 1;
     desc_pool_info.pPoolSizes = &desc_pool_size;
 
     // create descriptor pool
     vk::assert_success(vk::CreateDescriptorPool(dev_, &desc_pool_info, nullptr, &desc_pool_));
 
-    std::vector<VkDescriptorSetLayout> set_layouts(frame_data_.size(), desc_set_layout_);
+    std::vector<VkDescriptorSetLayout> set_layouts(set_count, desc_set_layout_);
     VkDescriptorSetAllocateInfo set_info = {};
     set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     set_info.descriptorPool = desc_pool_;
@@ -499,30 +919,34 @@ void Hologram::create_descriptor_sets() {
     set_info.pSetLayouts = set_layouts.data();
 
     // create descriptor sets
-    std::vector<VkDescriptorSet> desc_sets(frame_data_.size(), VK_NULL_HANDLE);
+    std::vector<VkDescriptorSet> desc_sets(set_count, VK_NULL_HANDLE);
     vk::assert_success(vk::AllocateDescriptorSets(dev_, &set_info, desc_sets.data()));
 
-    std::vector<VkDescriptorBufferInfo> desc_bufs(frame_data_.size());
-    std::vector<VkWriteDescriptorSet> desc_writes(frame_data_.size());
+    std::vector<VkDescriptorBufferInfo> desc_bufs(set_count);
+    std::vector<VkWriteDescriptorSet> desc_writes(set_count);
 
-    for (size_t i = 0; i < frame_data_.size(); i++) {
-        auto &data = frame_data_[i];
+    for (size_t i = 0; i < set_count; i++) {
+        auto &data = frame_data_[i / block_count];
+        const size_t block = i % block_count;
 
-        data.desc_set = desc_sets[i];
+        data.desc_sets.resize(block_count);
+        data.desc_sets[block] = desc_sets[i];
 
+        // each dynamic offset selects one object, which keeps the range
+        // within maxUniformBufferRange; instances are indexed in the shader
         VkDescriptorBufferInfo desc_buf = {};
-        desc_buf.buffer = data.buf;
+        desc_buf.buffer = data.bufs[block];
         desc_buf.offset = 0;
-        desc_buf.range = VK_WHOLE_SIZE;
+        desc_buf.range = use_instancing_ ? VK_WHOLE_SIZE : aligned_object_data_size;
         desc_bufs[i] = desc_buf;
 
         VkWriteDescriptorSet desc_write = {};
         desc_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        desc_write.dstSet = data.desc_set;
+        desc_write.dstSet = desc_sets[i];
         desc_write.dstBinding = 0;
         desc_write.dstArrayElement = 0;
         desc_write.descriptorCount = 1;
-        desc_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        desc_write.descriptorType = desc_type;
         desc_write.pBufferInfo = &desc_bufs[i];
         desc_writes[i] = desc_write;
     }
@@ -530,18 +954,402 @@ void Hologram::create_descriptor_sets() {
     vk::UpdateDescriptorSets(dev_, static_cast<uint32_t>(desc_writes.size()), desc_writes.data(), 0, nullptr);
 }
 
+void Hologram::create_camera_data() {
+    VkBufferCreateInfo buf_info = {};
+    buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buf_info.size = sizeof(CameraParamBlock);
+    buf_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    for (auto &data : frame_data_) vk::assert_success(vk::CreateBuffer(dev_, &buf_info, nullptr, &data.camera_buf));
+
+    VkMemoryRequirements mem_reqs;
+    vk::GetBufferMemoryRequirements(dev_, frame_data_[0].camera_buf, &mem_reqs);
+
+    VkDeviceSize aligned_size = mem_reqs.size;
+    if (aligned_size % mem_reqs.alignment) aligned_size += mem_reqs.alignment - (aligned_size % mem_reqs.alignment);
+
+    const VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VkMemoryAllocateInfo mem_info = {};
+    mem_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    mem_info.allocationSize = aligned_size * (frame_data_.size() - 1) + mem_reqs.size;
+    mem_info.memoryTypeIndex = find_memory_type(mem_flags_, mem_reqs.memoryTypeBits, flags, flags);
+    vk::assert_success(vk::AllocateMemory(dev_, &mem_info, nullptr, &camera_mem_));
+
+    void *ptr;
+    vk::assert_success(vk::MapMemory(dev_, camera_mem_, 0, VK_WHOLE_SIZE, 0, &ptr));
+
+    VkDeviceSize offset = 0;
+    for (auto &data : frame_data_) {
+        vk::assert_success(vk::BindBufferMemory(dev_, data.camera_buf, camera_mem_, offset));
+        data.camera_base = reinterpret_cast<uint8_t *>(ptr) + offset;
+        offset += aligned_size;
+    }
+
+    VkDescriptorPoolSize desc_pool_size = {};
+    desc_pool_size.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    desc_pool_size.descriptorCount = static_cast<uint32_t>(frame_data_.size());
+
+    VkDescriptorPoolCreateInfo desc_pool_info = {};
+    desc_pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    desc_pool_info.maxSets = static_cast<uint32_t>(frame_data_.size());
+    desc_pool_info.poolSizeCount = 1;
+    desc_pool_info.pPoolSizes = &desc_pool_size;
+    vk::assert_success(vk::CreateDescriptorPool(dev_, &desc_pool_info, nullptr, &camera_desc_pool_));
+
+    VkDescriptorSetAllocateInfo set_info = {};
+    set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    set_info.descriptorPool = camera_desc_pool_;
+    set_info.descriptorSetCount = 1;
+    set_info.pSetLayouts = &camera_desc_set_layout_;
+
+    for (auto &data : frame_data_) {
+        vk::assert_success(vk::AllocateDescriptorSets(dev_, &set_info, &data.camera_desc_set));
+
+        VkDescriptorBufferInfo desc_buf = {};
+        desc_buf.buffer = data.camera_buf;
+        desc_buf.offset = 0;
+        desc_buf.range = VK_WHOLE_SIZE;
+
+        VkWriteDescriptorSet desc_write = {};
+        desc_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        desc_write.dstSet = data.camera_desc_set;
+        desc_write.dstBinding = 0;
+        desc_write.dstArrayElement = 0;
+        desc_write.descriptorCount = 1;
+        desc_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        desc_write.pBufferInfo = &desc_buf;
+        vk::UpdateDescriptorSets(dev_, 1, &desc_write, 0, nullptr);
+    }
+}
+
+void Hologram::destroy_camera_data() {
+    vk::DestroyDescriptorPool(dev_, camera_desc_pool_, nullptr);
+
+    vk::UnmapMemory(dev_, camera_mem_);
+    vk::FreeMemory(dev_, camera_mem_, nullptr);
+
+    for (auto &data : frame_data_) vk::DestroyBuffer(dev_, data.camera_buf, nullptr);
+}
+
+void Hologram::create_simulation_pipeline() {
+    VkShaderModuleCreateInfo sh_info = {};
+    sh_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+#include "Hologram.sim.comp.h"
+    sh_info.codeSize = sizeof(Hologram_sim_comp);
+    sh_info.pCode = Hologram_sim_comp;
+    vk::assert_success(vk::CreateShaderModule(dev_, &sh_info, nullptr, &sim_cs_));
+
+    // states and instances
+    VkDescriptorSetLayoutBinding layout_bindings[2] = {};
+    for (uint32_t i = 0; i < 2; i++) {
+        layout_bindings[i].binding = i;
+        layout_bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        layout_bindings[i].descriptorCount = 1;
+        layout_bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layout_info = {};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = 2;
+    layout_info.pBindings = layout_bindings;
+    vk::assert_success(vk::CreateDescriptorSetLayout(dev_, &layout_info, nullptr, &sim_desc_set_layout_));
+
+    VkPushConstantRange push_const_range = {};
+    push_const_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_const_range.offset = 0;
+    push_const_range.size = sizeof(SimTickParams);
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info = {};
+    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts = &sim_desc_set_layout_;
+    pipeline_layout_info.pushConstantRangeCount = 1;
+    pipeline_layout_info.pPushConstantRanges = &push_const_range;
+    vk::assert_success(vk::CreatePipelineLayout(dev_, &pipeline_layout_info, nullptr, &sim_pipeline_layout_));
+
+    VkComputePipelineCreateInfo pipeline_info = {};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = sim_cs_;
+    pipeline_info.stage.pName = "main";
+    pipeline_info.layout = sim_pipeline_layout_;
+    vk::assert_success(vk::CreateComputePipelines(dev_, pipeline_cache_, 1, &pipeline_info, nullptr, &sim_pipeline_));
+}
+
+void Hologram::destroy_simulation_pipeline() {
+    vk::DestroyPipeline(dev_, sim_pipeline_, nullptr);
+    vk::DestroyPipelineLayout(dev_, sim_pipeline_layout_, nullptr);
+    vk::DestroyDescriptorSetLayout(dev_, sim_desc_set_layout_, nullptr);
+    vk::DestroyShaderModule(dev_, sim_cs_, nullptr);
+}
+
+void Hologram::create_staging_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer &buf, VkDeviceMemory &mem,
+                                     void **ptr) {
+    VkBufferCreateInfo buf_info = {};
+    buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buf_info.size = size;
+    buf_info.usage = usage;
+    buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    vk::assert_success(vk::CreateBuffer(dev_, &buf_info, nullptr, &buf));
+
+    VkMemoryRequirements mem_reqs;
+    vk::GetBufferMemoryRequirements(dev_, buf, &mem_reqs);
+
+    const VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VkMemoryAllocateInfo mem_info = {};
+    mem_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    mem_info.allocationSize = mem_reqs.size;
+    mem_info.memoryTypeIndex = find_memory_type(mem_flags_, mem_reqs.memoryTypeBits, flags, flags);
+    vk::assert_success(vk::AllocateMemory(dev_, &mem_info, nullptr, &mem));
+
+    vk::assert_success(vk::BindBufferMemory(dev_, buf, mem, 0));
+    vk::assert_success(vk::MapMemory(dev_, mem, 0, VK_WHOLE_SIZE, 0, ptr));
+}
+
+VkCommandBuffer Hologram::begin_one_time_commands() {
+    VkCommandBufferAllocateInfo cmd_info = {};
+    cmd_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cmd_info.commandPool = primary_cmd_pool_;
+    cmd_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmd_info.commandBufferCount = 1;
+
+    VkCommandBuffer cmd;
+    vk::assert_success(vk::AllocateCommandBuffers(dev_, &cmd_info, &cmd));
+
+    VkCommandBufferBeginInfo begin_info = {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vk::assert_success(vk::BeginCommandBuffer(cmd, &begin_info));
+
+    return cmd;
+}
+
+void Hologram::end_one_time_commands(VkCommandBuffer cmd) {
+    vk::assert_success(vk::EndCommandBuffer(cmd));
+
+    VkSubmitInfo submit_info = {};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &cmd;
+    vk::assert_success(vk::QueueSubmit(queue_, 1, &submit_info, VK_NULL_HANDLE));
+    vk::assert_success(vk::QueueWaitIdle(queue_));
+
+    vk::FreeCommandBuffers(dev_, primary_cmd_pool_, 1, &cmd);
+}
+
+void Hologram::create_simulation_buffers() {
+    prepare_instances();
+
+    const auto &objects = sim_.objects();
+    const VkDeviceSize state_size = sizeof(Simulation::PackedState) * objects.size();
+    const VkDeviceSize instance_size = sizeof(InstanceParamBlock) * objects.size();
+
+    VkBufferCreateInfo buf_info = {};
+    buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buf_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    buf_info.size = state_size;
+    vk::assert_success(vk::CreateBuffer(dev_, &buf_info, nullptr, &sim_state_buf_));
+    buf_info.size = instance_size;
+    vk::assert_success(vk::CreateBuffer(dev_, &buf_info, nullptr, &sim_instance_buf_));
+
+    VkMemoryRequirements state_reqs, instance_reqs;
+    vk::GetBufferMemoryRequirements(dev_, sim_state_buf_, &state_reqs);
+    vk::GetBufferMemoryRequirements(dev_, sim_instance_buf_, &instance_reqs);
+
+    VkDeviceSize instance_offset = state_reqs.size;
+    if (instance_offset % instance_reqs.alignment)
+        instance_offset += instance_reqs.alignment - (instance_offset % instance_reqs.alignment);
+
+    // never touched by the host after the upload
+    VkMemoryAllocateInfo mem_info = {};
+    mem_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    mem_info.allocationSize = instance_offset + instance_reqs.size;
+    mem_info.memoryTypeIndex = find_memory_type(mem_flags_, state_reqs.memoryTypeBits & instance_reqs.memoryTypeBits,
+                                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
+    vk::assert_success(vk::AllocateMemory(dev_, &mem_info, nullptr, &sim_mem_));
+
+    vk::assert_success(vk::BindBufferMemory(dev_, sim_state_buf_, sim_mem_, 0));
+    vk::assert_success(vk::BindBufferMemory(dev_, sim_instance_buf_, sim_mem_, instance_offset));
+
+    // upload initial states and instances
+    VkBuffer staging_buf;
+    VkDeviceMemory staging_mem;
+    void *ptr;
+    create_staging_buffer(state_size + instance_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, staging_buf, staging_mem, &ptr);
+
+    Simulation::PackedState *states = reinterpret_cast<Simulation::PackedState *>(ptr);
+    InstanceParamBlock *instances = reinterpret_cast<InstanceParamBlock *>(reinterpret_cast<uint8_t *>(ptr) + state_size);
+    for (size_t i = 0; i < instance_order_.size(); i++) {
+        const auto &obj = objects[instance_order_[i]];
+
+        sim_.pack_state(instance_order_[i], states[i]);
+        pack_instance(obj, obj.model, sim_fade_ ? obj.alpha : 0.5f, instances[i]);
+    }
+
+    VkCommandBuffer cmd = begin_one_time_commands();
+
+    VkBufferCopy region = {};
+    region.size = state_size;
+    vk::CmdCopyBuffer(cmd, staging_buf, sim_state_buf_, 1, &region);
+    region.srcOffset = state_size;
+    region.size = instance_size;
+    vk::CmdCopyBuffer(cmd, staging_buf, sim_instance_buf_, 1, &region);
+
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    const VkPipelineStageFlags dst_stages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    vk::CmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, dst_stages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    end_one_time_commands(cmd);
+
+    vk::UnmapMemory(dev_, staging_mem);
+    vk::DestroyBuffer(dev_, staging_buf, nullptr);
+    vk::FreeMemory(dev_, staging_mem, nullptr);
+}
+
+void Hologram::destroy_simulation_buffers() {
+    vk::DestroyBuffer(dev_, sim_instance_buf_, nullptr);
+    vk::DestroyBuffer(dev_, sim_state_buf_, nullptr);
+    vk::FreeMemory(dev_, sim_mem_, nullptr);
+}
+
+void Hologram::create_simulation_descriptor_sets() {
+    // one set for rendering and one for the simulation
+    VkDescriptorPoolSize desc_pool_size = {};
+    desc_pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    desc_pool_size.descriptorCount = 3;
+
+    VkDescriptorPoolCreateInfo desc_pool_info = {};
+    desc_pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    desc_pool_info.maxSets = 2;
+    desc_pool_info.poolSizeCount = 1;
+    desc_pool_info.pPoolSizes = &desc_pool_size;
+    vk::assert_success(vk::CreateDescriptorPool(dev_, &desc_pool_info, nullptr, &desc_pool_));
+
+    const VkDescriptorSetLayout set_layouts[2] = {desc_set_layout_, sim_desc_set_layout_};
+    VkDescriptorSetAllocateInfo set_info = {};
+    set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    set_info.descriptorPool = desc_pool_;
+    set_info.descriptorSetCount = 2;
+    set_info.pSetLayouts = set_layouts;
+
+    VkDescriptorSet desc_sets[2];
+    vk::assert_success(vk::AllocateDescriptorSets(dev_, &set_info, desc_sets));
+
+    VkDescriptorBufferInfo desc_bufs[3] = {};
+    desc_bufs[0].buffer = sim_instance_buf_;
+    desc_bufs[1].buffer = sim_state_buf_;
+    desc_bufs[2].buffer = sim_instance_buf_;
+
+    VkWriteDescriptorSet desc_writes[3] = {};
+    for (int i = 0; i < 3; i++) {
+        desc_bufs[i].offset = 0;
+        desc_bufs[i].range = VK_WHOLE_SIZE;
+
+        desc_writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        desc_writes[i].dstSet = (i == 0) ? desc_sets[0] : desc_sets[1];
+        desc_writes[i].dstBinding = (i == 2) ? 1 : 0;
+        desc_writes[i].descriptorCount = 1;
+        desc_writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        desc_writes[i].pBufferInfo = &desc_bufs[i];
+    }
+    vk::UpdateDescriptorSets(dev_, 3, desc_writes, 0, nullptr);
+
+    // all frames draw the same instances
+    for (auto &data : frame_data_) data.desc_sets.assign(1, desc_sets[0]);
+    sim_desc_set_ = desc_sets[1];
+}
+
+void Hologram::check_simulation() {
+    const auto &objects = sim_.objects();
+    const VkDeviceSize state_size = sizeof(Simulation::PackedState) * objects.size();
+    const VkDeviceSize instance_size = sizeof(InstanceParamBlock) * objects.size();
+
+    VkBuffer readback_buf;
+    VkDeviceMemory readback_mem;
+    void *ptr;
+    create_staging_buffer(state_size + instance_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, readback_buf, readback_mem, &ptr);
+
+    VkCommandBuffer cmd = begin_one_time_commands();
+
+    // catch up with the CPU
+    if (sim_pending_ticks_) dispatch_simulation(cmd);
+
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vk::CmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0,
+                           nullptr);
+
+    VkBufferCopy region = {};
+    region.size = state_size;
+    vk::CmdCopyBuffer(cmd, sim_state_buf_, readback_buf, 1, &region);
+    region.dstOffset = state_size;
+    region.size = instance_size;
+    vk::CmdCopyBuffer(cmd, sim_instance_buf_, readback_buf, 1, &region);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vk::CmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    end_one_time_commands(cmd);
+
+    // alphas are compared in the states since the instances may not fade
+    const Simulation::PackedState *states = reinterpret_cast<const Simulation::PackedState *>(ptr);
+    const InstanceParamBlock *instances =
+        reinterpret_cast<const InstanceParamBlock *>(reinterpret_cast<const uint8_t *>(ptr) + state_size);
+    float max_error = 0.0f;
+    size_t mismatch_count = 0;
+    for (size_t i = 0; i < instance_order_.size(); i++) {
+        const auto &obj = objects[instance_order_[i]];
+
+        float error = std::abs(states[i].alpha - obj.alpha);
+        for (int col = 0; col < 4; col++) {
+            for (int row = 0; row < 3; row++) {
+                float diff = std::abs(instances[i].model[4 * col + row] - obj.model[col][row]);
+                // origins wrap around at 2.0, maybe on different ticks
+                if (col == 3) diff = std::min(diff, std::abs(2.0f - diff));
+
+                error = std::max(error, diff);
+            }
+        }
+
+        max_error = std::max(max_error, error);
+        if (error > sim_check_tolerance) mismatch_count++;
+    }
+
+    vk::UnmapMemory(dev_, readback_mem);
+    vk::DestroyBuffer(dev_, readback_buf, nullptr);
+    vk::FreeMemory(dev_, readback_mem, nullptr);
+
+    std::stringstream ss;
+    ss << "GPU simulation after " << sim_tick_count_ << " ticks: max error " << max_error << ", " << mismatch_count << " of "
+       << objects.size() << " objects off by more than " << sim_check_tolerance;
+    shell_->log(mismatch_count ? Shell::LOG_WARN : Shell::LOG_INFO, ss.str().c_str());
+}
+
 void Hologram::attach_swapchain() {
     const Shell::Context &ctx = shell_->context();
 
     prepare_viewport(ctx.extent);
-    prepare_framebuffers(ctx.swapchain);
+    prepare_framebuffers(ctx.images);
 
     update_camera();
 }
 
 void Hologram::detach_swapchain() {
-    for (auto fb : framebuffers_) vk::DestroyFramebuffer(dev_, fb, nullptr);
-    for (auto view : image_views_) vk::DestroyImageView(dev_, view, nullptr);
+    // Frames are waited for in order, so the one submitted last is the last
+    // to be waited for again.  By then all frames using the framebuffers have
+    // completed.
+    auto &data = frame_data_[(frame_data_index_ + frame_data_.size() - 1) % frame_data_.size()];
+    data.retired_fbs.insert(data.retired_fbs.end(), framebuffers_.begin(), framebuffers_.end());
+    data.retired_views.insert(data.retired_views.end(), image_views_.begin(), image_views_.end());
 
     framebuffers_.clear();
     image_views_.clear();
@@ -562,9 +1370,8 @@ void Hologram::prepare_viewport(const VkExtent2D &extent) {
     scissor_.extent = extent_;
 }
 
-void Hologram::prepare_framebuffers(VkSwapchainKHR swapchain) {
-    // get swapchain images
-    vk::get(dev_, swapchain, images_);
+void Hologram::prepare_framebuffers(const std::vector<VkImage> &images) {
+    images_ = images;
 
     assert(framebuffers_.empty());
     image_views_.reserve(images_.size());
@@ -610,45 +1417,95 @@ void Hologram::update_camera() {
     const glm::mat4 clip(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.5f, 0.0f, 0.0f, 0.0f, 0.5f, 1.0f);
 
     camera_.view_projection = clip * projection * view;
+    camera_.pixel_scale = projection[1][1] * static_cast<float>(extent_.height) * 0.5f;
+    camera_.frustum = Frustum(camera_.view_projection, camera_.pixel_scale, min_object_pixel_size);
 }
 
-void Hologram::draw_object(const Simulation::Object &obj, FrameData &data, VkCommandBuffer cmd) const {
+void Hologram::get_object_state(int index, glm::mat4 &model, float &alpha) const {
+    if (sim_snapshot_) {
+        const auto &prev = sim_snapshot_->prev[index];
+        const auto &cur = sim_snapshot_->cur[index];
+
+        // blend the matrices; close enough between consecutive ticks, except
+        // when a path origin wraps around
+        if (glm::distance(glm::vec3(prev.model[3]), glm::vec3(cur.model[3])) < 1.0f) {
+            model = prev.model + (cur.model - prev.model) * sim_blend_;
+            alpha = prev.alpha + (cur.alpha - prev.alpha) * sim_blend_;
+        } else {
+            model = cur.model;
+            alpha = cur.alpha;
+        }
+    } else {
+        const auto &obj = sim_.objects()[index];
+        model = obj.model;
+        alpha = obj.alpha;
+    }
+
+    if (!sim_fade_) alpha = 0.5f;
+}
+
+uint32_t Hologram::select_lod(Meshes::Type type, const glm::mat4 &model) const {
+    const float scale = glm::length(glm::vec3(model[0]));
+    const glm::vec4 pos = model[3];
+    const glm::mat4 &vp = camera_.view_projection;
+    const float w = vp[0][3] * pos.x + vp[1][3] * pos.y + vp[2][3] * pos.z + vp[3][3] * pos.w;
+
+    // too close to tell
+    if (w <= meshes_->radius(type) * scale) return 0;
+
+    const float pixels_per_unit = scale * camera_.pixel_scale / w;
+    uint32_t lod = 0;
+    while (lod + 1 < meshes_->lod_count(type) && meshes_->lod_error(type, lod + 1) * pixels_per_unit < max_lod_pixel_error) lod++;
+
+    return lod;
+}
+
+uint32_t Hologram::draw_object(int index, const glm::mat4 &model, float alpha, FrameData &data, VkCommandBuffer cmd) const {
+    const auto &obj = sim_.objects()[index];
+
     if (use_push_constants_) {
         ShaderParamBlock params;
-        memcpy(params.light_pos, glm::value_ptr(obj.light_pos), sizeof(obj.light_pos));
-        memcpy(params.light_color, glm::value_ptr(obj.light_color), sizeof(obj.light_color));
-        memcpy(params.model, glm::value_ptr(obj.model), sizeof(obj.model));
-        memcpy(params.view_projection, glm::value_ptr(camera_.view_projection), sizeof(camera_.view_projection));
-        params.alpha = sim_fade_ ? obj.alpha : 0.5f;
+        pack_params(obj, model, alpha, params);
 
         vk::CmdPushConstants(cmd, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(params), &params);
     } else {
-        ShaderParamBlock *params = reinterpret_cast<ShaderParamBlock *>(data.base + obj.frame_data_offset);
-        memcpy(params->light_pos, glm::value_ptr(obj.light_pos), sizeof(obj.light_pos));
-        memcpy(params->light_color, glm::value_ptr(obj.light_color), sizeof(obj.light_color));
-        memcpy(params->model, glm::value_ptr(obj.model), sizeof(obj.model));
-        memcpy(params->view_projection, glm::value_ptr(camera_.view_projection), sizeof(camera_.view_projection));
-        params->alpha = sim_fade_ ? obj.alpha : 0.5f;
-
-        vk::CmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 1, &data.desc_set, 1,
-                                  &obj.frame_data_offset);
+        // params are written by draw_objects
+        vk::CmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 1, 1,
+                                  &data.desc_sets[obj.frame_data_block], 1, &obj.frame_data_offset);
     }
 
-    meshes_->cmd_draw(cmd, obj.mesh);
-}
+    const uint32_t lod = use_lod_ ? select_lod(obj.mesh, model) : meshes_->default_lod(obj.mesh);
+    meshes_->cmd_draw(cmd, obj.mesh, lod);
 
-void Hologram::update_simulation(const Worker &worker) {
-    sim_.update(worker.tick_interval_, worker.object_begin_, worker.object_end_);
+    return meshes_->triangle_count(obj.mesh, lod);
 }
 
-void Hologram::draw_objects(Worker &worker) {
-    auto &data = frame_data_[frame_data_index_];
-    auto cmd = data.worker_cmds[worker.index_];
+void Hologram::update_simulation(int begin, int end) { sim_.update(tick_interval_, begin, end); }
+
+void Hologram::draw_objects(FrameData &data, int worker, int begin, int end) {
+    Profiler::Timer timer(shell_->profiler(), Profiler::SCOPE_RECORD, Profiler::TRACK_WORKER + worker);
+
+    // grab the next secondary command buffer of this worker
+    auto &cmds = data.worker_cmds[worker];
+    auto &cmd_count = data.worker_cmd_counts[worker];
+    if (cmd_count == cmds.size()) {
+        VkCommandBufferAllocateInfo cmd_info = {};
+        cmd_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cmd_info.commandPool = worker_cmd_pools_[worker];
+        cmd_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        cmd_info.commandBufferCount = 1;
+
+        VkCommandBuffer cmd;
+        vk::assert_success(vk::AllocateCommandBuffers(dev_, &cmd_info, &cmd));
+        cmds.push_back(cmd);
+    }
+    auto cmd = cmds[cmd_count++];
+    data.chunk_cmds[begin / object_chunk_size] = cmd;
 
     VkCommandBufferInheritanceInfo inherit_info = {};
     inherit_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
     inherit_info.renderPass = render_pass_;
-    inherit_info.framebuffer = worker.fb_;
+    inherit_info.framebuffer = data.fb;
 
     VkCommandBufferBeginInfo begin_info = {};
     begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -661,18 +1518,160 @@ void Hologram::draw_objects(Worker &worker) {
     vk::CmdSetScissor(cmd, 0, 1, &scissor_);
 
     vk::CmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
+    vk::CmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 1, &data.camera_desc_set, 0, nullptr);
 
     meshes_->cmd_bind_buffers(cmd);
 
-    for (int i = worker.object_begin_; i < worker.object_end_; i++) {
-        auto &obj = sim_.objects()[i];
+    const int count = end - begin;
+    assert(count <= object_chunk_size);
+
+    std::array<glm::mat4, object_chunk_size> models;
+    std::array<float, object_chunk_size> alphas;
+    for (int i = 0; i < count; i++) get_object_state(begin + i, models[i], alphas[i]);
+
+    // The buffer keeps the params of the last write, and objects culled now
+    // may be visible in a later frame that does not write them.
+    if (!use_push_constants_ && data.params_dirty) {
+        for (int i = 0; i < count; i++) {
+            const auto &obj = sim_.objects()[begin + i];
+            ShaderParamBlock *params =
+                reinterpret_cast<ShaderParamBlock *>(data.bases[obj.frame_data_block] + obj.frame_data_offset);
+            pack_params(obj, models[i], alphas[i], *params);
+        }
+        upload_bytes_ += sizeof(ShaderParamBlock) * count;
+    }
 
-        draw_object(obj, data, cmd);
+    std::array<int, object_chunk_size> visible;
+    int visible_count = count;
+    if (use_culling_) {
+        std::array<float, object_chunk_size> xs, ys, zs, radii;
+        for (int i = 0; i < count; i++) {
+            const glm::mat4 &model = models[i];
+            xs[i] = model[3].x;
+            ys[i] = model[3].y;
+            zs[i] = model[3].z;
+            radii[i] = meshes_->radius(sim_.objects()[begin + i].mesh) * glm::length(glm::vec3(model[0]));
+        }
+
+        const Frustum::Spheres spheres = {xs.data(), ys.data(), zs.data(), radii.data()};
+        visible_count = camera_.frustum.cull(spheres, count, visible.data());
+    } else {
+        for (int i = 0; i < count; i++) visible[i] = i;
     }
 
+    uint64_t triangle_count = 0;
+    for (int i = 0; i < visible_count; i++) {
+        const int v = visible[i];
+        triangle_count += draw_object(begin + v, models[v], alphas[v], data, cmd);
+    }
+
+    triangle_count_ += triangle_count;
+    visible_count_ += visible_count;
+    culled_count_ += count - visible_count;
+
     vk::EndCommandBuffer(cmd);
 }
 
+void Hologram::write_instances(FrameData &data, int worker, int begin, int end) {
+    Profiler::Timer timer(shell_->profiler(), Profiler::SCOPE_RECORD, Profiler::TRACK_WORKER + worker);
+
+    InstanceParamBlock *params = reinterpret_cast<InstanceParamBlock *>(data.bases[0]);
+    for (int i = begin; i < end; i++) {
+        const int index = instance_order_[i];
+        glm::mat4 model;
+        float alpha;
+
+        get_object_state(index, model, alpha);
+        pack_instance(sim_.objects()[index], model, alpha, params[i]);
+    }
+
+    upload_bytes_ += sizeof(InstanceParamBlock) * (end - begin);
+}
+
+void Hologram::draw_instances(FrameData &data) {
+    VkCommandBuffer cmd = data.primary_cmd;
+
+    vk::CmdSetViewport(cmd, 0, 1, &viewport_);
+    vk::CmdSetScissor(cmd, 0, 1, &scissor_);
+
+    vk::CmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
+    vk::CmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 1, &data.desc_sets[0], 0, nullptr);
+    vk::CmdPushConstants(cmd, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(camera_.view_projection),
+                         glm::value_ptr(camera_.view_projection));
+
+    meshes_->cmd_bind_buffers(cmd);
+
+    // instances are not culled
+    visible_count_ += sim_.objects().size();
+
+    // one draw per mesh type
+    for (int type = 0; type < Meshes::MESH_COUNT; type++) {
+        if (!instance_counts_[type]) continue;
+
+        const Meshes::Type mesh_type = static_cast<Meshes::Type>(type);
+        meshes_->cmd_draw_instanced(cmd, mesh_type, instance_counts_[type], first_instances_[type]);
+        const uint32_t triangle_count = meshes_->triangle_count(mesh_type, meshes_->default_lod(mesh_type));
+        triangle_count_ += static_cast<uint64_t>(instance_counts_[type]) * triangle_count;
+    }
+}
+
+void Hologram::dispatch_simulation(VkCommandBuffer cmd) {
+    SimTickParams params;
+    params.time = tick_interval_;
+    params.count = static_cast<uint32_t>(sim_.objects().size());
+    params.fade = sim_fade_;
+
+    vk::CmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, sim_pipeline_);
+    vk::CmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, sim_pipeline_layout_, 0, 1, &sim_desc_set_, 0, nullptr);
+    vk::CmdPushConstants(cmd, sim_pipeline_layout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+
+    // every tick depends on the last one, and the first one also waits for
+    // earlier draws to stop reading the instances
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    const uint32_t group_count = (params.count + sim_group_size - 1) / sim_group_size;
+    VkPipelineStageFlags src_stages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    for (uint32_t tick = 0; tick < sim_pending_ticks_; tick++) {
+        vk::CmdPipelineBarrier(cmd, src_stages, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        vk::CmdDispatch(cmd, group_count, 1, 1);
+        src_stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    }
+    sim_pending_ticks_ = 0;
+
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vk::CmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &barrier, 0,
+                           nullptr, 0, nullptr);
+}
+
+void Hologram::submit_simulation(FrameData &data) {
+    vk::assert_success(vk::BeginCommandBuffer(data.sim_cmd, &primary_cmd_begin_info_));
+    dispatch_simulation(data.sim_cmd);
+    vk::assert_success(vk::EndCommandBuffer(data.sim_cmd));
+
+    // the first tick overwrites instances the last draws read
+    const VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    VkSubmitInfo submit_info = {};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    if (sim_draw_semaphore_ != VK_NULL_HANDLE) {
+        submit_info.waitSemaphoreCount = 1;
+        submit_info.pWaitSemaphores = &sim_draw_semaphore_;
+        submit_info.pWaitDstStageMask = &wait_stage;
+    }
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &data.sim_cmd;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &data.sim_semaphore;
+    vk::assert_success(vk::QueueSubmit(sim_queue_, 1, &submit_info, VK_NULL_HANDLE));
+
+    sim_draw_semaphore_ = VK_NULL_HANDLE;
+    data.sim_submitted = true;
+    sim_submit_count_++;
+}
+
 void Hologram::on_key(Key key) {
     switch (key) {
         case KEY_SHUTDOWN:
@@ -701,141 +1700,208 @@ void Hologram::on_key(Key key) {
 void Hologram::on_tick() {
     if (sim_paused_) return;
 
-    for (auto &worker : workers_) worker->update_simulation();
+    sim_tick_count_++;
+
+    if (sim_thread_) {
+        sim_thread_->request_tick();
+        return;
+    }
+
+    // the CPU simulation is only a reference for the GPU one
+    if (use_gpu_simulation_) {
+        sim_pending_ticks_++;
+        if (!settings_.gpu_simulation_check) return;
+    }
+
+    job_pool_->run(0, static_cast<int>(sim_.objects().size()), object_chunk_size,
+                   [this](int worker, int begin, int end) {
+                       Profiler::Timer timer(shell_->profiler(), Profiler::SCOPE_SIMULATE, Profiler::TRACK_WORKER + worker);
+                       update_simulation(begin, end);
+                   });
 }
 
 void Hologram::on_frame(float frame_pred) {
     auto &data = frame_data_[frame_data_index_];
+    Profiler &profiler = shell_->profiler();
 
     // wait for the last submission since we reuse frame data
-    vk::assert_success(vk::WaitForFences(dev_, 1, &data.fence, true, UINT64_MAX));
-    vk::assert_success(vk::ResetFences(dev_, 1, &data.fence));
+    {
+        Profiler::Timer timer(profiler, Profiler::SCOPE_FENCE_WAIT);
+        const double wait_begin = profiler.now();
+        vk::assert_success(vk::WaitForFences(dev_, 1, &data.fence, true, UINT64_MAX));
+        shell_->add_blocked_time(profiler.now() - wait_begin);
+        vk::assert_success(vk::ResetFences(dev_, 1, &data.fence));
+    }
+    destroy_retired(data);
+
+    // the GPU time is placed at the submission on the CPU timeline
+    const uint32_t query = 2 * frame_data_index_;
+    if (data.query_pending) {
+        uint64_t timestamps[2];
+        if (vk::GetQueryPoolResults(dev_, query_pool_, query, 2, sizeof(timestamps), timestamps, sizeof(timestamps[0]),
+                                    VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+            const double ticks = static_cast<double>((timestamps[1] - timestamps[0]) & timestamp_mask_);
+            const double gpu_time = ticks * physical_dev_props_.limits.timestampPeriod * 1e-9;
+            profiler.add(Profiler::SCOPE_GPU, data.submit_time, data.submit_time + gpu_time, Profiler::TRACK_GPU);
+            profile_gpu_time_ += gpu_time;
+            profile_gpu_frame_count_++;
+        }
+        data.query_pending = false;
+    }
 
     const Shell::BackBuffer &back = shell_->context().acquired_back_buffer;
+    data.fb = framebuffers_[back.image_index];
+    for (auto &count : data.worker_cmd_counts) count = 0;
+
+    if (sim_thread_) {
+        // draw between the last two ticks the sim thread finished, as far
+        // along as the shell is into the current tick
+        sim_snapshot_ = &sim_thread_->acquire();
+        sim_blend_ = sim_paused_ ? 1.0f : std::min(std::max(frame_pred, 0.0f), 1.0f);
+    }
 
-    // ignore frame_pred
-    for (auto &worker : workers_) worker->draw_objects(framebuffers_[back.image_index]);
-
-    VkResult res = vk::BeginCommandBuffer(data.primary_cmd, &primary_cmd_begin_info_);
-
-    if (!use_push_constants_) {
-        VkBufferMemoryBarrier buf_barrier = {};
-        buf_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-        buf_barrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
-        buf_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        buf_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        buf_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        buf_barrier.buffer = data.buf;
-        buf_barrier.offset = 0;
-        buf_barrier.size = VK_WHOLE_SIZE;
-        vk::CmdPipelineBarrier(data.primary_cmd, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 0, nullptr, 1,
-                               &buf_barrier, 0, nullptr);
-    }
-
-    render_pass_begin_info_.framebuffer = framebuffers_[back.image_index];
-    render_pass_begin_info_.renderArea.extent = extent_;
-    vk::CmdBeginRenderPass(data.primary_cmd, &render_pass_begin_info_, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    // object params only change when the simulation ticks, unless they are
+    // interpolated
+    data.params_dirty = (sim_thread_ || data.params_tick != sim_tick_count_ || data.params_fade != sim_fade_);
+    data.params_tick = sim_tick_count_;
+    data.params_fade = sim_fade_;
 
-    // record render pass commands
-    for (auto &worker : workers_) worker->wait_idle();
-    vk::CmdExecuteCommands(data.primary_cmd, static_cast<uint32_t>(data.worker_cmds.size()), data.worker_cmds.data());
+    if (!use_instancing_) {
+        CameraParamBlock *camera = reinterpret_cast<CameraParamBlock *>(data.camera_base);
+        memcpy(camera->view_projection, glm::value_ptr(camera_.view_projection), sizeof(camera_.view_projection));
+        upload_bytes_ += sizeof(CameraParamBlock);
+    }
+    profile_frame_count_++;
 
-    vk::CmdEndRenderPass(data.primary_cmd);
-    vk::EndCommandBuffer(data.primary_cmd);
+    VkResult res = vk::BeginCommandBuffer(data.primary_cmd, &primary_cmd_begin_info_);
 
-    // wait for the image to be owned and signal for render completion
-    primary_cmd_submit_info_.pWaitSemaphores = &back.acquire_semaphore;
-    primary_cmd_submit_info_.pCommandBuffers = &data.primary_cmd;
-    primary_cmd_submit_info_.pSignalSemaphores = &back.render_semaphore;
+    if (gpu_timing_) {
+        vk::CmdResetQueryPool(data.primary_cmd, query_pool_, query, 2);
+        vk::CmdWriteTimestamp(data.primary_cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool_, query);
+    }
 
-    res = vk::QueueSubmit(queue_, 1, &primary_cmd_submit_info_, data.fence);
+    std::vector<VkBuffer> host_bufs(data.bufs);
+    if (!use_instancing_) host_bufs.push_back(data.camera_buf);
+    if (!host_bufs.empty()) {
+        std::vector<VkBufferMemoryBarrier> buf_barriers(host_bufs.size());
+        for (size_t i = 0; i < host_bufs.size(); i++) {
+            VkBufferMemoryBarrier &buf_barrier = buf_barriers[i];
+            buf_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            buf_barrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
+            buf_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            buf_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            buf_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            buf_barrier.buffer = host_bufs[i];
+            buf_barrier.offset = 0;
+            buf_barrier.size = VK_WHOLE_SIZE;
+        }
+        vk::CmdPipelineBarrier(data.primary_cmd, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 0, nullptr,
+                               static_cast<uint32_t>(buf_barriers.size()), buf_barriers.data(), 0, nullptr);
+    }
 
-    frame_data_index_ = (frame_data_index_ + 1) % frame_data_.size();
+    data.sim_submitted = false;
+    if (sim_pending_ticks_) {
+        if (sim_queue_ != VK_NULL_HANDLE)
+            submit_simulation(data);
+        else
+            dispatch_simulation(data.primary_cmd);
+    }
 
-    (void)res;
-}
+    render_pass_begin_info_.framebuffer = data.fb;
+    render_pass_begin_info_.renderArea.extent = extent_;
 
-Hologram::Worker::Worker(Hologram &hologram, int index, int object_begin, int object_end)
-    : hologram_(hologram),
-      index_(index),
-      object_begin_(object_begin),
-      object_end_(object_end),
-      tick_interval_(1.0f / hologram.settings_.ticks_per_second),
-      state_(INIT) {}
+    if (use_instancing_) {
+        // write instance data; ignore frame_pred
+        if (!use_gpu_simulation_ && data.params_dirty) {
+            job_pool_->run(0, static_cast<int>(sim_.objects().size()), object_chunk_size,
+                           [this, &data](int worker, int begin, int end) { write_instances(data, worker, begin, end); });
+        }
 
-void Hologram::Worker::start() {
-    state_ = IDLE;
-    thread_ = std::thread(Hologram::Worker::thread_loop, this);
-}
+        vk::CmdBeginRenderPass(data.primary_cmd, &render_pass_begin_info_, VK_SUBPASS_CONTENTS_INLINE);
+        draw_instances(data);
+    } else {
+        vk::CmdBeginRenderPass(data.primary_cmd, &render_pass_begin_info_, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-void Hologram::Worker::stop() {
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        state_ = INIT;
+        // record render pass commands; ignore frame_pred
+        job_pool_->run(0, static_cast<int>(sim_.objects().size()), object_chunk_size,
+                       [this, &data](int worker, int begin, int end) { draw_objects(data, worker, begin, end); });
+        vk::CmdExecuteCommands(data.primary_cmd, static_cast<uint32_t>(data.chunk_cmds.size()), data.chunk_cmds.data());
     }
-    state_cv_.notify_one();
 
-    thread_.join();
-}
-
-void Hologram::Worker::update_simulation() {
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        bool started = (state_ != INIT);
+    vk::CmdEndRenderPass(data.primary_cmd);
+    if (gpu_timing_) vk::CmdWriteTimestamp(data.primary_cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool_, query + 1);
+    vk::EndCommandBuffer(data.primary_cmd);
 
-        state_ = STEP;
+    // wait for the image to be owned and signal for render completion
+    std::array<VkSemaphore, 3> wait_semaphores;
+    std::array<VkPipelineStageFlags, 3> wait_stages;
+    uint32_t wait_count = 0;
+    wait_semaphores[wait_count] = back.acquire_semaphore;
+    wait_stages[wait_count++] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+    std::array<VkSemaphore, 2> signal_semaphores;
+    uint32_t signal_count = 0;
+    signal_semaphores[signal_count++] = back.render_semaphore;
+
+    if (sim_queue_ != VK_NULL_HANDLE) {
+        // wait for the instances to be written
+        if (data.sim_submitted) {
+            wait_semaphores[wait_count] = data.sim_semaphore;
+            wait_stages[wait_count++] = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+        }
 
-        // step directly
-        if (!started) {
-            hologram_.update_simulation(*this);
-            state_ = INIT;
+        // every signal must be waited for before the next one; the draws
+        // are ordered on queue_ anyway
+        if (sim_draw_semaphore_ != VK_NULL_HANDLE) {
+            wait_semaphores[wait_count] = sim_draw_semaphore_;
+            wait_stages[wait_count++] = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
         }
+
+        signal_semaphores[signal_count++] = data.draw_semaphore;
+        sim_draw_semaphore_ = data.draw_semaphore;
     }
-    state_cv_.notify_one();
-}
 
-void Hologram::Worker::draw_objects(VkFramebuffer fb) {
-    // wait for step_objects first
-    wait_idle();
+    primary_cmd_submit_info_.waitSemaphoreCount = wait_count;
+    primary_cmd_submit_info_.pWaitSemaphores = wait_semaphores.data();
+    primary_cmd_submit_info_.pWaitDstStageMask = wait_stages.data();
+    primary_cmd_submit_info_.pCommandBuffers = &data.primary_cmd;
+    primary_cmd_submit_info_.signalSemaphoreCount = signal_count;
+    primary_cmd_submit_info_.pSignalSemaphores = signal_semaphores.data();
 
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        bool started = (state_ != INIT);
-
-        fb_ = fb;
-        state_ = DRAW;
-
-        // render directly
-        if (!started) {
-            hologram_.draw_objects(*this);
-            state_ = INIT;
-        }
+        Profiler::Timer timer(profiler, Profiler::SCOPE_SUBMIT);
+        data.submit_time = profiler.now();
+        res = vk::QueueSubmit(queue_, 1, &primary_cmd_submit_info_, data.fence);
     }
-    state_cv_.notify_one();
-}
+    data.query_pending = gpu_timing_;
 
-void Hologram::Worker::wait_idle() {
-    std::unique_lock<std::mutex> lock(mutex_);
-    bool started = (state_ != INIT);
+    frame_data_index_ = (frame_data_index_ + 1) % frame_data_.size();
 
-    if (started) state_cv_.wait(lock, [this] { return (state_ == IDLE); });
+    (void)res;
 }
 
-void Hologram::Worker::update_loop() {
-    while (true) {
-        std::unique_lock<std::mutex> lock(mutex_);
-
-        state_cv_.wait(lock, [this] { return (state_ != IDLE); });
-        if (state_ == INIT) break;
-
-        assert(state_ == STEP || state_ == DRAW);
-        if (state_ == STEP)
-            hologram_.update_simulation(*this);
-        else
-            hologram_.draw_objects(*this);
-
-        state_ = IDLE;
-        lock.unlock();
-        state_cv_.notify_one();
+void Hologram::on_profile(std::ostream &os) {
+    os << ", " << job_pool_->steal_count() << "/" << job_pool_->chunk_count() << " chunks stolen";
+    if (sim_queue_ != VK_NULL_HANDLE) os << ", " << sim_submit_count_ << " simulation submits to a second queue";
+    sim_submit_count_ = 0;
+    job_pool_->reset_counters();
+
+    // bytes written to mapped memory
+    if (profile_frame_count_) os << ", " << upload_bytes_ / profile_frame_count_ << " bytes uploaded per frame";
+    if (profile_frame_count_) os << ", " << triangle_count_ / profile_frame_count_ << " triangles per frame";
+    if (profile_frame_count_) {
+        os << ", " << visible_count_ / profile_frame_count_ << " visible and " << culled_count_ / profile_frame_count_
+           << " culled objects per frame";
+    }
+    if (profile_gpu_frame_count_) {
+        os << ", " << profile_gpu_time_ / profile_gpu_frame_count_ * 1000.0 << " ms GPU time per frame with "
+           << ((mesh_flags_ & Meshes::FLAG_PACKED_VERTICES) ? "packed" : "float") << " vertices";
     }
+    upload_bytes_ = 0;
+    triangle_count_ = 0;
+    visible_count_ = 0;
+    culled_count_ = 0;
+    profile_frame_count_ = 0;
+    profile_gpu_time_ = 0.0;
+    profile_gpu_frame_count_ = 0;
 }
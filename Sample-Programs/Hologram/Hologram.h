@@ -17,17 +17,18 @@
 #ifndef HOLOGRAM_H
 #define HOLOGRAM_H
 
-#include <condition_variable>
+#include <atomic>
 #include <memory>
-#include <mutex>
 #include <string>
-#include <thread>
 #include <vector>
 
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
 
+#include "Frustum.h"
+#include "JobPool.h"
 #include "Simulation.h"
+#include "SimulationThread.h"
 #include "Game.h"
 
 class Meshes;
@@ -48,50 +49,17 @@ class Hologram : public Game {
 
     void on_frame(float frame_pred);
 
-   private:
-    class Worker {
-       public:
-        Worker(Hologram &hologram, int index, int object_begin, int object_end);
-
-        void start();
-        void stop();
-        void update_simulation();
-        void draw_objects(VkFramebuffer fb);
-        void wait_idle();
-
-        Hologram &hologram_;
-
-        const int index_;
-        const int object_begin_;
-        const int object_end_;
-
-        const float tick_interval_;
-
-        VkFramebuffer fb_;
-
-       private:
-        enum State {
-            INIT,
-            IDLE,
-            STEP,
-            DRAW,
-        };
-
-        void update_loop();
-
-        static void thread_loop(Worker *worker) { worker->update_loop(); }
-
-        std::thread thread_;
-        std::mutex mutex_;
-        std::condition_variable state_cv_;
-        State state_;
-    };
+    void on_profile(std::ostream &os);
 
+   private:
     struct Camera {
         glm::vec3 eye_pos;
         glm::mat4 view_projection;
+        // pixels per unit of length at a clip space w of 1
+        float pixel_scale;
+        Frustum frustum;
 
-        Camera(float eye) : eye_pos(eye) {}
+        Camera(float eye) : eye_pos(eye), pixel_scale(1.0f), frustum(glm::mat4(1.0f), 1.0f, 0.0f) {}
     };
 
     struct FrameData {
@@ -99,11 +67,47 @@ class Hologram : public Game {
         VkFence fence;
 
         VkCommandBuffer primary_cmd;
-        std::vector<VkCommandBuffer> worker_cmds;
 
-        VkBuffer buf;
-        uint8_t *base;
-        VkDescriptorSet desc_set;
+        // secondary command buffers allocated by each worker from its own
+        // pool, and how many of them are used this frame
+        std::vector<std::vector<VkCommandBuffer>> worker_cmds;
+        std::vector<size_t> worker_cmd_counts;
+
+        // secondary command buffers in object chunk order
+        std::vector<VkCommandBuffer> chunk_cmds;
+        VkFramebuffer fb;
+
+        // timestamps around the render pass are in the query pool
+        bool query_pending;
+        double submit_time;
+
+        // one uniform buffer per block of objects, or a single storage
+        // buffer when instancing
+        std::vector<VkBuffer> bufs;
+        std::vector<uint8_t *> bases;
+        std::vector<VkDescriptorSet> desc_sets;
+
+        // the tick and fade of the object params in bufs, and whether they
+        // are rewritten this frame
+        uint64_t params_tick;
+        bool params_fade;
+        bool params_dirty;
+
+        VkBuffer camera_buf;
+        uint8_t *camera_base;
+        VkDescriptorSet camera_desc_set;
+
+        // the simulation submitted to sim_queue_ this frame, which the draws
+        // wait for, and the semaphore the draws signal in turn
+        VkCommandBuffer sim_cmd;
+        VkSemaphore sim_semaphore;
+        VkSemaphore draw_semaphore;
+        bool sim_submitted;
+
+        // swapchain resources retired by detach_swapchain, destroyed once
+        // fence has been waited for
+        std::vector<VkFramebuffer> retired_fbs;
+        std::vector<VkImageView> retired_views;
     };
 
     // called by the constructor
@@ -111,40 +115,88 @@ class Hologram : public Game {
 
     bool multithread_;
     bool use_push_constants_;
+    bool use_instancing_;
+    bool use_gpu_simulation_;
+    bool use_sim_thread_;
+    bool use_lod_;
+    bool use_culling_;
+    uint32_t mesh_flags_;
+    // loaded by attach_shell and saved by detach_shell when not empty
+    std::string pipeline_cache_file_;
+
+    const float tick_interval_;
 
     // called mostly by on_key
     void update_camera();
 
+    const unsigned int sim_seed_;
+    uint64_t sim_tick_count_;
     bool sim_paused_;
     bool sim_fade_;
     Simulation sim_;
     Camera camera_;
 
-    std::vector<std::unique_ptr<Worker>> workers_;
+    std::unique_ptr<JobPool> job_pool_;
+
+    // when set, objects are drawn from the snapshot acquired by on_frame,
+    // blended from prev to cur by sim_blend_
+    std::unique_ptr<SimulationThread> sim_thread_;
+    const SimulationThread::Snapshot *sim_snapshot_;
+    float sim_blend_;
 
     // called by attach_shell
     void create_render_pass();
     void create_shader_modules();
     void create_descriptor_set_layout();
     void create_pipeline_layout();
+    // returns the size of the data loaded into the cache
+    size_t create_pipeline_cache();
+    void destroy_pipeline_cache();
     void create_pipeline();
 
     void create_frame_data(int count);
     void destroy_frame_data();
+    void destroy_retired(FrameData &data);
     void create_fences();
     void create_command_buffers();
     void create_buffers();
+    void prepare_instances();
     void create_buffer_memory();
     void create_descriptor_sets();
+    void create_camera_data();
+    void destroy_camera_data();
+
+    // GPU simulation
+    void create_simulation_pipeline();
+    void destroy_simulation_pipeline();
+    void create_simulation_buffers();
+    void destroy_simulation_buffers();
+    void create_simulation_descriptor_sets();
+    void check_simulation();
+
+    void create_staging_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer &buf, VkDeviceMemory &mem, void **ptr);
+    VkCommandBuffer begin_one_time_commands();
+    void end_one_time_commands(VkCommandBuffer cmd);
 
     VkPhysicalDevice physical_dev_;
     VkDevice dev_;
     VkQueue queue_;
     uint32_t queue_family_;
+    // a second queue of queue_family_ for the GPU simulation, if any
+    VkQueue sim_queue_;
     VkFormat format_;
     VkDeviceSize aligned_object_data_size;
+    uint32_t objects_per_block_;
+
+    // when instancing, objects are drawn grouped by mesh type
+    std::vector<int> instance_order_;
+    // indexed by Meshes::Type
+    std::vector<uint32_t> first_instances_;
+    std::vector<uint32_t> instance_counts_;
 
     VkPhysicalDeviceProperties physical_dev_props_;
+    bool gpu_timing_;
+    uint64_t timestamp_mask_;
     std::vector<VkMemoryPropertyFlags> mem_flags_;
 
     const Meshes *meshes_;
@@ -152,14 +204,49 @@ class Hologram : public Game {
     VkRenderPass render_pass_;
     VkShaderModule vs_;
     VkShaderModule fs_;
+    VkDescriptorSetLayout camera_desc_set_layout_;
     VkDescriptorSetLayout desc_set_layout_;
     VkPipelineLayout pipeline_layout_;
+    VkPipelineCache pipeline_cache_;
     VkPipeline pipeline_;
 
+    // state and instances of the GPU simulation, in instance order
+    VkShaderModule sim_cs_;
+    VkDescriptorSetLayout sim_desc_set_layout_;
+    VkPipelineLayout sim_pipeline_layout_;
+    VkPipeline sim_pipeline_;
+    VkBuffer sim_state_buf_;
+    VkBuffer sim_instance_buf_;
+    VkDeviceMemory sim_mem_;
+    VkDescriptorSet sim_desc_set_;
+    // ticks not yet dispatched
+    uint32_t sim_pending_ticks_;
+    // signaled by the last draws on queue_ and not yet waited for; the next
+    // dispatch on sim_queue_ waits for the draws to stop reading instances
+    VkSemaphore sim_draw_semaphore_;
+    uint64_t sim_submit_count_;
+
+    // bytes written to mapped memory since the last on_profile
+    std::atomic<uint64_t> upload_bytes_;
+    // triangles drawn since the last on_profile
+    std::atomic<uint64_t> triangle_count_;
+    // objects drawn and culled since the last on_profile
+    std::atomic<uint64_t> visible_count_;
+    std::atomic<uint64_t> culled_count_;
+    uint64_t profile_frame_count_;
+    // GPU time of the frames timed since the last on_profile, to compare
+    // vertex layouts by
+    double profile_gpu_time_;
+    uint64_t profile_gpu_frame_count_;
+
     VkCommandPool primary_cmd_pool_;
     std::vector<VkCommandPool> worker_cmd_pools_;
     VkDescriptorPool desc_pool_;
-    VkDeviceMemory frame_data_mem_;
+    // one allocation per block of objects, shared by all frames
+    std::vector<VkDeviceMemory> frame_data_mems_;
+    VkDescriptorPool camera_desc_pool_;
+    VkDeviceMemory camera_mem_;
+    VkQueryPool query_pool_;
     std::vector<FrameData> frame_data_;
     int frame_data_index_;
 
@@ -167,12 +254,11 @@ class Hologram : public Game {
     VkRenderPassBeginInfo render_pass_begin_info_;
 
     VkCommandBufferBeginInfo primary_cmd_begin_info_;
-    VkPipelineStageFlags primary_cmd_submit_wait_stages_;
     VkSubmitInfo primary_cmd_submit_info_;
 
     // called by attach_swapchain
     void prepare_viewport(const VkExtent2D &extent);
-    void prepare_framebuffers(VkSwapchainKHR swapchain);
+    void prepare_framebuffers(const std::vector<VkImage> &images);
 
     VkExtent2D extent_;
     VkViewport viewport_;
@@ -183,9 +269,18 @@ class Hologram : public Game {
     std::vector<VkFramebuffer> framebuffers_;
 
     // called by workers
-    void update_simulation(const Worker &worker);
-    void draw_object(const Simulation::Object &obj, FrameData &data, VkCommandBuffer cmd) const;
-    void draw_objects(Worker &worker);
+    void update_simulation(int begin, int end);
+    void get_object_state(int index, glm::mat4 &model, float &alpha) const;
+    uint32_t select_lod(Meshes::Type type, const glm::mat4 &model) const;
+    // returns the number of triangles drawn
+    uint32_t draw_object(int index, const glm::mat4 &model, float alpha, FrameData &data, VkCommandBuffer cmd) const;
+    void draw_objects(FrameData &data, int worker, int begin, int end);
+    void write_instances(FrameData &data, int worker, int begin, int end);
+
+    // called by on_frame when instancing
+    void draw_instances(FrameData &data);
+    void dispatch_simulation(VkCommandBuffer cmd);
+    void submit_simulation(FrameData &data);
 };
 
 #endif  // HOLOGRAM_H
@@ -0,0 +1,54 @@
+#version 310 es
+
+layout(location = 0) in vec3 in_pos;
+layout(location = 1) in vec3 in_normal;
+
+// in_normal.xy is an octahedral encoding when set
+layout(constant_id = 0) const bool packed_normals = false;
+
+struct instance_params {
+	vec3 light_pos;
+	float alpha;
+	vec3 light_color;
+	mat4 model;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer instance_block {
+	instance_params instances[];
+};
+
+layout(std140, push_constant) uniform param_block {
+	mat4 view_projection;
+} params;
+
+layout(location = 0) out vec3 color;
+layout(location = 1) out float alpha;
+
+vec3 decode_normal(vec3 n)
+{
+	if (!packed_normals)
+		return n;
+
+	vec3 v = vec3(n.xy, 1.0 - abs(n.x) - abs(n.y));
+	if (v.z < 0.0)
+		v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+
+	return v;
+}
+
+void main()
+{
+	instance_params inst = instances[gl_InstanceIndex];
+
+	vec3 world_light = vec3(inst.model * vec4(inst.light_pos, 1.0));
+	vec3 world_pos = vec3(inst.model * vec4(in_pos, 1.0));
+	vec3 world_normal = mat3(inst.model) * decode_normal(in_normal);
+
+	vec3 light_dir = world_light - world_pos;
+	float brightness = dot(light_dir, world_normal) / length(light_dir) / length(world_normal);
+	brightness = abs(brightness);
+
+	gl_Position = params.view_projection * vec4(world_pos, 1.0);
+	color = inst.light_color * brightness;
+	alpha = inst.alpha;
+}
@@ -3,28 +3,47 @@
 layout(location = 0) in vec3 in_pos;
 layout(location = 1) in vec3 in_normal;
 
+// in_normal.xy is an octahedral encoding when set
+layout(constant_id = 0) const bool packed_normals = false;
+
+layout(std140, set = 0, binding = 0) uniform camera_block {
+	mat4 view_projection;
+} camera;
+
 layout(std140, push_constant) uniform param_block {
+	// rows of the affine model matrix
+	mat3x4 model;
 	vec3 light_pos;
-	vec3 light_color;
-	mat4 model;
-	mat4 view_projection;
 	float alpha;
+	vec3 light_color;
 } params;
 
 layout(location = 0) out vec3 color;
 layout(location = 1) out float alpha;
 
+vec3 decode_normal(vec3 n)
+{
+	if (!packed_normals)
+		return n;
+
+	vec3 v = vec3(n.xy, 1.0 - abs(n.x) - abs(n.y));
+	if (v.z < 0.0)
+		v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+
+	return v;
+}
+
 void main()
 {
-	vec3 world_light = vec3(params.model * vec4(params.light_pos, 1.0));
-	vec3 world_pos = vec3(params.model * vec4(in_pos, 1.0));
-	vec3 world_normal = mat3(params.model) * in_normal;
+	vec3 world_light = vec4(params.light_pos, 1.0) * params.model;
+	vec3 world_pos = vec4(in_pos, 1.0) * params.model;
+	vec3 world_normal = vec4(decode_normal(in_normal), 0.0) * params.model;
 
 	vec3 light_dir = world_light - world_pos;
 	float brightness = dot(light_dir, world_normal) / length(light_dir) / length(world_normal);
 	brightness = abs(brightness);
 
-	gl_Position = params.view_projection * vec4(world_pos, 1.0);
+	gl_Position = camera.view_projection * vec4(world_pos, 1.0);
 	color = params.light_color * brightness;
 	alpha = params.alpha;
 }
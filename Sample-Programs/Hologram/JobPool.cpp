@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+#include "JobPool.h"
+
+JobPool::JobPool(int worker_count)
+    : job_(nullptr), generation_(0), quit_(false), pending_(0), steal_count_(0), chunk_count_(0) {
+    assert(worker_count > 0);
+
+    queues_.reserve(worker_count);
+    for (int i = 0; i < worker_count; i++) queues_.emplace_back(std::unique_ptr<Queue>(new Queue));
+}
+
+JobPool::~JobPool() { assert(threads_.empty()); }
+
+void JobPool::start() {
+    assert(threads_.empty());
+    quit_ = false;
+
+    // the last worker is the thread calling run()
+    threads_.reserve(worker_count() - 1);
+    for (int i = 0; i < worker_count() - 1; i++) threads_.emplace_back(&JobPool::thread_loop, this, i);
+}
+
+void JobPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    job_cv_.notify_all();
+
+    for (auto &thread : threads_) thread.join();
+    threads_.clear();
+}
+
+void JobPool::reset_counters() {
+    steal_count_.store(0, std::memory_order_relaxed);
+    chunk_count_.store(0, std::memory_order_relaxed);
+}
+
+void JobPool::run(int begin, int end, int chunk_size, const Job &job) {
+    assert(chunk_size > 0);
+    if (begin >= end) return;
+
+    const int chunk_total = (end - begin + chunk_size - 1) / chunk_size;
+    const int queue_count = worker_count();
+
+    // job_ must be visible before any chunk is
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &job;
+    }
+    pending_.store(chunk_total);
+
+    // deal contiguous runs of chunks so that workers start out on disjoint
+    // parts of the range
+    int chunk = 0;
+    for (int q = 0; q < queue_count; q++) {
+        const int chunk_end = static_cast<int>(static_cast<int64_t>(chunk_total) * (q + 1) / queue_count);
+
+        std::lock_guard<std::mutex> lock(queues_[q]->mutex);
+        for (; chunk < chunk_end; chunk++) {
+            const int chunk_begin = begin + chunk * chunk_size;
+            const int chunk_last = (chunk_begin + chunk_size < end) ? chunk_begin + chunk_size : end;
+            queues_[q]->chunks.push_back(Chunk{chunk_begin, chunk_last});
+        }
+    }
+    chunk_count_.fetch_add(chunk_total, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        generation_++;
+    }
+    job_cv_.notify_all();
+
+    work(queue_count - 1);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return pending_.load() == 0; });
+    job_ = nullptr;
+}
+
+bool JobPool::pop(int worker, Chunk &chunk) {
+    Queue &queue = *queues_[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.chunks.empty()) return false;
+
+    chunk = queue.chunks.front();
+    queue.chunks.pop_front();
+
+    return true;
+}
+
+bool JobPool::steal(int worker, Chunk &chunk) {
+    const int queue_count = worker_count();
+
+    for (int i = 1; i < queue_count; i++) {
+        Queue &queue = *queues_[(worker + i) % queue_count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.chunks.empty()) continue;
+
+        // take from the far end to stay out of the owner's way
+        chunk = queue.chunks.back();
+        queue.chunks.pop_back();
+        steal_count_.fetch_add(1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    return false;
+}
+
+void JobPool::work(int worker) {
+    Chunk chunk;
+    while (pop(worker, chunk) || steal(worker, chunk)) {
+        (*job_)(worker, chunk.begin, chunk.end);
+
+        if (pending_.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_cv_.notify_all();
+        }
+    }
+}
+
+void JobPool::thread_loop(int worker) {
+    uint64_t generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            job_cv_.wait(lock, [this, generation] { return quit_ || generation_ != generation; });
+            if (quit_) break;
+
+            generation = generation_;
+        }
+
+        work(worker);
+    }
+}
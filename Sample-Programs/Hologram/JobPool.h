@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef JOB_POOL_H
+#define JOB_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A work-stealing pool for data-parallel loops.  run() splits a range into
+// fixed-size chunks, deals them out to per-worker deques, and blocks until
+// all chunks are done.  Workers pop from the front of their own deque and
+// steal from the back of the others' when they run dry.  The calling thread
+// takes part as the last worker.
+class JobPool {
+   public:
+    // called with the index of the worker running the chunk
+    typedef std::function<void(int worker, int begin, int end)> Job;
+
+    JobPool(int worker_count);
+    ~JobPool();
+
+    JobPool(const JobPool &pool) = delete;
+    JobPool &operator=(const JobPool &pool) = delete;
+
+    // worker indices are in [0, worker_count())
+    int worker_count() const { return static_cast<int>(queues_.size()); }
+
+    void start();
+    void stop();
+
+    void run(int begin, int end, int chunk_size, const Job &job);
+
+    // chunks executed by a worker other than the one they were dealt to
+    uint64_t steal_count() const { return steal_count_.load(std::memory_order_relaxed); }
+    uint64_t chunk_count() const { return chunk_count_.load(std::memory_order_relaxed); }
+    void reset_counters();
+
+   private:
+    struct Chunk {
+        int begin;
+        int end;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Chunk> chunks;
+    };
+
+    bool pop(int worker, Chunk &chunk);
+    bool steal(int worker, Chunk &chunk);
+    void work(int worker);
+
+    void thread_loop(int worker);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    // protects job_, generation_ and quit_
+    std::mutex mutex_;
+    std::condition_variable job_cv_;
+    std::condition_variable done_cv_;
+    const Job *job_;
+    uint64_t generation_;
+    bool quit_;
+
+    std::atomic<int> pending_;
+
+    std::atomic<uint64_t> steal_count_;
+    std::atomic<uint64_t> chunk_count_;
+};
+
+#endif  // JOB_POOL_H
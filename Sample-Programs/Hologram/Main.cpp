@@ -32,11 +32,15 @@ Game *create_game(int argc, char **argv) {
 
 #if defined(VK_USE_PLATFORM_XCB_KHR)
 
+#include "ShellHeadless.h"
 #include "ShellXcb.h"
 
 int main(int argc, char **argv) {
     Game *game = create_game(argc, argv);
-    {
+    if (game->settings().headless) {
+        ShellHeadless shell(*game);
+        shell.run();
+    } else {
         ShellXcb shell(*game);
         shell.run();
     }
@@ -47,11 +51,15 @@ int main(int argc, char **argv) {
 
 #elif defined(VK_USE_PLATFORM_WAYLAND_KHR)
 
+#include "ShellHeadless.h"
 #include "ShellWayland.h"
 
 int main(int argc, char **argv) {
     Game *game = create_game(argc, argv);
-    {
+    if (game->settings().headless) {
+        ShellHeadless shell(*game);
+        shell.run();
+    } else {
         ShellWayland shell(*game);
         shell.run();
     }
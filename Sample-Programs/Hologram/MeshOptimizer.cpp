@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <deque>
+
+#include "MeshOptimizer.h"
+
+namespace mesh_optimizer {
+
+namespace {
+
+const int lru_cache_size = 32;
+
+// the score of a vertex at cache_pos (-1 when not cached) with live_count
+// triangles left to emit, per Forsyth
+float vertex_score(int cache_pos, int live_count) {
+    if (live_count == 0) return -1.0f;
+
+    float score = 0.0f;
+    if (cache_pos >= 0) {
+        // the last triangle's vertices are equally good, to not favor strips
+        if (cache_pos < 3) {
+            score = 0.75f;
+        } else {
+            const float scale = 1.0f / (lru_cache_size - 3);
+            score = std::pow(1.0f - (cache_pos - 3) * scale, 1.5f);
+        }
+    }
+
+    // favor vertices with few triangles left, to not leave lone triangles
+    score += 2.0f / std::sqrt(static_cast<float>(live_count));
+
+    return score;
+}
+
+}  // namespace
+
+CacheStats measure_cache(const std::vector<uint32_t> &indices, uint32_t vertex_count) {
+    std::deque<uint32_t> fifo;
+    uint32_t miss_count = 0;
+
+    for (auto index : indices) {
+        if (std::find(fifo.begin(), fifo.end(), index) != fifo.end()) continue;
+
+        miss_count++;
+        fifo.push_back(index);
+        if (fifo.size() > static_cast<size_t>(fifo_cache_size)) fifo.pop_front();
+    }
+
+    CacheStats stats;
+    stats.acmr = indices.empty() ? 0.0f : static_cast<float>(miss_count) / (indices.size() / 3);
+    stats.atvr = vertex_count ? static_cast<float>(miss_count) / vertex_count : 0.0f;
+
+    return stats;
+}
+
+void optimize_vertex_cache(std::vector<uint32_t> &indices, uint32_t vertex_count) {
+    assert(indices.size() % 3 == 0);
+    const size_t tri_count = indices.size() / 3;
+
+    // triangles of each vertex, live ones first
+    std::vector<uint32_t> tri_offsets(vertex_count + 1, 0);
+    for (auto index : indices) tri_offsets[index + 1]++;
+    for (uint32_t v = 0; v < vertex_count; v++) tri_offsets[v + 1] += tri_offsets[v];
+
+    std::vector<uint32_t> vertex_tris(indices.size());
+    std::vector<int> live_counts(vertex_count, 0);
+    for (size_t t = 0; t < tri_count; t++) {
+        for (int k = 0; k < 3; k++) {
+            const uint32_t v = indices[3 * t + k];
+            vertex_tris[tri_offsets[v] + live_counts[v]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<int> cache_positions(vertex_count, -1);
+    std::vector<float> vertex_scores(vertex_count);
+    for (uint32_t v = 0; v < vertex_count; v++) vertex_scores[v] = vertex_score(-1, live_counts[v]);
+
+    std::vector<float> tri_scores(tri_count);
+    for (size_t t = 0; t < tri_count; t++) {
+        tri_scores[t] = vertex_scores[indices[3 * t]] + vertex_scores[indices[3 * t + 1]] + vertex_scores[indices[3 * t + 2]];
+    }
+
+    std::vector<bool> emitted(tri_count, false);
+    std::vector<uint32_t> cache, next_cache;
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    size_t scan_pos = 0;
+    int64_t best_tri = -1;
+    while (result.size() < indices.size()) {
+        // nothing in the cache has triangles left; take the best of the rest
+        if (best_tri < 0) {
+            float best_score = -1.0f;
+            for (size_t t = scan_pos; t < tri_count; t++) {
+                if (!emitted[t] && tri_scores[t] > best_score) {
+                    best_score = tri_scores[t];
+                    best_tri = static_cast<int64_t>(t);
+                }
+            }
+            while (emitted[scan_pos]) scan_pos++;
+        }
+
+        const size_t tri = static_cast<size_t>(best_tri);
+        emitted[tri] = true;
+
+        // emit and move the vertices to the front of the cache
+        next_cache.clear();
+        for (int k = 0; k < 3; k++) {
+            const uint32_t v = indices[3 * tri + k];
+            result.push_back(v);
+            next_cache.push_back(v);
+
+            // move the triangle past the live ones of v
+            uint32_t *tris = &vertex_tris[tri_offsets[v]];
+            const int live_count = live_counts[v]--;
+            for (int i = 0; i < live_count; i++) {
+                if (tris[i] == tri) {
+                    std::swap(tris[i], tris[live_count - 1]);
+                    break;
+                }
+            }
+        }
+        for (auto v : cache) {
+            if (v != next_cache[0] && v != next_cache[1] && v != next_cache[2]) next_cache.push_back(v);
+        }
+
+        // update the scores of the vertices in or evicted from the cache
+        for (size_t i = 0; i < next_cache.size(); i++) {
+            const uint32_t v = next_cache[i];
+            cache_positions[v] = (i < static_cast<size_t>(lru_cache_size)) ? static_cast<int>(i) : -1;
+            vertex_scores[v] = vertex_score(cache_positions[v], live_counts[v]);
+        }
+        if (next_cache.size() > static_cast<size_t>(lru_cache_size)) next_cache.resize(lru_cache_size);
+        cache.swap(next_cache);
+
+        // the next triangle is the best one using a cached vertex
+        best_tri = -1;
+        float best_score = -1.0f;
+        for (auto v : cache) {
+            const uint32_t *tris = &vertex_tris[tri_offsets[v]];
+            for (int i = 0; i < live_counts[v]; i++) {
+                const uint32_t t = tris[i];
+                tri_scores[t] =
+                    vertex_scores[indices[3 * t]] + vertex_scores[indices[3 * t + 1]] + vertex_scores[indices[3 * t + 2]];
+                if (tri_scores[t] > best_score) {
+                    best_score = tri_scores[t];
+                    best_tri = t;
+                }
+            }
+        }
+    }
+
+    indices.swap(result);
+}
+
+void optimize_overdraw(std::vector<uint32_t> &indices, const std::vector<float> &positions) {
+    const size_t tri_count = indices.size() / 3;
+    if (!tri_count) return;
+
+    // split into clusters at triangles missing the cache on all vertices
+    std::vector<size_t> cluster_starts;
+    std::deque<uint32_t> fifo;
+    for (size_t t = 0; t < tri_count; t++) {
+        int miss_count = 0;
+        for (int k = 0; k < 3; k++) {
+            const uint32_t v = indices[3 * t + k];
+            if (std::find(fifo.begin(), fifo.end(), v) != fifo.end()) continue;
+
+            miss_count++;
+            fifo.push_back(v);
+            if (fifo.size() > static_cast<size_t>(fifo_cache_size)) fifo.pop_front();
+        }
+
+        if (t == 0 || miss_count == 3) cluster_starts.push_back(t);
+    }
+    cluster_starts.push_back(tri_count);
+
+    const size_t cluster_count = cluster_starts.size() - 1;
+
+    // area weighted centroids and normals of the triangles
+    std::vector<float> tri_data(tri_count * 7);
+    float mesh_centroid[3] = {0.0f, 0.0f, 0.0f};
+    float mesh_area = 0.0f;
+    for (size_t t = 0; t < tri_count; t++) {
+        const float *p0 = &positions[3 * indices[3 * t + 0]];
+        const float *p1 = &positions[3 * indices[3 * t + 1]];
+        const float *p2 = &positions[3 * indices[3 * t + 2]];
+        const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+
+        float *data = &tri_data[7 * t];
+        // normal, with a length of twice the area
+        data[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        data[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        data[2] = e1[0] * e2[1] - e1[1] * e2[0];
+        data[3] = std::sqrt(data[0] * data[0] + data[1] * data[1] + data[2] * data[2]) * 0.5f;
+        for (int k = 0; k < 3; k++) {
+            data[4 + k] = (p0[k] + p1[k] + p2[k]) / 3.0f;
+            mesh_centroid[k] += data[4 + k] * data[3];
+        }
+        mesh_area += data[3];
+    }
+    if (mesh_area > 0.0f) {
+        for (int k = 0; k < 3; k++) mesh_centroid[k] /= mesh_area;
+    }
+
+    std::vector<float> cluster_sort_keys(cluster_count);
+    for (size_t c = 0; c < cluster_count; c++) {
+        float centroid[3] = {0.0f, 0.0f, 0.0f};
+        float normal[3] = {0.0f, 0.0f, 0.0f};
+        float area = 0.0f;
+        for (size_t t = cluster_starts[c]; t < cluster_starts[c + 1]; t++) {
+            const float *data = &tri_data[7 * t];
+            for (int k = 0; k < 3; k++) {
+                normal[k] += data[k];
+                centroid[k] += data[4 + k] * data[3];
+            }
+            area += data[3];
+        }
+
+        float key = 0.0f;
+        const float normal_len = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (area > 0.0f && normal_len > 0.0f) {
+            for (int k = 0; k < 3; k++) key += (centroid[k] / area - mesh_centroid[k]) * normal[k] / normal_len;
+        }
+        cluster_sort_keys[c] = key;
+    }
+
+    std::vector<size_t> cluster_order(cluster_count);
+    for (size_t c = 0; c < cluster_count; c++) cluster_order[c] = c;
+    std::stable_sort(cluster_order.begin(), cluster_order.end(),
+                     [&cluster_sort_keys](size_t a, size_t b) { return cluster_sort_keys[a] > cluster_sort_keys[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (auto c : cluster_order) {
+        result.insert(result.end(), indices.begin() + 3 * cluster_starts[c], indices.begin() + 3 * cluster_starts[c + 1]);
+    }
+
+    indices.swap(result);
+}
+
+std::vector<uint32_t> optimize_vertex_fetch(std::vector<uint32_t> &indices, uint32_t vertex_count) {
+    std::vector<uint32_t> remap(vertex_count, UINT32_MAX);
+
+    uint32_t next = 0;
+    for (auto &index : indices) {
+        if (remap[index] == UINT32_MAX) remap[index] = next++;
+        index = remap[index];
+    }
+
+    for (auto &r : remap) {
+        if (r == UINT32_MAX) r = next++;
+    }
+
+    return remap;
+}
+
+}  // namespace mesh_optimizer
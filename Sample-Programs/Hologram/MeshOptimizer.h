@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstdint>
+#include <vector>
+
+// Reorders indexed triangle lists for the GPU.  All functions keep the set
+// of triangles, and the winding of each, unchanged.
+namespace mesh_optimizer {
+
+// the post-transform vertex cache is modeled as a FIFO of this size
+const int fifo_cache_size = 16;
+
+struct CacheStats {
+    // average cache miss ratio: transformed vertices per triangle
+    float acmr;
+    // average transform to vertex ratio: transformed vertices per vertex
+    float atvr;
+};
+CacheStats measure_cache(const std::vector<uint32_t> &indices, uint32_t vertex_count);
+
+// Tom Forsyth's linear-speed vertex cache optimization, with an LRU cache of
+// 32 vertices.  It is not tuned to a cache size, and does well on FIFOs.
+void optimize_vertex_cache(std::vector<uint32_t> &indices, uint32_t vertex_count);
+
+// Sort the clusters of optimize_vertex_cache output by how much they face
+// away from the mesh center, so that triangles likely to occlude others are
+// drawn first (Sander et al., Fast Triangle Reordering for Vertex Locality
+// and Reduced Overdraw).  Clusters start at triangles whose three vertices
+// all miss the cache, so the cache efficiency is mostly kept.  positions
+// holds three floats per vertex.
+void optimize_overdraw(std::vector<uint32_t> &indices, const std::vector<float> &positions);
+
+// Renumber vertices in the order indices first use them, so that vertices
+// are fetched mostly sequentially.  Returns the new index of each old
+// vertex.  Unused vertices go last.
+std::vector<uint32_t> optimize_vertex_fetch(std::vector<uint32_t> &indices, uint32_t vertex_count);
+
+}  // namespace mesh_optimizer
+
+#endif  // MESH_OPTIMIZER_H
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs each mesh_optimizer pass on the teapot and an icosphere, and checks
+// that the reordered index buffers hold the same triangles, with the same
+// winding, as before.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MeshOptimizer.h"
+
+namespace {
+
+#include "Meshes.teapot.h"
+
+int failures = 0;
+
+void check(bool cond, const std::string &mesh, const char *what) {
+    if (cond) return;
+
+    std::fprintf(stderr, "%s: %s\n", mesh.c_str(), what);
+    failures++;
+}
+
+struct TestMesh {
+    std::string name;
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+
+    uint32_t vertex_count() const { return static_cast<uint32_t>(positions.size() / 3); }
+};
+
+TestMesh build_teapot() {
+    TestMesh mesh;
+    mesh.name = "teapot";
+    mesh.positions.assign(teapot_positions, teapot_positions + sizeof(teapot_positions) / sizeof(teapot_positions[0]));
+    mesh.indices.assign(teapot_indices, teapot_indices + sizeof(teapot_indices) / sizeof(teapot_indices[0]));
+
+    return mesh;
+}
+
+// the icosahedron of Meshes.cpp, tessellated the same way
+TestMesh build_icosphere(int tessellate_level) {
+    TestMesh mesh;
+    mesh.name = "icosphere level " + std::to_string(tessellate_level);
+
+    const float l1 = std::sqrt(2.0f / (5.0f + std::sqrt(5.0f)));
+    const float l2 = std::sqrt(2.0f / (5.0f - std::sqrt(5.0f)));
+    // vertices are from three golden rectangles
+    mesh.positions = {
+        -l1, -l2, 0.0f, l1, -l2, 0.0f, l1, l2, 0.0f, -l1, l2, 0.0f,  //
+        -l2, 0.0f, -l1, l2, 0.0f, -l1, l2, 0.0f, l1, -l2, 0.0f, l1,  //
+        0.0f, -l1, -l2, 0.0f, l1, -l2, 0.0f, l1, l2, 0.0f, -l1, l2,  //
+    };
+    mesh.indices = {
+        0,  1,  11, 0,  11, 7,  0,  7,  4, 0, 4,  8,  0, 8, 1,  //
+        11, 1,  6,  7,  11, 10, 4,  7,  3, 8, 4,  9,  1, 8, 5,  //
+        2,  3,  10, 2,  10, 6,  2,  6,  5, 2, 5,  9,  2, 9, 3,  //
+        10, 3,  7,  6,  10, 11, 5,  6,  1, 9, 5,  8,  3, 9, 4,  //
+    };
+
+    for (int level = 0; level < tessellate_level; level++) {
+        std::map<std::pair<uint32_t, uint32_t>, uint32_t> middle_points;
+        auto middle_point = [&](uint32_t a, uint32_t b) {
+            const auto key = std::make_pair(std::min(a, b), std::max(a, b));
+            auto it = middle_points.find(key);
+            if (it != middle_points.end()) return it->second;
+
+            float mid[3];
+            for (int i = 0; i < 3; i++) mid[i] = (mesh.positions[3 * a + i] + mesh.positions[3 * b + i]) / 2.0f;
+            const float scale = 1.0f / std::sqrt(mid[0] * mid[0] + mid[1] * mid[1] + mid[2] * mid[2]);
+            for (int i = 0; i < 3; i++) mesh.positions.push_back(mid[i] * scale);
+
+            const uint32_t index = mesh.vertex_count() - 1;
+            middle_points.emplace(key, index);
+            return index;
+        };
+
+        std::vector<uint32_t> indices;
+        indices.reserve(mesh.indices.size() * 4);
+        for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+            const uint32_t v0 = mesh.indices[i + 0];
+            const uint32_t v1 = mesh.indices[i + 1];
+            const uint32_t v2 = mesh.indices[i + 2];
+            const uint32_t v01 = middle_point(v0, v1);
+            const uint32_t v12 = middle_point(v1, v2);
+            const uint32_t v20 = middle_point(v2, v0);
+
+            indices.insert(indices.end(), {v0, v01, v20, v1, v12, v01, v2, v20, v12, v01, v12, v20});
+        }
+        mesh.indices.swap(indices);
+    }
+
+    return mesh;
+}
+
+// Triangles rotated to start at their smallest index, which keeps the
+// winding, and sorted.  Equal when two index buffers draw the same
+// triangles facing the same way.
+std::vector<std::array<uint32_t, 3>> triangle_multiset(const std::vector<uint32_t> &indices) {
+    std::vector<std::array<uint32_t, 3>> triangles;
+    triangles.reserve(indices.size() / 3);
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        std::array<uint32_t, 3> tri = {indices[i + 0], indices[i + 1], indices[i + 2]};
+        while (tri[0] > tri[1] || tri[0] > tri[2]) std::rotate(tri.begin(), tri.begin() + 1, tri.end());
+        triangles.push_back(tri);
+    }
+    std::sort(triangles.begin(), triangles.end());
+
+    return triangles;
+}
+
+void test_mesh(const TestMesh &mesh) {
+    const auto original = triangle_multiset(mesh.indices);
+    const mesh_optimizer::CacheStats built = mesh_optimizer::measure_cache(mesh.indices, mesh.vertex_count());
+
+    // vertex cache
+    std::vector<uint32_t> indices = mesh.indices;
+    mesh_optimizer::optimize_vertex_cache(indices, mesh.vertex_count());
+    check(indices.size() == mesh.indices.size(), mesh.name, "optimize_vertex_cache changed the index count");
+    check(triangle_multiset(indices) == original, mesh.name, "optimize_vertex_cache changed the triangles");
+
+    const mesh_optimizer::CacheStats optimized = mesh_optimizer::measure_cache(indices, mesh.vertex_count());
+    check(optimized.acmr <= built.acmr, mesh.name, "optimize_vertex_cache made the ACMR worse");
+
+    // overdraw, after the vertex cache pass as Meshes runs it, and alone
+    std::vector<uint32_t> overdraw = indices;
+    mesh_optimizer::optimize_overdraw(overdraw, mesh.positions);
+    check(triangle_multiset(overdraw) == original, mesh.name, "optimize_overdraw changed the triangles");
+
+    std::vector<uint32_t> overdraw_only = mesh.indices;
+    mesh_optimizer::optimize_overdraw(overdraw_only, mesh.positions);
+    check(triangle_multiset(overdraw_only) == original, mesh.name, "optimize_overdraw changed the unoptimized triangles");
+
+    // vertex fetch renumbers vertices, so compare through the remap
+    std::vector<uint32_t> fetch = overdraw;
+    const std::vector<uint32_t> remap = mesh_optimizer::optimize_vertex_fetch(fetch, mesh.vertex_count());
+    check(remap.size() == mesh.vertex_count(), mesh.name, "optimize_vertex_fetch remap has the wrong size");
+
+    std::vector<bool> taken(mesh.vertex_count(), false);
+    bool permutation = remap.size() == mesh.vertex_count();
+    for (size_t i = 0; permutation && i < remap.size(); i++) {
+        permutation = remap[i] < mesh.vertex_count() && !taken[remap[i]];
+        if (permutation) taken[remap[i]] = true;
+    }
+    check(permutation, mesh.name, "optimize_vertex_fetch remap is not a permutation");
+
+    if (permutation) {
+        std::vector<uint32_t> remapped = mesh.indices;
+        for (auto &index : remapped) index = remap[index];
+        check(triangle_multiset(fetch) == triangle_multiset(remapped), mesh.name, "optimize_vertex_fetch changed the triangles");
+    }
+
+    // vertices are first used in order
+    uint32_t next = 0;
+    bool sequential = true;
+    for (auto index : fetch) {
+        if (index > next) sequential = false;
+        if (index == next) next++;
+    }
+    check(sequential, mesh.name, "optimize_vertex_fetch did not number vertices in order of use");
+
+    std::printf("%s: %zu triangles, ACMR %.3f -> %.3f\n", mesh.name.c_str(), original.size(), built.acmr, optimized.acmr);
+}
+
+}  // namespace
+
+int main() {
+    test_mesh(build_teapot());
+    for (int level = 0; level < 4; level++) test_mesh(build_icosphere(level));
+
+    if (failures) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    return 0;
+}
@@ -14,17 +14,27 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <cstring>
 #include <array>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <tuple>
 #include <unordered_map>
 
+#include <glm/glm.hpp>
+
 #include "Helpers.h"
 #include "Meshes.h"
 
 namespace {
 
+int16_t snorm16(float v) { return static_cast<int16_t>(std::round(std::max(-1.0f, std::min(v, 1.0f)) * 32767.0f)); }
+
 class Mesh {
    public:
     struct Position {
@@ -45,39 +55,44 @@ class Mesh {
         int v2;
     };
 
-    static uint32_t vertex_stride() {
+    // When packed, Position is snorm16 and padded to four components, as
+    // three component 16-bit formats are optional for vertex buffers, and
+    // Normal is octahedral encoded in two snorm16.  Positions must be in
+    // [-1, 1].
+    static uint32_t vertex_stride(bool packed) {
         // Position + Normal
         const int comp_count = 6;
+        const int packed_comp_count = 4 + 2;
 
-        return sizeof(float) * comp_count;
+        return packed ? sizeof(int16_t) * packed_comp_count : sizeof(float) * comp_count;
     }
 
-    static VkVertexInputBindingDescription vertex_input_binding() {
+    static VkVertexInputBindingDescription vertex_input_binding(bool packed) {
         VkVertexInputBindingDescription vi_binding = {};
         vi_binding.binding = 0;
-        vi_binding.stride = vertex_stride();
+        vi_binding.stride = vertex_stride(packed);
         vi_binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
         return vi_binding;
     }
 
-    static std::vector<VkVertexInputAttributeDescription> vertex_input_attributes() {
+    static std::vector<VkVertexInputAttributeDescription> vertex_input_attributes(bool packed) {
         std::vector<VkVertexInputAttributeDescription> vi_attrs(2);
         // Position
         vi_attrs[0].location = 0;
         vi_attrs[0].binding = 0;
-        vi_attrs[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+        vi_attrs[0].format = packed ? VK_FORMAT_R16G16B16A16_SNORM : VK_FORMAT_R32G32B32_SFLOAT;
         vi_attrs[0].offset = 0;
         // Normal
         vi_attrs[1].location = 1;
         vi_attrs[1].binding = 0;
-        vi_attrs[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        vi_attrs[1].offset = sizeof(float) * 3;
+        vi_attrs[1].format = packed ? VK_FORMAT_R16G16_SNORM : VK_FORMAT_R32G32B32_SFLOAT;
+        vi_attrs[1].offset = packed ? sizeof(int16_t) * 4 : sizeof(float) * 3;
 
         return vi_attrs;
     }
 
-    static VkIndexType index_type() { return VK_INDEX_TYPE_UINT32; }
+    static uint32_t index_size(VkIndexType type) { return (type == VK_INDEX_TYPE_UINT16) ? sizeof(uint16_t) : sizeof(uint32_t); }
 
     static VkPipelineInputAssemblyStateCreateInfo input_assembly_state() {
         VkPipelineInputAssemblyStateCreateInfo ia_info = {};
@@ -101,9 +116,14 @@ class Mesh {
 
     uint32_t vertex_count() const { return static_cast<uint32_t>(positions_.size()); }
 
-    VkDeviceSize vertex_buffer_size() const { return vertex_stride() * vertex_count(); }
+    VkDeviceSize vertex_buffer_size(bool packed) const { return vertex_stride(packed) * vertex_count(); }
+
+    void vertex_buffer_write(void *data, bool packed) const {
+        if (packed) {
+            vertex_buffer_write_packed(data);
+            return;
+        }
 
-    void vertex_buffer_write(void *data) const {
         float *dst = reinterpret_cast<float *>(data);
         for (size_t i = 0; i < positions_.size(); i++) {
             const Position &pos = positions_[i];
@@ -118,11 +138,96 @@ class Mesh {
         }
     }
 
+    void vertex_buffer_write_packed(void *data) const {
+        int16_t *dst = reinterpret_cast<int16_t *>(data);
+        for (size_t i = 0; i < positions_.size(); i++) {
+            const Position &pos = positions_[i];
+            const Normal &normal = normals_[i];
+            dst[0] = snorm16(pos.x);
+            dst[1] = snorm16(pos.y);
+            dst[2] = snorm16(pos.z);
+            dst[3] = 0;
+
+            // project onto the octahedron and fold the lower half over
+            float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+            if (l1 == 0.0f) l1 = 1.0f;
+            float u = normal.x / l1;
+            float v = normal.y / l1;
+            if (normal.z < 0.0f) {
+                const float folded_u = (1.0f - std::abs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+                const float folded_v = (1.0f - std::abs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+                u = folded_u;
+                v = folded_v;
+            }
+            dst[4] = snorm16(u);
+            dst[5] = snorm16(v);
+            dst += 6;
+        }
+    }
+
+    std::vector<uint32_t> indices() const {
+        std::vector<uint32_t> indices;
+        indices.reserve(index_count());
+        for (const auto &face : faces_) {
+            indices.push_back(face.v0);
+            indices.push_back(face.v1);
+            indices.push_back(face.v2);
+        }
+
+        return indices;
+    }
+
+    void optimize(bool overdraw) {
+        std::vector<uint32_t> indices = this->indices();
+
+        mesh_optimizer::optimize_vertex_cache(indices, vertex_count());
+
+        if (overdraw) {
+            std::vector<float> positions;
+            positions.reserve(positions_.size() * 3);
+            for (const auto &pos : positions_) {
+                positions.push_back(pos.x);
+                positions.push_back(pos.y);
+                positions.push_back(pos.z);
+            }
+
+            mesh_optimizer::optimize_overdraw(indices, positions);
+        }
+
+        const std::vector<uint32_t> remap = mesh_optimizer::optimize_vertex_fetch(indices, vertex_count());
+
+        std::vector<Position> positions(positions_.size());
+        std::vector<Normal> normals(normals_.size());
+        for (size_t i = 0; i < remap.size(); i++) {
+            positions[remap[i]] = positions_[i];
+            normals[remap[i]] = normals_[i];
+        }
+        positions_.swap(positions);
+        normals_.swap(normals);
+
+        for (size_t i = 0; i < faces_.size(); i++) {
+            faces_[i].v0 = indices[3 * i + 0];
+            faces_[i].v1 = indices[3 * i + 1];
+            faces_[i].v2 = indices[3 * i + 2];
+        }
+    }
+
     uint32_t index_count() const { return static_cast<uint32_t>(faces_.size() * 3); }
 
-    VkDeviceSize index_buffer_size() const { return sizeof(uint32_t) * index_count(); }
+    VkDeviceSize index_buffer_size(VkIndexType type) const { return index_size(type) * index_count(); }
+
+    void index_buffer_write(void *data, VkIndexType type) const {
+        if (type == VK_INDEX_TYPE_UINT16) {
+            uint16_t *dst = reinterpret_cast<uint16_t *>(data);
+            for (const auto &face : faces_) {
+                dst[0] = static_cast<uint16_t>(face.v0);
+                dst[1] = static_cast<uint16_t>(face.v1);
+                dst[2] = static_cast<uint16_t>(face.v2);
+                dst += 3;
+            }
+            return;
+        }
 
-    void index_buffer_write(void *data) const {
         uint32_t *dst = reinterpret_cast<uint32_t *>(data);
         for (const auto &face : faces_) {
             dst[0] = face.v0;
@@ -157,13 +262,27 @@ class BuildPyramid {
 
 class BuildIcosphere {
    public:
-    BuildIcosphere(Mesh &mesh) : mesh_(mesh), radius_(1.0f) {
-        const int tessellate_level = 2;
-
+    BuildIcosphere(Mesh &mesh, int tessellate_level) : mesh_(mesh), radius_(1.0f) {
         build_icosahedron();
         for (int i = 0; i < tessellate_level; i++) tessellate();
     }
 
+    // the largest gap between the sphere and the flat faces
+    float error() const {
+        float min_dist = radius_;
+        for (const auto &f : mesh_.faces_) {
+            const Mesh::Position &p0 = mesh_.positions_[f.v0];
+            const Mesh::Position &p1 = mesh_.positions_[f.v1];
+            const Mesh::Position &p2 = mesh_.positions_[f.v2];
+            const glm::vec3 a(p0.x, p0.y, p0.z), b(p1.x, p1.y, p1.z), c(p2.x, p2.y, p2.z);
+            const glm::vec3 n = glm::normalize(glm::cross(b - a, c - a));
+
+            min_dist = std::min(min_dist, std::abs(glm::dot(n, a)));
+        }
+
+        return radius_ - min_dist;
+    }
+
    private:
     void build_icosahedron() {
         // https://en.wikipedia.org/wiki/Regular_icosahedron
@@ -364,65 +483,281 @@ class BuildTeapot {
     }
 };
 
-void build_meshes(std::array<Mesh, Meshes::MESH_COUNT> &meshes) {
-    BuildPyramid build_pyramid(meshes[Meshes::MESH_PYRAMID]);
-    BuildIcosphere build_icosphere(meshes[Meshes::MESH_ICOSPHERE]);
-    BuildTeapot build_teapot(meshes[Meshes::MESH_TEAPOT]);
+// Rossignac-Borrel vertex clustering: the vertices in a cell of a grid over
+// [-1, 1] are merged into their average, and the triangles that collapse are
+// dropped.  Returns the largest distance a vertex moved.
+float decimate(const Mesh &src, int grid_size, Mesh &dst) {
+    auto cell = [grid_size](float v) {
+        const int c = static_cast<int>((v + 1.0f) * 0.5f * grid_size);
+        return std::max(0, std::min(c, grid_size - 1));
+    };
+
+    std::map<std::tuple<int, int, int>, int> cells;
+    std::vector<int> remap(src.vertex_count());
+    std::vector<int> merged_counts;
+    for (uint32_t i = 0; i < src.vertex_count(); i++) {
+        const Mesh::Position &pos = src.positions_[i];
+        const Mesh::Normal &normal = src.normals_[i];
+
+        auto it = cells.emplace(std::make_tuple(cell(pos.x), cell(pos.y), cell(pos.z)), dst.vertex_count()).first;
+        if (it->second == static_cast<int>(dst.vertex_count())) {
+            dst.positions_.emplace_back(Mesh::Position{0.0f, 0.0f, 0.0f});
+            dst.normals_.emplace_back(Mesh::Normal{0.0f, 0.0f, 0.0f});
+            merged_counts.push_back(0);
+        }
+
+        const int v = it->second;
+        remap[i] = v;
+
+        Mesh::Position &merged_pos = dst.positions_[v];
+        merged_pos.x += pos.x;
+        merged_pos.y += pos.y;
+        merged_pos.z += pos.z;
+        Mesh::Normal &merged_normal = dst.normals_[v];
+        merged_normal.x += normal.x;
+        merged_normal.y += normal.y;
+        merged_normal.z += normal.z;
+        merged_counts[v]++;
+    }
+
+    for (uint32_t v = 0; v < dst.vertex_count(); v++) {
+        Mesh::Position &pos = dst.positions_[v];
+        pos.x /= merged_counts[v];
+        pos.y /= merged_counts[v];
+        pos.z /= merged_counts[v];
+
+        // opposite normals may cancel out; the shader only needs a direction
+        Mesh::Normal &normal = dst.normals_[v];
+        const float len = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+        if (len > 0.0f) {
+            normal.x /= len;
+            normal.y /= len;
+            normal.z /= len;
+        } else {
+            normal.z = 1.0f;
+        }
+    }
+
+    std::set<std::tuple<int, int, int>> faces;
+    for (const auto &f : src.faces_) {
+        const int v0 = remap[f.v0], v1 = remap[f.v1], v2 = remap[f.v2];
+        if (v0 == v1 || v1 == v2 || v2 == v0) continue;
+
+        // drop duplicates, in any rotation
+        std::tuple<int, int, int> key;
+        if (v0 < v1 && v0 < v2)
+            key = std::make_tuple(v0, v1, v2);
+        else if (v1 < v2)
+            key = std::make_tuple(v1, v2, v0);
+        else
+            key = std::make_tuple(v2, v0, v1);
+        if (!faces.insert(key).second) continue;
+
+        dst.faces_.emplace_back(Mesh::Face{v0, v1, v2});
+    }
+
+    float error = 0.0f;
+    for (uint32_t i = 0; i < src.vertex_count(); i++) {
+        const Mesh::Position &a = src.positions_[i];
+        const Mesh::Position &b = dst.positions_[remap[i]];
+        error = std::max(error, glm::distance(glm::vec3(a.x, a.y, a.z), glm::vec3(b.x, b.y, b.z)));
+    }
+
+    return error;
+}
+
+struct Lod {
+    Mesh mesh;
+    // in model space
+    float error;
+};
+
+void build_meshes(std::array<std::vector<Lod>, Meshes::MESH_COUNT> &lods, std::array<uint32_t, Meshes::MESH_COUNT> &default_lods) {
+    default_lods.fill(0);
+
+    // too small to simplify
+    lods[Meshes::MESH_PYRAMID].resize(1);
+    BuildPyramid build_pyramid(lods[Meshes::MESH_PYRAMID][0].mesh);
+    lods[Meshes::MESH_PYRAMID][0].error = 0.0f;
+
+    // tessellation levels 3 to 0
+    const int icosphere_lod_count = 4;
+    lods[Meshes::MESH_ICOSPHERE].resize(icosphere_lod_count);
+    for (int i = 0; i < icosphere_lod_count; i++) {
+        Lod &lod = lods[Meshes::MESH_ICOSPHERE][i];
+        BuildIcosphere build_icosphere(lod.mesh, icosphere_lod_count - 1 - i);
+        lod.error = build_icosphere.error();
+    }
+    // relative to the finest level
+    const float icosphere_base_error = lods[Meshes::MESH_ICOSPHERE][0].error;
+    for (auto &lod : lods[Meshes::MESH_ICOSPHERE]) lod.error -= icosphere_base_error;
+    // level 2 is what was drawn before there were LODs
+    default_lods[Meshes::MESH_ICOSPHERE] = 1;
+
+    const int teapot_grid_sizes[] = {32, 16, 8};
+    lods[Meshes::MESH_TEAPOT].resize(1 + sizeof(teapot_grid_sizes) / sizeof(teapot_grid_sizes[0]));
+    BuildTeapot build_teapot(lods[Meshes::MESH_TEAPOT][0].mesh);
+    lods[Meshes::MESH_TEAPOT][0].error = 0.0f;
+    for (size_t i = 1; i < lods[Meshes::MESH_TEAPOT].size(); i++) {
+        Lod &lod = lods[Meshes::MESH_TEAPOT][i];
+        lod.error = decimate(lods[Meshes::MESH_TEAPOT][0].mesh, teapot_grid_sizes[i - 1], lod.mesh);
+    }
+}
+
+// the first allowed memory type with all of the flags
+uint32_t find_memory_type(const std::vector<VkMemoryPropertyFlags> &mem_flags, uint32_t type_bits, VkMemoryPropertyFlags flags) {
+    for (uint32_t idx = 0; idx < mem_flags.size(); idx++) {
+        if ((type_bits & (1 << idx)) && (mem_flags[idx] & flags) == flags) return idx;
+    }
+
+    return UINT32_MAX;
 }
 
 }  // namespace
 
-Meshes::Meshes(VkDevice dev, const std::vector<VkMemoryPropertyFlags> &mem_flags)
-    : dev_(dev),
-      vertex_input_binding_(Mesh::vertex_input_binding()),
-      vertex_input_attrs_(Mesh::vertex_input_attributes()),
+const char *Meshes::type_name(Type type) {
+    switch (type) {
+        case MESH_PYRAMID:
+            return "pyramid";
+        case MESH_ICOSPHERE:
+            return "icosphere";
+        case MESH_TEAPOT:
+            return "teapot";
+        default:
+            return "unknown";
+    }
+}
+
+Meshes::Meshes(const Shell::Context &ctx, const std::vector<VkMemoryPropertyFlags> &mem_flags, uint32_t flags)
+    : dev_(ctx.dev),
+      packed_vertices_((flags & FLAG_PACKED_VERTICES) != 0),
+      vertex_input_binding_(Mesh::vertex_input_binding(packed_vertices_)),
+      vertex_input_attrs_(Mesh::vertex_input_attributes(packed_vertices_)),
       vertex_input_state_(),
       input_assembly_state_(Mesh::input_assembly_state()),
-      index_type_(Mesh::index_type()) {
+      index_type_(VK_INDEX_TYPE_UINT32),
+      device_local_(false),
+      staged_(false),
+      upload_size_(0),
+      upload_time_(0.0) {
     vertex_input_state_.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
     vertex_input_state_.vertexBindingDescriptionCount = 1;
     vertex_input_state_.pVertexBindingDescriptions = &vertex_input_binding_;
     vertex_input_state_.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertex_input_attrs_.size());
     vertex_input_state_.pVertexAttributeDescriptions = vertex_input_attrs_.data();
 
-    std::array<Mesh, MESH_COUNT> meshes;
-    build_meshes(meshes);
+    std::array<std::vector<Lod>, MESH_COUNT> lods;
+    std::array<uint32_t, MESH_COUNT> default_lods;
+    build_meshes(lods, default_lods);
+
+    // draw commands and the rest are per LOD, in type order
+    std::vector<Mesh *> meshes;
+    for (int type = 0; type < MESH_COUNT; type++) {
+        first_lods_.push_back(static_cast<uint32_t>(meshes.size()));
+        lod_counts_.push_back(static_cast<uint32_t>(lods[type].size()));
+        default_lods_.push_back(default_lods[type]);
+
+        float radius = 0.0f;
+        for (const auto &pos : lods[type][0].mesh.positions_)
+            radius = std::max(radius, glm::length(glm::vec3(pos.x, pos.y, pos.z)));
+        radii_.push_back(radius);
+
+        for (auto &lod : lods[type]) {
+            meshes.push_back(&lod.mesh);
+            lod_errors_.push_back(lod.error);
+        }
+    }
+
+    built_cache_stats_.reserve(MESH_COUNT);
+    cache_stats_.reserve(MESH_COUNT);
+    for (int type = 0; type < MESH_COUNT; type++) {
+        const Mesh &mesh = lods[type][default_lods[type]].mesh;
+        built_cache_stats_.push_back(mesh_optimizer::measure_cache(mesh.indices(), mesh.vertex_count()));
+    }
+    if (flags & (FLAG_OPTIMIZE | FLAG_OPTIMIZE_OVERDRAW)) {
+        for (auto mesh : meshes) mesh->optimize((flags & FLAG_OPTIMIZE_OVERDRAW) != 0);
+    }
+    for (int type = 0; type < MESH_COUNT; type++) {
+        const Mesh &mesh = lods[type][default_lods[type]].mesh;
+        cache_stats_.push_back(mesh_optimizer::measure_cache(mesh.indices(), mesh.vertex_count()));
+    }
+
+    // indices are relative to vertexOffset
+    if (packed_vertices_) {
+        index_type_ = VK_INDEX_TYPE_UINT16;
+        for (const auto mesh : meshes) {
+            if (mesh->vertex_count() > UINT16_MAX + 1) index_type_ = VK_INDEX_TYPE_UINT32;
+        }
+    }
 
     draw_commands_.reserve(meshes.size());
+    draw_sizes_.reserve(meshes.size());
     uint32_t first_index = 0;
     int32_t vertex_offset = 0;
     VkDeviceSize vb_size = 0;
     VkDeviceSize ib_size = 0;
-    for (const auto &mesh : meshes) {
+    for (const auto mesh : meshes) {
         VkDrawIndexedIndirectCommand draw = {};
-        draw.indexCount = mesh.index_count();
+        draw.indexCount = mesh->index_count();
         draw.instanceCount = 1;
         draw.firstIndex = first_index;
         draw.vertexOffset = vertex_offset;
         draw.firstInstance = 0;
 
         draw_commands_.push_back(draw);
+        draw_sizes_.push_back(mesh->vertex_buffer_size(packed_vertices_) + mesh->index_buffer_size(index_type_));
 
-        first_index += mesh.index_count();
-        vertex_offset += mesh.vertex_count();
-        vb_size += mesh.vertex_buffer_size();
-        ib_size += mesh.index_buffer_size();
+        first_index += mesh->index_count();
+        vertex_offset += mesh->vertex_count();
+        vb_size += mesh->vertex_buffer_size(packed_vertices_);
+        ib_size += mesh->index_buffer_size(index_type_);
     }
 
-    allocate_resources(vb_size, ib_size, mem_flags);
+    VkPhysicalDeviceProperties props;
+    vk::GetPhysicalDeviceProperties(ctx.physical_dev, &props);
+    const bool uma =
+        (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU || props.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU);
+
+    allocate_resources(vb_size, ib_size, mem_flags, uma);
+
+    const auto upload_begin = std::chrono::steady_clock::now();
+
+    // indices follow vertices in the staging buffer too
+    VkBuffer staging_buf = VK_NULL_HANDLE;
+    VkDeviceMemory staging_mem = VK_NULL_HANDLE;
+    VkDeviceMemory upload_mem;
+    VkDeviceSize ib_upload_offset;
+    if (staged_) {
+        create_staging_buffer(vb_size + ib_size, mem_flags, staging_buf, staging_mem);
+        upload_mem = staging_mem;
+        ib_upload_offset = vb_size;
+    } else {
+        upload_mem = mem_;
+        ib_upload_offset = ib_mem_offset_;
+    }
 
     uint8_t *vb_data, *ib_data;
-    vk::assert_success(vk::MapMemory(dev_, mem_, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void **>(&vb_data)));
-    ib_data = vb_data + ib_mem_offset_;
+    vk::assert_success(vk::MapMemory(dev_, upload_mem, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void **>(&vb_data)));
+    ib_data = vb_data + ib_upload_offset;
+
+    for (const auto mesh : meshes) {
+        mesh->vertex_buffer_write(vb_data, packed_vertices_);
+        mesh->index_buffer_write(ib_data, index_type_);
+        vb_data += mesh->vertex_buffer_size(packed_vertices_);
+        ib_data += mesh->index_buffer_size(index_type_);
+    }
 
-    for (const auto &mesh : meshes) {
-        mesh.vertex_buffer_write(vb_data);
-        mesh.index_buffer_write(ib_data);
-        vb_data += mesh.vertex_buffer_size();
-        ib_data += mesh.index_buffer_size();
+    vk::UnmapMemory(dev_, upload_mem);
+
+    if (staged_) {
+        copy_staging_buffer(ctx, staging_buf, vb_size, ib_size);
+
+        vk::DestroyBuffer(dev_, staging_buf, nullptr);
+        vk::FreeMemory(dev_, staging_mem, nullptr);
     }
 
-    vk::UnmapMemory(dev_, mem_);
+    upload_size_ = vb_size + ib_size;
+    upload_time_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - upload_begin).count();
 }
 
 Meshes::~Meshes() {
@@ -438,22 +773,29 @@ void Meshes::cmd_bind_buffers(VkCommandBuffer cmd) const {
     vk::CmdBindIndexBuffer(cmd, ib_, 0, index_type_);
 }
 
-void Meshes::cmd_draw(VkCommandBuffer cmd, Type type) const {
-    const auto &draw = draw_commands_[type];
+void Meshes::cmd_draw(VkCommandBuffer cmd, Type type, uint32_t lod) const {
+    const auto &draw = draw_commands_[first_lods_[type] + lod];
     vk::CmdDrawIndexed(cmd, draw.indexCount, draw.instanceCount, draw.firstIndex, draw.vertexOffset, draw.firstInstance);
 }
 
-void Meshes::allocate_resources(VkDeviceSize vb_size, VkDeviceSize ib_size, const std::vector<VkMemoryPropertyFlags> &mem_flags) {
+void Meshes::cmd_draw_instanced(VkCommandBuffer cmd, Type type, uint32_t instance_count, uint32_t first_instance) const {
+    const auto &draw = draw_commands_[first_lods_[type] + default_lods_[type]];
+    vk::CmdDrawIndexed(cmd, draw.indexCount, instance_count, draw.firstIndex, draw.vertexOffset, first_instance);
+}
+
+void Meshes::allocate_resources(VkDeviceSize vb_size, VkDeviceSize ib_size, const std::vector<VkMemoryPropertyFlags> &mem_flags,
+                                bool uma) {
+    // buffers are created before we know whether they are staged
     VkBufferCreateInfo buf_info = {};
     buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     buf_info.size = vb_size;
-    buf_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    buf_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
     buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    vk::CreateBuffer(dev_, &buf_info, nullptr, &vb_);
+    vk::assert_success(vk::CreateBuffer(dev_, &buf_info, nullptr, &vb_));
 
     buf_info.size = ib_size;
-    buf_info.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-    vk::CreateBuffer(dev_, &buf_info, nullptr, &ib_);
+    buf_info.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    vk::assert_success(vk::CreateBuffer(dev_, &buf_info, nullptr, &ib_));
 
     VkMemoryRequirements vb_mem_reqs, ib_mem_reqs;
     vk::GetBufferMemoryRequirements(dev_, vb_, &vb_mem_reqs);
@@ -466,19 +808,175 @@ void Meshes::allocate_resources(VkDeviceSize vb_size, VkDeviceSize ib_size, cons
     mem_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
     mem_info.allocationSize = ib_mem_offset_ + ib_mem_reqs.size;
 
-    // find any supported and mappable memory type
-    uint32_t mem_types = (vb_mem_reqs.memoryTypeBits & ib_mem_reqs.memoryTypeBits);
-    for (uint32_t idx = 0; idx < mem_flags.size(); idx++) {
-        if ((mem_types & (1 << idx)) && (mem_flags[idx] & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
-            (mem_flags[idx] & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
-            // TODO this may not be reachable
-            mem_info.memoryTypeIndex = idx;
-            break;
+    const uint32_t mem_types = (vb_mem_reqs.memoryTypeBits & ib_mem_reqs.memoryTypeBits);
+    const VkMemoryPropertyFlags mappable = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    // stage into device local memory, or write in place to mappable memory,
+    // preferably device local
+    uint32_t mem_type = UINT32_MAX;
+    if (!uma) {
+        mem_type = find_memory_type(mem_flags, mem_types, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        staged_ = (mem_type != UINT32_MAX);
+    }
+    if (mem_type == UINT32_MAX) mem_type = find_memory_type(mem_flags, mem_types, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | mappable);
+    if (mem_type == UINT32_MAX) mem_type = find_memory_type(mem_flags, mem_types, mappable);
+    if (mem_type == UINT32_MAX) throw std::runtime_error("failed to find a memory type for meshes");
+
+    mem_info.memoryTypeIndex = mem_type;
+    device_local_ = (mem_flags[mem_type] & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0;
+
+    vk::assert_success(vk::AllocateMemory(dev_, &mem_info, nullptr, &mem_));
+
+    vk::assert_success(vk::BindBufferMemory(dev_, vb_, mem_, 0));
+    vk::assert_success(vk::BindBufferMemory(dev_, ib_, mem_, ib_mem_offset_));
+}
+
+void Meshes::create_staging_buffer(VkDeviceSize size, const std::vector<VkMemoryPropertyFlags> &mem_flags, VkBuffer &buf,
+                                   VkDeviceMemory &mem) {
+    VkBufferCreateInfo buf_info = {};
+    buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buf_info.size = size;
+    buf_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    vk::assert_success(vk::CreateBuffer(dev_, &buf_info, nullptr, &buf));
+
+    VkMemoryRequirements mem_reqs;
+    vk::GetBufferMemoryRequirements(dev_, buf, &mem_reqs);
+
+    const VkMemoryPropertyFlags mappable = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    const uint32_t mem_type = find_memory_type(mem_flags, mem_reqs.memoryTypeBits, mappable);
+    if (mem_type == UINT32_MAX) throw std::runtime_error("failed to find a memory type for staging meshes");
+
+    VkMemoryAllocateInfo mem_info = {};
+    mem_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    mem_info.allocationSize = mem_reqs.size;
+    mem_info.memoryTypeIndex = mem_type;
+    vk::assert_success(vk::AllocateMemory(dev_, &mem_info, nullptr, &mem));
+
+    vk::assert_success(vk::BindBufferMemory(dev_, buf, mem, 0));
+}
+
+void Meshes::copy_staging_buffer(const Shell::Context &ctx, VkBuffer staging_buf, VkDeviceSize vb_size, VkDeviceSize ib_size) {
+    // with a dedicated transfer queue, the buffers are released by the
+    // transfer queue family and acquired by the game queue family
+    const bool transfer_ownership = (ctx.transfer_queue_family != ctx.game_queue_family);
+
+    VkCommandPoolCreateInfo cmd_pool_info = {};
+    cmd_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    VkCommandPool transfer_cmd_pool, game_cmd_pool = VK_NULL_HANDLE;
+    cmd_pool_info.queueFamilyIndex = ctx.transfer_queue_family;
+    vk::assert_success(vk::CreateCommandPool(dev_, &cmd_pool_info, nullptr, &transfer_cmd_pool));
+    if (transfer_ownership) {
+        cmd_pool_info.queueFamilyIndex = ctx.game_queue_family;
+        vk::assert_success(vk::CreateCommandPool(dev_, &cmd_pool_info, nullptr, &game_cmd_pool));
+    }
+
+    VkCommandBufferAllocateInfo cmd_info = {};
+    cmd_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cmd_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmd_info.commandBufferCount = 1;
+
+    VkCommandBuffer transfer_cmd, game_cmd = VK_NULL_HANDLE;
+    cmd_info.commandPool = transfer_cmd_pool;
+    vk::assert_success(vk::AllocateCommandBuffers(dev_, &cmd_info, &transfer_cmd));
+    if (transfer_ownership) {
+        cmd_info.commandPool = game_cmd_pool;
+        vk::assert_success(vk::AllocateCommandBuffers(dev_, &cmd_info, &game_cmd));
+    }
+
+    VkCommandBufferBeginInfo begin_info = {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vk::assert_success(vk::BeginCommandBuffer(transfer_cmd, &begin_info));
+
+    VkBufferCopy region = {};
+    region.srcOffset = 0;
+    region.dstOffset = 0;
+    region.size = vb_size;
+    vk::CmdCopyBuffer(transfer_cmd, staging_buf, vb_, 1, &region);
+
+    region.srcOffset = vb_size;
+    region.size = ib_size;
+    vk::CmdCopyBuffer(transfer_cmd, staging_buf, ib_, 1, &region);
+
+    std::array<VkBufferMemoryBarrier, 2> barriers = {};
+    for (auto &barrier : barriers) {
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+    }
+    barriers[0].buffer = vb_;
+    barriers[0].dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    barriers[1].buffer = ib_;
+    barriers[1].dstAccessMask = VK_ACCESS_INDEX_READ_BIT;
+
+    if (transfer_ownership) {
+        // release; dstAccessMask is ignored
+        for (auto &barrier : barriers) {
+            barrier.srcQueueFamilyIndex = ctx.transfer_queue_family;
+            barrier.dstQueueFamilyIndex = ctx.game_queue_family;
         }
+        vk::CmdPipelineBarrier(transfer_cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+                               static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+
+        // acquire; srcAccessMask is ignored
+        vk::assert_success(vk::BeginCommandBuffer(game_cmd, &begin_info));
+        for (auto &barrier : barriers) barrier.srcAccessMask = 0;
+        vk::CmdPipelineBarrier(game_cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, nullptr,
+                               static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+        vk::assert_success(vk::EndCommandBuffer(game_cmd));
+    } else {
+        vk::CmdPipelineBarrier(transfer_cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, nullptr,
+                               static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
     }
 
-    vk::AllocateMemory(dev_, &mem_info, nullptr, &mem_);
+    vk::assert_success(vk::EndCommandBuffer(transfer_cmd));
 
-    vk::BindBufferMemory(dev_, vb_, mem_, 0);
-    vk::BindBufferMemory(dev_, ib_, mem_, ib_mem_offset_);
+    VkSemaphore sem = VK_NULL_HANDLE;
+    if (transfer_ownership) {
+        VkSemaphoreCreateInfo sem_info = {};
+        sem_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        vk::assert_success(vk::CreateSemaphore(dev_, &sem_info, nullptr, &sem));
+    }
+
+    VkFenceCreateInfo fence_info = {};
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    vk::assert_success(vk::CreateFence(dev_, &fence_info, nullptr, &fence));
+
+    VkSubmitInfo submit_info = {};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &transfer_cmd;
+    if (transfer_ownership) {
+        submit_info.signalSemaphoreCount = 1;
+        submit_info.pSignalSemaphores = &sem;
+        vk::assert_success(vk::QueueSubmit(ctx.transfer_queue, 1, &submit_info, VK_NULL_HANDLE));
+
+        const VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        submit_info = {};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.waitSemaphoreCount = 1;
+        submit_info.pWaitSemaphores = &sem;
+        submit_info.pWaitDstStageMask = &wait_stage;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &game_cmd;
+        vk::assert_success(vk::QueueSubmit(ctx.game_queue, 1, &submit_info, fence));
+    } else {
+        vk::assert_success(vk::QueueSubmit(ctx.transfer_queue, 1, &submit_info, fence));
+    }
+
+    vk::assert_success(vk::WaitForFences(dev_, 1, &fence, true, UINT64_MAX));
+
+    vk::DestroyFence(dev_, fence, nullptr);
+    if (transfer_ownership) {
+        vk::DestroySemaphore(dev_, sem, nullptr);
+        vk::DestroyCommandPool(dev_, game_cmd_pool, nullptr);
+    }
+    vk::DestroyCommandPool(dev_, transfer_cmd_pool, nullptr);
 }
@@ -20,13 +20,29 @@
 #include <vulkan/vulkan.h>
 #include <vector>
 
+#include "MeshOptimizer.h"
+#include "Shell.h"
+
 class Meshes {
    public:
-    Meshes(VkDevice dev, const std::vector<VkMemoryPropertyFlags> &mem_flags);
+    // Mesh data is uploaded through a staging buffer into device local
+    // memory, on the transfer queue of ctx.  UMA devices have no faster
+    // memory to upload to, and mesh data is written in place instead.
+    enum Flags {
+        // 16-bit positions and octahedral encoded normals, which vertex
+        // shaders decode, and 16-bit indices when they fit
+        FLAG_PACKED_VERTICES = 1 << 0,
+        // reorder triangles for the vertex cache and vertices for fetching
+        FLAG_OPTIMIZE = 1 << 1,
+        // also reorder clusters of triangles to reduce overdraw
+        FLAG_OPTIMIZE_OVERDRAW = 1 << 2,
+    };
+    Meshes(const Shell::Context &ctx, const std::vector<VkMemoryPropertyFlags> &mem_flags, uint32_t flags);
     ~Meshes();
 
     const VkPipelineVertexInputStateCreateInfo &vertex_input_state() const { return vertex_input_state_; }
     const VkPipelineInputAssemblyStateCreateInfo &input_assembly_state() const { return input_assembly_state_; }
+    bool packed_vertices() const { return packed_vertices_; }
 
     enum Type {
         MESH_PYRAMID,
@@ -35,14 +51,45 @@ class Meshes {
 
         MESH_COUNT,
     };
+    static const char *type_name(Type type);
+
+    // Each type has a chain of levels of detail, from the full mesh at LOD 0
+    // to coarser ones.  lod_error() is how far, in model space, the surface
+    // of a LOD may be from that of LOD 0, and radius() bounds all of them.
+    // default_lod() is the level drawn when LODs are not selected.
+    uint32_t lod_count(Type type) const { return lod_counts_[type]; }
+    uint32_t default_lod(Type type) const { return default_lods_[type]; }
+    float lod_error(Type type, uint32_t lod) const { return lod_errors_[first_lods_[type] + lod]; }
+    float radius(Type type) const { return radii_[type]; }
+    uint32_t triangle_count(Type type, uint32_t lod) const { return draw_commands_[first_lods_[type] + lod].indexCount / 3; }
 
     void cmd_bind_buffers(VkCommandBuffer cmd) const;
-    void cmd_draw(VkCommandBuffer cmd, Type type) const;
+    void cmd_draw(VkCommandBuffer cmd, Type type, uint32_t lod) const;
+    // always the default LOD
+    void cmd_draw_instanced(VkCommandBuffer cmd, Type type, uint32_t instance_count, uint32_t first_instance) const;
+
+    // vertex and index data read by a draw of the default LOD of type, not counting caches
+    VkDeviceSize draw_size(Type type) const { return draw_sizes_[first_lods_[type] + default_lods_[type]]; }
+
+    // the simulated vertex cache efficiency of the default LOD of type as built and as drawn
+    const mesh_optimizer::CacheStats &built_cache_stats(Type type) const { return built_cache_stats_[type]; }
+    const mesh_optimizer::CacheStats &cache_stats(Type type) const { return cache_stats_[type]; }
+
+    // how mesh data was uploaded
+    bool device_local() const { return device_local_; }
+    bool staged() const { return staged_; }
+    VkDeviceSize upload_size() const { return upload_size_; }
+    double upload_time() const { return upload_time_; }
 
    private:
-    void allocate_resources(VkDeviceSize vb_size, VkDeviceSize ib_size, const std::vector<VkMemoryPropertyFlags> &mem_flags);
+    void allocate_resources(VkDeviceSize vb_size, VkDeviceSize ib_size, const std::vector<VkMemoryPropertyFlags> &mem_flags,
+                            bool uma);
+    void create_staging_buffer(VkDeviceSize size, const std::vector<VkMemoryPropertyFlags> &mem_flags, VkBuffer &buf,
+                               VkDeviceMemory &mem);
+    void copy_staging_buffer(const Shell::Context &ctx, VkBuffer staging_buf, VkDeviceSize vb_size, VkDeviceSize ib_size);
 
     VkDevice dev_;
+    const bool packed_vertices_;
 
     VkVertexInputBindingDescription vertex_input_binding_;
     std::vector<VkVertexInputAttributeDescription> vertex_input_attrs_;
@@ -50,12 +97,28 @@ class Meshes {
     VkPipelineInputAssemblyStateCreateInfo input_assembly_state_;
     VkIndexType index_type_;
 
+    // per type
+    std::vector<uint32_t> first_lods_;
+    std::vector<uint32_t> lod_counts_;
+    std::vector<uint32_t> default_lods_;
+    std::vector<float> radii_;
+    std::vector<mesh_optimizer::CacheStats> built_cache_stats_;
+    std::vector<mesh_optimizer::CacheStats> cache_stats_;
+
+    // per LOD
     std::vector<VkDrawIndexedIndirectCommand> draw_commands_;
+    std::vector<VkDeviceSize> draw_sizes_;
+    std::vector<float> lod_errors_;
 
     VkBuffer vb_;
     VkBuffer ib_;
     VkDeviceMemory mem_;
     VkDeviceSize ib_mem_offset_;
+
+    bool device_local_;
+    bool staged_;
+    VkDeviceSize upload_size_;
+    double upload_time_;
 };
 
 #endif  // MESHES_H
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+#include <stdexcept>
+#include "Profiler.h"
+
+Profiler::Profiler() : epoch_(std::chrono::steady_clock::now()), tracing_(false), trace_empty_(true) {
+    tracks_.reserve(max_track_count);
+    for (int i = 0; i < max_track_count; i++) {
+        tracks_.emplace_back(new TrackData);
+        tracks_.back()->frame_totals.fill(0.0);
+        tracks_.back()->frame_hits.fill(false);
+    }
+
+    window_next_.fill(0);
+}
+
+Profiler::~Profiler() {
+    if (!trace_.is_open()) return;
+
+    for (int i = 0; i < max_track_count; i++) flush_trace(i, tracks_[i]->trace_events);
+    trace_ << "\n]\n";
+}
+
+void Profiler::open_trace(const std::string &filename) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    assert(!trace_.is_open());
+
+    trace_.open(filename.c_str());
+    if (!trace_) throw std::runtime_error("failed to open " + filename);
+
+    trace_ << "[\n";
+    trace_empty_ = true;
+    tracing_ = true;
+}
+
+const char *Profiler::scope_name(Scope scope) {
+    switch (scope) {
+        case SCOPE_ACQUIRE:
+            return "acquire";
+        case SCOPE_FENCE_WAIT:
+            return "fence wait";
+        case SCOPE_SIMULATE:
+            return "simulate";
+        case SCOPE_RECORD:
+            return "record";
+        case SCOPE_SUBMIT:
+            return "submit";
+        case SCOPE_PRESENT:
+            return "present";
+        case SCOPE_GPU:
+            return "gpu";
+        case SCOPE_RESIZE:
+            return "resize";
+        case SCOPE_PRESENT_WAIT:
+            return "present wait";
+        default:
+            assert(!"unreachable");
+            return "";
+    }
+}
+
+void Profiler::add(Scope scope, double begin, double end, int track) {
+    TrackData &data = *tracks_[std::min(track, max_track_count - 1)];
+    std::lock_guard<std::mutex> lock(data.mutex);
+
+    data.frame_totals[scope] += end - begin;
+    data.frame_hits[scope] = true;
+
+    if (tracing_) data.trace_events.push_back({scope, begin, end});
+}
+
+void Profiler::flush_trace(int track, const std::vector<TraceEvent> &events) {
+    for (const auto &event : events) {
+        if (!trace_empty_) trace_ << ",\n";
+        trace_empty_ = false;
+
+        // microseconds
+        trace_ << "{\"name\":\"" << scope_name(event.scope) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << track
+               << ",\"ts\":" << static_cast<uint64_t>(event.begin * 1e6)
+               << ",\"dur\":" << static_cast<uint64_t>((event.end - event.begin) * 1e6) << "}";
+    }
+}
+
+void Profiler::end_frame() {
+    std::array<double, SCOPE_COUNT> frame_totals;
+    std::array<bool, SCOPE_COUNT> frame_hits;
+    frame_totals.fill(0.0);
+    frame_hits.fill(false);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // take what each track added, holding its lock no longer than that; a
+    // scope's frame time is that of the track it took longest on, which for
+    // workers is the critical path rather than the CPU time of all of them
+    std::vector<TraceEvent> events;
+    for (int track = 0; track < max_track_count; track++) {
+        TrackData &data = *tracks_[track];
+        {
+            std::lock_guard<std::mutex> track_lock(data.mutex);
+
+            for (int i = 0; i < SCOPE_COUNT; i++) {
+                frame_totals[i] = std::max(frame_totals[i], data.frame_totals[i]);
+                frame_hits[i] = frame_hits[i] || data.frame_hits[i];
+            }
+            data.frame_totals.fill(0.0);
+            data.frame_hits.fill(false);
+
+            events.clear();
+            events.swap(data.trace_events);
+        }
+
+        flush_trace(track, events);
+    }
+
+    for (int i = 0; i < SCOPE_COUNT; i++) {
+        if (!frame_hits[i]) continue;
+
+        const float ms = static_cast<float>(frame_totals[i] * 1e3);
+        auto &window = windows_[i];
+        if (window.size() < window_size) {
+            window.push_back(ms);
+        } else {
+            window[window_next_[i]] = ms;
+            window_next_[i] = (window_next_[i] + 1) % window_size;
+        }
+    }
+}
+
+void Profiler::report(std::vector<std::string> &lines) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (int i = 0; i < SCOPE_COUNT; i++) {
+        if (windows_[i].empty()) continue;
+
+        std::vector<float> sorted(windows_[i]);
+        std::sort(sorted.begin(), sorted.end());
+        auto percentile = [&sorted](int p) { return sorted[(sorted.size() - 1) * p / 100]; };
+
+        std::stringstream ss;
+        ss << "  " << scope_name(static_cast<Scope>(i)) << ": p50 " << percentile(50) << " ms, p95 " << percentile(95)
+           << " ms, p99 " << percentile(99) << " ms (" << sorted.size() << " frames)";
+        lines.push_back(ss.str());
+    }
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Per-frame timings.  Scopes are summed over a frame on each track, and the
+// largest of the track totals, the critical path when a scope runs on
+// several workers, is the frame's.  The per-frame times of the last
+// window_size frames are reported as percentiles.  Every scope can also be
+// written out as a Chrome trace event (chrome://tracing).
+class Profiler {
+   public:
+    enum Scope {
+        SCOPE_ACQUIRE,
+        SCOPE_FENCE_WAIT,
+        SCOPE_SIMULATE,
+        SCOPE_RECORD,
+        SCOPE_SUBMIT,
+        SCOPE_PRESENT,
+        SCOPE_GPU,
+        SCOPE_RESIZE,
+        SCOPE_PRESENT_WAIT,
+
+        SCOPE_COUNT,
+    };
+
+    // trace tracks; worker i is on TRACK_WORKER + i
+    enum Track {
+        TRACK_MAIN,
+        TRACK_GPU,
+        TRACK_WORKER,
+    };
+
+    static const size_t window_size = 1000;
+
+    // tracks past the last one share its accumulator
+    static const int max_track_count = 64;
+
+    Profiler();
+    ~Profiler();
+
+    Profiler(const Profiler &profiler) = delete;
+    Profiler &operator=(const Profiler &profiler) = delete;
+
+    // write a Chrome trace to filename until destroyed
+    void open_trace(const std::string &filename);
+
+    // seconds since the profiler was created
+    double now() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch_).count(); }
+
+    // thread-safe; a track is only contended by end_frame
+    void add(Scope scope, double begin, double end, int track = TRACK_MAIN);
+
+    void end_frame();
+
+    // one line per scope seen in the window
+    void report(std::vector<std::string> &lines) const;
+
+    class Timer {
+       public:
+        Timer(Profiler &profiler, Scope scope, int track = TRACK_MAIN)
+            : profiler_(profiler), scope_(scope), track_(track), begin_(profiler.now()) {}
+        ~Timer() { profiler_.add(scope_, begin_, profiler_.now(), track_); }
+
+       private:
+        Profiler &profiler_;
+        Scope scope_;
+        int track_;
+        double begin_;
+    };
+
+   private:
+    static const char *scope_name(Scope scope);
+
+    struct TraceEvent {
+        Scope scope;
+        double begin;
+        double end;
+    };
+
+    // what a track added since the last end_frame
+    struct TrackData {
+        std::mutex mutex;
+
+        std::array<double, SCOPE_COUNT> frame_totals;
+        std::array<bool, SCOPE_COUNT> frame_hits;
+        std::vector<TraceEvent> trace_events;
+    };
+
+    void flush_trace(int track, const std::vector<TraceEvent> &events);
+
+    const std::chrono::steady_clock::time_point epoch_;
+
+    // one allocation each, so workers don't share cache lines
+    std::vector<std::unique_ptr<TrackData>> tracks_;
+    std::atomic<bool> tracing_;
+
+    // protects everything below
+    mutable std::mutex mutex_;
+
+    // per-frame totals in milliseconds, as rings
+    std::array<std::vector<float>, SCOPE_COUNT> windows_;
+    std::array<size_t, SCOPE_COUNT> window_next_;
+
+    std::ofstream trace_;
+    bool trace_empty_;
+};
+
+#endif  // PROFILER_H
@@ -15,26 +15,48 @@
  */
 
 #include <cassert>
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <iostream>
 #include <string>
 #include <sstream>
 #include <set>
+#include <thread>
 #include "Helpers.h"
 #include "Shell.h"
 #include "Game.h"
 
 Shell::Shell(Game &game)
-    : game_(game), settings_(game.settings()), ctx_(), game_tick_(1.0f / settings_.ticks_per_second), game_time_(game_tick_) {
+    : game_(game),
+      settings_(game.settings()),
+      ctx_(),
+      frame_start_time_(0.0),
+      profile_blocked_time_(0.0),
+      present_mode_(VK_PRESENT_MODE_FIFO_KHR),
+      next_frame_time_(0.0),
+      present_batch_pos_(0),
+      present_batch_fence_(VK_NULL_HANDLE),
+      game_tick_(1.0f / settings_.ticks_per_second),
+      game_time_(game_tick_),
+      profile_start_time_(0.0),
+      profile_present_count_(0),
+      profile_latency_count_(0),
+      profile_latency_sum_(0.0),
+      profile_latency_max_(0.0) {
     // require generic WSI extensions
-    instance_extensions_.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
-    device_extensions_.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    if (!settings_.headless) {
+        instance_extensions_.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+        device_extensions_.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
 
     // require "standard" validation layers
     if (settings_.validate) {
         instance_layers_.push_back("VK_LAYER_KHRONOS_validation");
         instance_extensions_.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
     }
+
+    if (!settings_.trace_file.empty()) profiler_.open_trace(settings_.trace_file);
 }
 
 void Shell::log(LogPriority priority, const char *msg) const {
@@ -206,6 +228,17 @@ void Shell::init_physical_dev() {
             ctx_.physical_dev = phy;
             ctx_.game_queue_family = game_queue_family;
             ctx_.present_queue_family = present_queue_family;
+
+            // DMA engines are exposed as families with only TRANSFER
+            ctx_.transfer_queue_family = game_queue_family;
+            for (uint32_t i = 0; i < queues.size(); i++) {
+                const VkFlags flags = queues[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT);
+                if (flags == VK_QUEUE_TRANSFER_BIT) {
+                    ctx_.transfer_queue_family = i;
+                    break;
+                }
+            }
+
             break;
         }
     }
@@ -217,8 +250,11 @@ void Shell::create_context() {
     create_dev();
     vk::init_dispatch_table_bottom(ctx_.instance, ctx_.dev);
 
-    vk::GetDeviceQueue(ctx_.dev, ctx_.game_queue_family, 0, &ctx_.game_queue);
+    for (uint32_t i = 0; i < ctx_.game_queues.size(); i++)
+        vk::GetDeviceQueue(ctx_.dev, ctx_.game_queue_family, i, &ctx_.game_queues[i]);
+    ctx_.game_queue = ctx_.game_queues[0];
     vk::GetDeviceQueue(ctx_.dev, ctx_.present_queue_family, 0, &ctx_.present_queue);
+    vk::GetDeviceQueue(ctx_.dev, ctx_.transfer_queue_family, 0, &ctx_.transfer_queue);
 
     create_back_buffers();
 
@@ -240,7 +276,9 @@ void Shell::destroy_context() {
     destroy_back_buffers();
 
     ctx_.game_queue = VK_NULL_HANDLE;
+    ctx_.game_queues.clear();
     ctx_.present_queue = VK_NULL_HANDLE;
+    ctx_.transfer_queue = VK_NULL_HANDLE;
 
     vk::DeviceWaitIdle(ctx_.dev);
     vk::DestroyDevice(ctx_.dev, nullptr);
@@ -251,22 +289,35 @@ void Shell::create_dev() {
     VkDeviceCreateInfo dev_info = {};
     dev_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
-    const std::vector<float> queue_priorities(settings_.queue_count, 0.0f);
-    std::array<VkDeviceQueueCreateInfo, 2> queue_info = {};
+    // ask for no more queues than the family has
+    std::vector<VkQueueFamilyProperties> queue_props;
+    vk::get(ctx_.physical_dev, queue_props);
+    const uint32_t game_queue_count =
+        std::min(static_cast<uint32_t>(std::max(settings_.queue_count, 1)), queue_props[ctx_.game_queue_family].queueCount);
+    ctx_.game_queues.resize(game_queue_count, VK_NULL_HANDLE);
+
+    const std::vector<float> queue_priorities(game_queue_count, 0.0f);
+    std::array<VkDeviceQueueCreateInfo, 3> queue_info = {};
     queue_info[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
     queue_info[0].queueFamilyIndex = ctx_.game_queue_family;
-    queue_info[0].queueCount = settings_.queue_count;
+    queue_info[0].queueCount = game_queue_count;
     queue_info[0].pQueuePriorities = queue_priorities.data();
+    dev_info.queueCreateInfoCount = 1;
 
     if (ctx_.game_queue_family != ctx_.present_queue_family) {
-        queue_info[1].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queue_info[1].queueFamilyIndex = ctx_.present_queue_family;
-        queue_info[1].queueCount = 1;
-        queue_info[1].pQueuePriorities = queue_priorities.data();
+        auto &info = queue_info[dev_info.queueCreateInfoCount++];
+        info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        info.queueFamilyIndex = ctx_.present_queue_family;
+        info.queueCount = 1;
+        info.pQueuePriorities = queue_priorities.data();
+    }
 
-        dev_info.queueCreateInfoCount = 2;
-    } else {
-        dev_info.queueCreateInfoCount = 1;
+    if (ctx_.transfer_queue_family != ctx_.game_queue_family && ctx_.transfer_queue_family != ctx_.present_queue_family) {
+        auto &info = queue_info[dev_info.queueCreateInfoCount++];
+        info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        info.queueFamilyIndex = ctx_.transfer_queue_family;
+        info.queueCount = 1;
+        info.pQueuePriorities = queue_priorities.data();
     }
 
     dev_info.pQueueCreateInfos = queue_info.data();
@@ -292,7 +343,12 @@ void Shell::create_back_buffers() {
     // sync primitives are busy.  Having more BackBuffer's than swapchain
     // images may allows us to replace CPU wait on present_fence by GPU wait
     // on acquire_semaphore.
-    const int count = settings_.back_buffer_count + 1;
+    //
+    // The game queue and a separate present queue only synchronize through
+    // the acquire and render semaphores.  The CPU waits for a present_fence
+    // when it wraps around to the first BackBuffer of a batch, that is when
+    // it is more than frames_ahead() presents ahead.
+    const int count = back_buffer_total();
     for (int i = 0; i < count; i++) {
         BackBuffer buf = {};
         vk::assert_success(vk::CreateSemaphore(ctx_.dev, &sem_info, nullptr, &buf.acquire_semaphore));
@@ -313,6 +369,10 @@ void Shell::destroy_back_buffers() {
 
         ctx_.back_buffers.pop();
     }
+
+    while (!pending_presents_.empty()) pending_presents_.pop();
+    present_batch_pos_ = 0;
+    present_batch_fence_ = VK_NULL_HANDLE;
 }
 
 void Shell::create_swapchain() {
@@ -335,11 +395,14 @@ void Shell::create_swapchain() {
 }
 
 void Shell::destroy_swapchain() {
+    destroy_retired_swapchains(true);
+
     if (ctx_.swapchain != VK_NULL_HANDLE) {
         game_.detach_swapchain();
 
         vk::DestroySwapchainKHR(ctx_.dev, ctx_.swapchain, nullptr);
         ctx_.swapchain = VK_NULL_HANDLE;
+        ctx_.images.clear();
     }
 
     vk::DestroySurfaceKHR(ctx_.instance, ctx_.surface, nullptr);
@@ -369,6 +432,8 @@ void Shell::resize_swapchain(uint32_t width_hint, uint32_t height_hint) {
 
     if (ctx_.extent.width == extent.width && ctx_.extent.height == extent.height) return;
 
+    Profiler::Timer timer(profiler_, Profiler::SCOPE_RESIZE);
+
     uint32_t image_count = settings_.back_buffer_count;
     if (image_count < caps.minImageCount)
         image_count = caps.minImageCount;
@@ -386,12 +451,32 @@ void Shell::resize_swapchain(uint32_t width_hint, uint32_t height_hint) {
     vk::get(ctx_.physical_dev, ctx_.surface, modes);
 
     // FIFO is the only mode universally supported
-    VkPresentModeKHR mode = VK_PRESENT_MODE_FIFO_KHR;
-    for (auto m : modes) {
-        if ((settings_.vsync && m == VK_PRESENT_MODE_MAILBOX_KHR) || (!settings_.vsync && m == VK_PRESENT_MODE_IMMEDIATE_KHR)) {
-            mode = m;
+    VkPresentModeKHR preferred_mode;
+    switch (settings_.present_mode) {
+        case Game::PRESENT_MODE_FIFO_RELAXED:
+            preferred_mode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
             break;
-        }
+        case Game::PRESENT_MODE_MAILBOX:
+            preferred_mode = VK_PRESENT_MODE_MAILBOX_KHR;
+            break;
+        case Game::PRESENT_MODE_IMMEDIATE:
+            preferred_mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+            break;
+        default:
+            preferred_mode = VK_PRESENT_MODE_FIFO_KHR;
+            break;
+    }
+    VkPresentModeKHR mode = VK_PRESENT_MODE_FIFO_KHR;
+    if (std::find(modes.begin(), modes.end(), preferred_mode) != modes.end()) mode = preferred_mode;
+
+    // warn once, for the first swapchain
+    if (ctx_.swapchain == VK_NULL_HANDLE) {
+        std::stringstream ss;
+        if (!settings_.unknown_present_mode.empty())
+            ss << "unknown present mode " << settings_.unknown_present_mode << ", using fifo";
+        else if (mode != preferred_mode)
+            ss << present_mode_name(preferred_mode) << " present mode is not supported, using fifo";
+        if (!ss.str().empty()) log(LOG_WARN, ss.str().c_str());
     }
 
     VkSwapchainCreateInfoKHR swapchain_info = {};
@@ -424,19 +509,42 @@ void Shell::resize_swapchain(uint32_t width_hint, uint32_t height_hint) {
 
     vk::assert_success(vk::CreateSwapchainKHR(ctx_.dev, &swapchain_info, nullptr, &ctx_.swapchain));
     ctx_.extent = extent;
+    present_mode_ = mode;
 
-    // destroy the old swapchain
+    // retire the old swapchain; frames rendered to it may be in flight
     if (swapchain_info.oldSwapchain != VK_NULL_HANDLE) {
-        vk::DeviceWaitIdle(ctx_.dev);
-
         game_.detach_swapchain();
-        vk::DestroySwapchainKHR(ctx_.dev, swapchain_info.oldSwapchain, nullptr);
+
+        RetiredSwapchain retired;
+        retired.swapchain = swapchain_info.oldSwapchain;
+        retired.acquires_left = back_buffer_total() + settings_.frames_in_flight;
+        retired_swapchains_.push_back(retired);
     }
 
+    vk::get(ctx_.dev, ctx_.swapchain, ctx_.images);
     game_.attach_swapchain();
 }
 
+void Shell::destroy_retired_swapchains(bool all) {
+    auto it = retired_swapchains_.begin();
+    while (it != retired_swapchains_.end()) {
+        if (all || --it->acquires_left <= 0) {
+            vk::DestroySwapchainKHR(ctx_.dev, it->swapchain, nullptr);
+            it = retired_swapchains_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 void Shell::add_game_time(float time) {
+    // a fixed timestep keeps the simulation independent of the frame rate
+    if (settings_.replay) {
+        if (!settings_.no_tick) game_.on_tick();
+        game_time_ = 0.0f;
+        return;
+    }
+
     int max_ticks = 3;
 
     if (!settings_.no_tick) game_time_ += time;
@@ -451,16 +559,37 @@ void Shell::acquire_back_buffer() {
     // acquire just once when not presenting
     if (settings_.no_present && ctx_.acquired_back_buffer.acquire_semaphore != VK_NULL_HANDLE) return;
 
+    // input has just been handled
+    frame_start_time_ = profiler_.now();
+
+    Profiler::Timer timer(profiler_, Profiler::SCOPE_ACQUIRE);
+
     auto &buf = ctx_.back_buffers.front();
 
-    // wait until acquire and render semaphores are waited/unsignaled
-    vk::assert_success(vk::WaitForFences(ctx_.dev, 1, &buf.present_fence, true, UINT64_MAX));
-    // reset the fence
-    vk::assert_success(vk::ResetFences(ctx_.dev, 1, &buf.present_fence));
+    // wait until acquire and render semaphores are waited/unsignaled; the
+    // present_fence of the first BackBuffer of a batch was signaled after the
+    // last use of every BackBuffer of the batch
+    if (present_batch_pos_ == 0) {
+        {
+            Profiler::Timer wait_timer(profiler_, Profiler::SCOPE_PRESENT_WAIT);
+            const double wait_begin = profiler_.now();
+            vk::assert_success(vk::WaitForFences(ctx_.dev, 1, &buf.present_fence, true, UINT64_MAX));
+            profile_blocked_time_ += profiler_.now() - wait_begin;
+        }
+        complete_presents(buf.present_fence);
+        // reset the fence
+        vk::assert_success(vk::ResetFences(ctx_.dev, 1, &buf.present_fence));
+        present_batch_fence_ = buf.present_fence;
+    }
+
+    destroy_retired_swapchains(false);
 
     VkResult res = VK_TIMEOUT; // Anything but VK_SUCCESS
     while (res != VK_SUCCESS) {
+        // may block too, waiting for an image to be released
+        const double acquire_begin = profiler_.now();
         res = vk::AcquireNextImageKHR(ctx_.dev, ctx_.swapchain, UINT64_MAX, buf.acquire_semaphore, VK_NULL_HANDLE, &buf.image_index);
+        profile_blocked_time_ += profiler_.now() - acquire_begin;
         if (res == VK_ERROR_OUT_OF_DATE_KHR) {
             // Swapchain is out of date (e.g. the window was resized) and
             // must be recreated:
@@ -477,13 +606,15 @@ void Shell::acquire_back_buffer() {
 void Shell::present_back_buffer() {
     const auto &buf = ctx_.acquired_back_buffer;
 
-    if (!settings_.no_render) game_.on_frame(game_time_ / game_tick_);
+    if (!settings_.no_render) game_.on_frame(frame_pred());
 
     if (settings_.no_present) {
         fake_present();
         return;
     }
 
+    Profiler::Timer timer(profiler_, Profiler::SCOPE_PRESENT);
+
     VkPresentInfoKHR present_info = {};
     present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     present_info.waitSemaphoreCount = 1;
@@ -501,10 +632,111 @@ void Shell::present_back_buffer() {
         assert(!res);
     }
 
-    vk::assert_success(vk::QueueSubmit(ctx_.present_queue, 0, nullptr, buf.present_fence));
+    // only the last present of a batch is fenced
+    add_present(present_batch_fence_);
+    present_batch_pos_ = (present_batch_pos_ + 1) % present_batch_size();
+    if (present_batch_pos_ == 0) vk::assert_success(vk::QueueSubmit(ctx_.present_queue, 0, nullptr, present_batch_fence_));
     ctx_.back_buffers.push(buf);
 }
 
+int Shell::present_batch_size() const {
+    const bool separate_queues = (ctx_.game_queue_family != ctx_.present_queue_family);
+    return (separate_queues && !settings_.no_present) ? frames_ahead() : 1;
+}
+
+void Shell::add_present(VkFence fence) {
+    PendingPresent present;
+    present.fence = fence;
+    present.frame_start_time = frame_start_time_;
+    pending_presents_.push(present);
+}
+
+void Shell::complete_presents(VkFence waited_fence) {
+    // fences are waited for and signaled in submission order
+    const double now = profiler_.now();
+    while (!pending_presents_.empty()) {
+        const auto &present = pending_presents_.front();
+        if (present.fence != waited_fence && vk::GetFenceStatus(ctx_.dev, present.fence) != VK_SUCCESS) break;
+
+        const double latency = now - present.frame_start_time;
+        profile_latency_count_++;
+        profile_latency_sum_ += latency;
+        profile_latency_max_ = std::max(profile_latency_max_, latency);
+
+        // presents of a batch share the fence
+        const bool waited = (present.fence == waited_fence);
+        pending_presents_.pop();
+        if (waited && (pending_presents_.empty() || pending_presents_.front().fence != waited_fence)) break;
+    }
+}
+
+void Shell::limit_frame_rate() {
+    if (!settings_.max_fps) return;
+
+    // Sleep at the end of a frame rather than after handling input, so that
+    // input is as fresh as it can be.  Start over when too far behind.
+    const double frame_time = 1.0 / settings_.max_fps;
+    double now = profiler_.now();
+    if (next_frame_time_ < now - frame_time) next_frame_time_ = now;
+
+    if (next_frame_time_ > now) std::this_thread::sleep_for(std::chrono::duration<double>(next_frame_time_ - now));
+    next_frame_time_ += frame_time;
+}
+
+const char *Shell::present_mode_name(VkPresentModeKHR mode) {
+    switch (mode) {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            return "immediate";
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            return "mailbox";
+        case VK_PRESENT_MODE_FIFO_KHR:
+            return "fifo";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+            return "fifo-relaxed";
+        default:
+            return "unknown";
+    }
+}
+
+void Shell::end_frame() {
+    profiler_.end_frame();
+    complete_presents(VK_NULL_HANDLE);
+    limit_frame_rate();
+
+    const double now = profiler_.now();
+    profile_present_count_++;
+    if (now - profile_start_time_ < 5.0) return;
+
+    const double elapsed = now - profile_start_time_;
+    std::stringstream ss;
+    ss << profile_present_count_ << " presents in " << elapsed << " seconds "
+       << "(FPS: " << profile_present_count_ / elapsed << ")";
+    if (ctx_.swapchain != VK_NULL_HANDLE) ss << ", " << present_mode_name(present_mode_);
+    ss << " with " << ctx_.images.size() << " images";
+    if (settings_.max_fps) ss << " limited to " << settings_.max_fps << " FPS";
+    if (profile_latency_count_) {
+        ss << ", input to present " << profile_latency_sum_ / profile_latency_count_ * 1000.0 << " ms (max "
+           << profile_latency_max_ * 1000.0 << " ms)";
+    }
+    ss << ", CPU blocked " << profile_blocked_time_ / profile_present_count_ * 1000.0 << " ms per frame (" << frames_ahead()
+       << " presents ahead at most";
+    if (present_batch_size() > 1) ss << ", fenced every " << present_batch_size();
+    ss << ")";
+    game_.on_profile(ss);
+    log(LOG_INFO, ss.str().c_str());
+
+    std::vector<std::string> lines;
+    profiler_.report(lines);
+    for (const auto &line : lines) log(LOG_INFO, line.c_str());
+
+    profile_start_time_ = now;
+    profile_present_count_ = 0;
+    profile_latency_count_ = 0;
+    profile_latency_sum_ = 0.0;
+    profile_latency_max_ = 0.0;
+    profile_blocked_time_ = 0.0;
+}
+
 void Shell::fake_present() {
     const auto &buf = ctx_.acquired_back_buffer;
 
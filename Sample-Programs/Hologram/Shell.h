@@ -23,6 +23,7 @@
 #include <vulkan/vulkan.h>
 
 #include "Game.h"
+#include "Profiler.h"
 
 class Game;
 
@@ -49,10 +50,16 @@ class Shell {
         VkPhysicalDevice physical_dev;
         uint32_t game_queue_family;
         uint32_t present_queue_family;
+        // a transfer-only queue family when there is one, for uploads
+        uint32_t transfer_queue_family;
 
         VkDevice dev;
         VkQueue game_queue;
+        // up to Settings::queue_count queues of the game queue family, the
+        // first being game_queue
+        std::vector<VkQueue> game_queues;
         VkQueue present_queue;
+        VkQueue transfer_queue;
 
         std::queue<BackBuffer> back_buffers;
 
@@ -61,11 +68,19 @@ class Shell {
 
         VkSwapchainKHR swapchain;
         VkExtent2D extent;
+        // swapchain images, or the offscreen images of a headless shell
+        std::vector<VkImage> images;
 
         BackBuffer acquired_back_buffer;
     };
     const Context &context() const { return ctx_; }
 
+    Profiler &profiler() { return profiler_; }
+
+    // for games to report CPU time they spend blocked, such as on frame
+    // fences, in the FPS log line
+    void add_blocked_time(double seconds) { profile_blocked_time_ += seconds; }
+
     enum LogPriority {
         LOG_DEBUG,
         LOG_INFO,
@@ -86,12 +101,42 @@ class Shell {
     void create_context();
     void destroy_context();
 
-    void resize_swapchain(uint32_t width_hint, uint32_t height_hint);
+    // a headless shell replaces the swapchain by its own images
+    virtual void create_swapchain();
+    virtual void destroy_swapchain();
+    virtual void resize_swapchain(uint32_t width_hint, uint32_t height_hint);
 
     void add_game_time(float time);
-
-    void acquire_back_buffer();
-    void present_back_buffer();
+    // how far the game time is into the next tick, for Game::on_frame
+    float frame_pred() const { return game_time_ / game_tick_; }
+
+    // called by the run loops after every present; logs the frame rate and
+    // the profiler report every few seconds
+    void end_frame();
+
+    virtual void acquire_back_buffer();
+    virtual void present_back_buffer();
+
+    // Input to present latency is measured from the start of
+    // acquire_back_buffer, right after input is handled, to when the
+    // present_fence submitted after the present is seen signaled.  Shells
+    // that replace present_back_buffer call these to keep it measured.
+    void add_present(VkFence fence);
+    void complete_presents(VkFence waited_fence);
+
+    // how many presents the CPU may get ahead of before it waits for one to
+    // complete
+    int frames_ahead() const { return settings_.max_frames_ahead ? settings_.max_frames_ahead : settings_.back_buffer_count + 1; }
+
+    // When the game and present queue families differ, only the last present
+    // of each batch of frames_ahead() signals a present_fence, and the CPU
+    // waits once per batch, when it is more than frames_ahead() presents
+    // ahead.  The back buffers are then two batches.
+    virtual int present_batch_size() const;
+    int back_buffer_total() const {
+        const int batch_size = present_batch_size();
+        return batch_size > 1 ? 2 * batch_size : frames_ahead();
+    }
 
     Game &game_;
     const Game::Settings &settings_;
@@ -101,6 +146,14 @@ class Shell {
 
     std::vector<const char *> device_extensions_;
 
+    Context ctx_;
+
+    Profiler profiler_;
+    double frame_start_time_;
+    // CPU time spent waiting for presents in acquire_back_buffer, and added
+    // by the game, since the last FPS log line
+    double profile_blocked_time_;
+
    private:
     bool debug_report_callback(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT obj_type, uint64_t object, size_t location,
                                int32_t msg_code, const char *layer_prefix, const char *msg);
@@ -129,15 +182,43 @@ class Shell {
     void create_back_buffers();
     void destroy_back_buffers();
     virtual VkSurfaceKHR create_surface(VkInstance instance) = 0;
-    void create_swapchain();
-    void destroy_swapchain();
 
     void fake_present();
+    void limit_frame_rate();
+    static const char *present_mode_name(VkPresentModeKHR mode);
 
-    Context ctx_;
+    VkPresentModeKHR present_mode_;
+    double next_frame_time_;
+
+    // where the next present is in its batch, and the present_fence the
+    // batch signals
+    int present_batch_pos_;
+    VkFence present_batch_fence_;
+
+    struct PendingPresent {
+        VkFence fence;
+        double frame_start_time;
+    };
+    std::queue<PendingPresent> pending_presents_;
+
+    // Swapchains replaced by resize_swapchain are destroyed once every back
+    // buffer has been acquired again, and the game has rendered
+    // frames_in_flight frames since.  Their presents have completed by then.
+    struct RetiredSwapchain {
+        VkSwapchainKHR swapchain;
+        int acquires_left;
+    };
+    std::vector<RetiredSwapchain> retired_swapchains_;
+    void destroy_retired_swapchains(bool all);
 
     const float game_tick_;
     float game_time_;
+
+    double profile_start_time_;
+    int profile_present_count_;
+    int profile_latency_count_;
+    double profile_latency_sum_;
+    double profile_latency_max_;
 };
 
 #endif  // SHELL_H
@@ -234,5 +234,7 @@ void ShellAndroid::run() {
         present_back_buffer();
 
         current_time = t;
+
+        end_frame();
     }
 }
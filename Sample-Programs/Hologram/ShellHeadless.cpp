@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+#include <sstream>
+#include <dlfcn.h>
+#include <time.h>
+
+#include "Helpers.h"
+#include "Game.h"
+#include "ShellHeadless.h"
+
+namespace {
+
+class PosixTimer {
+   public:
+    PosixTimer() { reset(); }
+
+    void reset() { clock_gettime(CLOCK_MONOTONIC, &start_); }
+
+    double get() const {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        constexpr long one_s_in_ns = 1000 * 1000 * 1000;
+        constexpr double one_s_in_ns_d = static_cast<double>(one_s_in_ns);
+
+        time_t s = now.tv_sec - start_.tv_sec;
+        long ns;
+        if (now.tv_nsec > start_.tv_nsec) {
+            ns = now.tv_nsec - start_.tv_nsec;
+        } else {
+            assert(s > 0);
+            s--;
+            ns = one_s_in_ns - (start_.tv_nsec - now.tv_nsec);
+        }
+
+        return static_cast<double>(s) + static_cast<double>(ns) / one_s_in_ns_d;
+    }
+
+   private:
+    struct timespec start_;
+};
+
+}  // namespace
+
+ShellHeadless::ShellHeadless(Game &game) : Shell(game), lib_handle_(nullptr), image_count_(0), quit_(false) {
+    assert(settings_.headless);
+
+    init_vk();
+}
+
+ShellHeadless::~ShellHeadless() {
+    cleanup_vk();
+    dlclose(lib_handle_);
+}
+
+PFN_vkGetInstanceProcAddr ShellHeadless::load_vk() {
+    const char filename[] = "libvulkan.so.1";
+    void *handle, *symbol;
+
+#ifdef UNINSTALLED_LOADER
+    handle = dlopen(UNINSTALLED_LOADER, RTLD_LAZY);
+    if (!handle) handle = dlopen(filename, RTLD_LAZY);
+#else
+    handle = dlopen(filename, RTLD_LAZY);
+#endif
+
+    if (handle) symbol = dlsym(handle, "vkGetInstanceProcAddr");
+
+    if (!handle || !symbol) {
+        std::stringstream ss;
+        ss << "failed to load " << dlerror();
+
+        if (handle) dlclose(handle);
+
+        throw std::runtime_error(ss.str());
+    }
+
+    lib_handle_ = handle;
+
+    return reinterpret_cast<PFN_vkGetInstanceProcAddr>(symbol);
+}
+
+bool ShellHeadless::can_present(VkPhysicalDevice phy, uint32_t queue_family) {
+    // "presenting" is a submission; keep it on the game queue family
+    std::vector<VkQueueFamilyProperties> queues;
+    vk::get(phy, queues);
+
+    return (queues[queue_family].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+}
+
+void ShellHeadless::create_swapchain() {
+    const VkFormat formats[] = {VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM};
+
+    ctx_.format.format = VK_FORMAT_UNDEFINED;
+    ctx_.format.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    for (auto format : formats) {
+        VkFormatProperties props;
+        vk::GetPhysicalDeviceFormatProperties(ctx_.physical_dev, format, &props);
+        if (props.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT) {
+            ctx_.format.format = format;
+            break;
+        }
+    }
+    if (ctx_.format.format == VK_FORMAT_UNDEFINED) throw std::runtime_error("failed to find a color attachment format");
+
+    ctx_.surface = VK_NULL_HANDLE;
+    ctx_.swapchain = VK_NULL_HANDLE;
+
+    // defer to resize_swapchain()
+    ctx_.extent.width = (uint32_t)-1;
+    ctx_.extent.height = (uint32_t)-1;
+
+    // Give each back buffer its own image, so that waiting for its
+    // present_fence also means its image is idle.  Acquire semaphores start
+    // out signaled and are signaled again by every present.
+    image_count_ = static_cast<uint32_t>(ctx_.back_buffers.size());
+
+    std::vector<VkSemaphore> acquire_semaphores;
+    for (uint32_t i = 0; i < image_count_; i++) {
+        BackBuffer buf = ctx_.back_buffers.front();
+        ctx_.back_buffers.pop();
+
+        buf.image_index = i;
+        acquire_semaphores.push_back(buf.acquire_semaphore);
+
+        ctx_.back_buffers.push(buf);
+    }
+
+    VkSubmitInfo submit_info = {};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.signalSemaphoreCount = static_cast<uint32_t>(acquire_semaphores.size());
+    submit_info.pSignalSemaphores = acquire_semaphores.data();
+    vk::assert_success(vk::QueueSubmit(ctx_.present_queue, 1, &submit_info, VK_NULL_HANDLE));
+}
+
+void ShellHeadless::destroy_swapchain() {
+    if (!ctx_.images.empty()) {
+        game_.detach_swapchain();
+        destroy_images();
+    }
+}
+
+void ShellHeadless::resize_swapchain(uint32_t width_hint, uint32_t height_hint) {
+    if (ctx_.extent.width == width_hint && ctx_.extent.height == height_hint) return;
+
+    if (!ctx_.images.empty()) {
+        vk::DeviceWaitIdle(ctx_.dev);
+
+        game_.detach_swapchain();
+        destroy_images();
+    }
+
+    VkExtent2D extent;
+    extent.width = width_hint;
+    extent.height = height_hint;
+    create_images(extent);
+
+    game_.attach_swapchain();
+}
+
+void ShellHeadless::create_images(const VkExtent2D &extent) {
+    VkImageCreateInfo image_info = {};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = ctx_.format.format;
+    image_info.extent.width = extent.width;
+    image_info.extent.height = extent.height;
+    image_info.extent.depth = 1;
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VkPhysicalDeviceMemoryProperties mem_props;
+    vk::GetPhysicalDeviceMemoryProperties(ctx_.physical_dev, &mem_props);
+
+    ctx_.images.reserve(image_count_);
+    image_mems_.reserve(image_count_);
+    for (uint32_t i = 0; i < image_count_; i++) {
+        VkImage img;
+        vk::assert_success(vk::CreateImage(ctx_.dev, &image_info, nullptr, &img));
+        ctx_.images.push_back(img);
+
+        VkMemoryRequirements mem_reqs;
+        vk::GetImageMemoryRequirements(ctx_.dev, img, &mem_reqs);
+
+        // prefer device local memory; software implementations may have none
+        uint32_t mem_type = UINT32_MAX;
+        for (uint32_t type = 0; type < mem_props.memoryTypeCount; type++) {
+            if (!(mem_reqs.memoryTypeBits & (1 << type))) continue;
+
+            if (mem_type == UINT32_MAX) mem_type = type;
+            if (mem_props.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
+                mem_type = type;
+                break;
+            }
+        }
+        assert(mem_type != UINT32_MAX);
+
+        VkMemoryAllocateInfo mem_info = {};
+        mem_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        mem_info.allocationSize = mem_reqs.size;
+        mem_info.memoryTypeIndex = mem_type;
+
+        VkDeviceMemory mem;
+        vk::assert_success(vk::AllocateMemory(ctx_.dev, &mem_info, nullptr, &mem));
+        image_mems_.push_back(mem);
+
+        vk::assert_success(vk::BindImageMemory(ctx_.dev, img, mem, 0));
+    }
+
+    ctx_.extent = extent;
+}
+
+void ShellHeadless::destroy_images() {
+    for (auto img : ctx_.images) vk::DestroyImage(ctx_.dev, img, nullptr);
+    for (auto mem : image_mems_) vk::FreeMemory(ctx_.dev, mem, nullptr);
+
+    ctx_.images.clear();
+    image_mems_.clear();
+}
+
+void ShellHeadless::acquire_back_buffer() {
+    frame_start_time_ = profiler_.now();
+
+    Profiler::Timer timer(profiler_, Profiler::SCOPE_ACQUIRE);
+
+    auto &buf = ctx_.back_buffers.front();
+
+    // wait until the image is idle and the acquire semaphore is signaled
+    {
+        Profiler::Timer wait_timer(profiler_, Profiler::SCOPE_PRESENT_WAIT);
+        const double wait_begin = profiler_.now();
+        vk::assert_success(vk::WaitForFences(ctx_.dev, 1, &buf.present_fence, true, UINT64_MAX));
+        profile_blocked_time_ += profiler_.now() - wait_begin;
+    }
+    complete_presents(buf.present_fence);
+    vk::assert_success(vk::ResetFences(ctx_.dev, 1, &buf.present_fence));
+
+    ctx_.acquired_back_buffer = buf;
+    ctx_.back_buffers.pop();
+}
+
+void ShellHeadless::present_back_buffer() {
+    const auto &buf = ctx_.acquired_back_buffer;
+
+    if (!settings_.no_render) game_.on_frame(frame_pred());
+
+    Profiler::Timer timer(profiler_, Profiler::SCOPE_PRESENT);
+
+    // wait render semaphore and signal acquire semaphore for the next use of
+    // this back buffer; the acquire semaphore is still signaled otherwise
+    VkPipelineStageFlags stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    VkSubmitInfo submit_info = {};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    if (!settings_.no_render) {
+        submit_info.waitSemaphoreCount = 1;
+        submit_info.pWaitSemaphores = &buf.render_semaphore;
+        submit_info.pWaitDstStageMask = &stage;
+        submit_info.signalSemaphoreCount = 1;
+        submit_info.pSignalSemaphores = &buf.acquire_semaphore;
+    }
+    vk::assert_success(vk::QueueSubmit(ctx_.present_queue, 1, &submit_info, buf.present_fence));
+    add_present(buf.present_fence);
+
+    ctx_.back_buffers.push(buf);
+}
+
+void ShellHeadless::run() {
+    create_context();
+    resize_swapchain(settings_.initial_width, settings_.initial_height);
+
+    PosixTimer timer;
+
+    double current_time = timer.get();
+    int frame_count = 0;
+
+    quit_ = false;
+    while (!quit_) {
+        acquire_back_buffer();
+
+        double t = timer.get();
+        add_game_time(static_cast<float>(t - current_time));
+
+        present_back_buffer();
+
+        current_time = t;
+
+        end_frame();
+
+        frame_count++;
+        if (settings_.max_frame_count > 0 && frame_count >= settings_.max_frame_count) quit_ = true;
+    }
+
+    std::stringstream ss;
+    ss << frame_count << " frames in " << current_time << " seconds (FPS: " << frame_count / current_time << ")";
+    log(LOG_INFO, ss.str().c_str());
+
+    destroy_context();
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SHELL_HEADLESS_H
+#define SHELL_HEADLESS_H
+
+#include "Shell.h"
+
+// A shell without a window system.  Each back buffer renders to an offscreen
+// image owned by the shell, and "presenting" only waits for the rendering.
+// Frames are driven as fast as possible.
+class ShellHeadless : public Shell {
+   public:
+    ShellHeadless(Game &game);
+    ~ShellHeadless();
+
+    void run();
+    void quit() { quit_ = true; }
+
+   private:
+    PFN_vkGetInstanceProcAddr load_vk();
+    bool can_present(VkPhysicalDevice phy, uint32_t queue_family);
+    VkSurfaceKHR create_surface(VkInstance instance) { return VK_NULL_HANDLE; }
+
+    void create_swapchain();
+    void destroy_swapchain();
+    void resize_swapchain(uint32_t width_hint, uint32_t height_hint);
+
+    // every present is a submission of its own
+    int present_batch_size() const { return 1; }
+
+    void acquire_back_buffer();
+    void present_back_buffer();
+
+    void create_images(const VkExtent2D &extent);
+    void destroy_images();
+
+    void *lib_handle_;
+
+    uint32_t image_count_;
+    std::vector<VkDeviceMemory> image_mems_;
+
+    bool quit_;
+};
+
+#endif  // SHELL_HEADLESS_H
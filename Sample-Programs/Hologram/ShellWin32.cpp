@@ -212,6 +212,8 @@ void ShellWin32::run() {
         present_back_buffer();
 
         current_time = t;
+
+        end_frame();
     }
 
     destroy_context();
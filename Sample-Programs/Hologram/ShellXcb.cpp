@@ -234,8 +234,6 @@ void ShellXcb::loop_poll() {
     PosixTimer timer;
 
     double current_time = timer.get();
-    double profile_start_time = current_time;
-    int profile_present_count = 0;
 
     while (true) {
         // handle pending events
@@ -258,17 +256,7 @@ void ShellXcb::loop_poll() {
 
         current_time = t;
 
-        profile_present_count++;
-        if (current_time - profile_start_time >= 5.0) {
-            const double fps = profile_present_count / (current_time - profile_start_time);
-            std::stringstream ss;
-            ss << profile_present_count << " presents in " << current_time - profile_start_time << " seconds "
-               << "(FPS: " << fps << ")";
-            log(LOG_INFO, ss.str().c_str());
-
-            profile_start_time = current_time;
-            profile_present_count = 0;
-        }
+        end_frame();
     }
 }
 
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE2
+#endif
+
+// Minimal float lanes for the batched kernels.  Kernels are templates over
+// a lane type and are instantiated for simd::Wide, the widest type the build
+// targets, and for simd::F1 to handle the leftovers.
+namespace simd {
+
+struct F1 {
+    typedef bool Mask;
+    static const int width = 1;
+
+    float v;
+
+    F1() {}
+    F1(float f) : v(f) {}
+
+    static F1 load(const float *p) { return F1(*p); }
+    void store(float *p) const { *p = v; }
+
+    friend F1 operator+(F1 a, F1 b) { return F1(a.v + b.v); }
+    friend F1 operator-(F1 a, F1 b) { return F1(a.v - b.v); }
+    friend F1 operator*(F1 a, F1 b) { return F1(a.v * b.v); }
+    friend F1 operator/(F1 a, F1 b) { return F1(a.v / b.v); }
+    friend F1 operator-(F1 a) { return F1(-a.v); }
+
+    friend Mask operator==(F1 a, F1 b) { return a.v == b.v; }
+    friend Mask operator>=(F1 a, F1 b) { return a.v >= b.v; }
+    friend Mask operator>(F1 a, F1 b) { return a.v > b.v; }
+
+    friend F1 round(F1 a) { return F1(std::nearbyint(a.v)); }
+    friend F1 select(Mask m, F1 a, F1 b) { return m ? a : b; }
+
+    static Mask mask_or(Mask a, Mask b) { return a || b; }
+    static int mask_bits(Mask m) { return m ? 1 : 0; }
+};
+
+#if defined(SIMD_AVX2)
+
+struct F8 {
+    typedef __m256 Mask;
+    static const int width = 8;
+
+    __m256 v;
+
+    F8() {}
+    F8(float f) : v(_mm256_set1_ps(f)) {}
+    F8(__m256 m) : v(m) {}
+
+    static F8 load(const float *p) { return F8(_mm256_loadu_ps(p)); }
+    void store(float *p) const { _mm256_storeu_ps(p, v); }
+
+    friend F8 operator+(F8 a, F8 b) { return F8(_mm256_add_ps(a.v, b.v)); }
+    friend F8 operator-(F8 a, F8 b) { return F8(_mm256_sub_ps(a.v, b.v)); }
+    friend F8 operator*(F8 a, F8 b) { return F8(_mm256_mul_ps(a.v, b.v)); }
+    friend F8 operator/(F8 a, F8 b) { return F8(_mm256_div_ps(a.v, b.v)); }
+    friend F8 operator-(F8 a) { return F8(_mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f))); }
+
+    friend Mask operator==(F8 a, F8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ); }
+    friend Mask operator>=(F8 a, F8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+    friend Mask operator>(F8 a, F8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+
+    friend F8 round(F8 a) { return F8(_mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)); }
+    friend F8 select(Mask m, F8 a, F8 b) { return F8(_mm256_blendv_ps(b.v, a.v, m)); }
+
+    static Mask mask_or(Mask a, Mask b) { return _mm256_or_ps(a, b); }
+    static int mask_bits(Mask m) { return _mm256_movemask_ps(m); }
+};
+
+typedef F8 Wide;
+
+#elif defined(SIMD_SSE2)
+
+struct F4 {
+    typedef __m128 Mask;
+    static const int width = 4;
+
+    __m128 v;
+
+    F4() {}
+    F4(float f) : v(_mm_set1_ps(f)) {}
+    F4(__m128 m) : v(m) {}
+
+    static F4 load(const float *p) { return F4(_mm_loadu_ps(p)); }
+    void store(float *p) const { _mm_storeu_ps(p, v); }
+
+    friend F4 operator+(F4 a, F4 b) { return F4(_mm_add_ps(a.v, b.v)); }
+    friend F4 operator-(F4 a, F4 b) { return F4(_mm_sub_ps(a.v, b.v)); }
+    friend F4 operator*(F4 a, F4 b) { return F4(_mm_mul_ps(a.v, b.v)); }
+    friend F4 operator/(F4 a, F4 b) { return F4(_mm_div_ps(a.v, b.v)); }
+    friend F4 operator-(F4 a) { return F4(_mm_xor_ps(a.v, _mm_set1_ps(-0.0f))); }
+
+    friend Mask operator==(F4 a, F4 b) { return _mm_cmpeq_ps(a.v, b.v); }
+    friend Mask operator>=(F4 a, F4 b) { return _mm_cmpge_ps(a.v, b.v); }
+    friend Mask operator>(F4 a, F4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+
+    // round to nearest even, like the other lane types; fine for |a| < 2^31
+    friend F4 round(F4 a) { return F4(_mm_cvtepi32_ps(_mm_cvtps_epi32(a.v))); }
+    friend F4 select(Mask m, F4 a, F4 b) { return F4(_mm_or_ps(_mm_and_ps(m, a.v), _mm_andnot_ps(m, b.v))); }
+
+    static Mask mask_or(Mask a, Mask b) { return _mm_or_ps(a, b); }
+    static int mask_bits(Mask m) { return _mm_movemask_ps(m); }
+};
+
+typedef F4 Wide;
+
+#else
+
+typedef F1 Wide;
+
+#endif
+
+template <typename F>
+inline F floor(F x) {
+    const F r = round(x);
+    return r - select(r > x, F(1.0f), F(0.0f));
+}
+
+// sin and cos for |x| up to a few thousand, to within a few ulp
+template <typename F>
+inline void sincos(F x, F &s, F &c) {
+    // x = j * pi/2 + r, with r in [-pi/4, pi/4]
+    const F j = round(x * F(0.636619772f));
+    const F r = ((x - j * F(1.5703125f)) - j * F(4.837512969970703125e-4f)) - j * F(7.549789948768648e-8f);
+    const F r2 = r * r;
+
+    const F sin_r = r + r * r2 * (F(-1.6666654611e-1f) + r2 * (F(8.3321608736e-3f) + r2 * F(-1.9515295891e-4f)));
+    const F cos_r = F(1.0f) - F(0.5f) * r2 +
+                    r2 * r2 * (F(4.166664568298827e-2f) + r2 * (F(-1.388731625493765e-3f) + r2 * F(2.443315711809948e-5f)));
+
+    // quadrant q = j mod 4
+    const F q = j - F(4.0f) * floor(j * F(0.25f));
+    const typename F::Mask swap = F::mask_or(q == F(1.0f), q == F(3.0f));
+    s = select(swap, cos_r, sin_r);
+    c = select(swap, sin_r, cos_r);
+    s = select(q >= F(2.0f), -s, s);
+    c = select(F::mask_or(q == F(1.0f), q == F(2.0f)), -c, c);
+}
+
+}  // namespace simd
+
+#endif  // SIMD_H
@@ -16,8 +16,11 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstring>
 #include <array>
+#include <limits>
 #include <glm/gtc/matrix_transform.hpp>
+#include "Simd.h"
 #include "Simulation.h"
 
 namespace {
@@ -250,37 +253,375 @@ void Path::generate_subpath() {
     current_.curve.reset(curve);
 }
 
-Simulation::Simulation(int object_count) : random_dev_() {
+namespace {
+
+// PCG-RXS-M-XS; small enough to keep one per object
+uint32_t random_next(uint32_t &state) {
+    state = state * 747796405u + 2891336453u;
+    uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float random_float(uint32_t &state, float min, float max) {
+    return min + (max - min) * static_cast<float>(random_next(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+}  // namespace
+
+// Animation and Path state for the batched update.  A subpath is
+//
+//   origin + c0 + c1 * cos(t) + c2 * sin(t) + c3 * (t - t0)
+//
+// where t is the time since the subpath started.  Circles use c0 to c2 and
+// random curves use c0 and c3, with c0 and t0 moving to the end of the
+// current segment once t reaches segment_end.
+struct Simulation::Batch {
+    std::vector<uint32_t> rng;
+
+    std::vector<float> axis[3];
+    std::vector<float> speed;
+    std::vector<float> scale;
+    std::vector<float> angle;
+    std::vector<float> alpha;
+    std::vector<float> alpha_inc;
+
+    std::vector<float> now;
+    std::vector<float> start;
+    std::vector<float> end;
+    std::vector<float> origin[3];
+    std::vector<float> c0[3];
+    std::vector<float> c1[3];
+    std::vector<float> c2[3];
+    std::vector<float> c3[3];
+    std::vector<float> t0;
+    std::vector<float> segment_end;
+};
+
+Simulation::Simulation(int object_count, bool batched, unsigned int seed) : seed_rng_(seed) {
     MeshPicker mesh;
-    ColorPicker color(random_dev_());
+    ColorPicker color(seed_rng_());
 
     objects_.reserve(object_count);
     for (int i = 0; i < object_count; i++) {
         Meshes::Type type = mesh.pick();
-        float scale = mesh.scale(type);
 
-        objects_.emplace_back(Object{
-            type, glm::vec3(0.5f + 0.5f * (float)i / object_count), color.pick(), Animation(random_dev_(), scale),
-            Path(random_dev_()),
-        });
+        objects_.emplace_back(Object{type, glm::vec3(0.5f + 0.5f * (float)i / object_count), color.pick()});
+    }
+
+    if (batched) {
+        init_batch();
+        return;
+    }
+
+    animations_.reserve(object_count);
+    paths_.reserve(object_count);
+    for (const auto &obj : objects_) {
+        animations_.emplace_back(Animation(seed_rng_(), mesh.scale(obj.mesh)));
+        paths_.emplace_back(Path(seed_rng_()));
     }
 }
 
-void Simulation::set_frame_data_size(uint32_t size) {
-    uint32_t offset = 0;
-    for (auto &obj : objects_) {
-        obj.frame_data_offset = offset;
-        offset += size;
+Simulation::~Simulation() {}
+
+void Simulation::init_batch() {
+    const size_t count = objects_.size();
+    MeshPicker mesh;
+
+    batch_.reset(new Batch);
+    Batch &b = *batch_;
+
+    std::vector<float> *lanes[] = {
+        &b.speed, &b.scale, &b.angle, &b.alpha, &b.alpha_inc, &b.now, &b.start, &b.end, &b.t0, &b.segment_end,
+    };
+    for (auto v : lanes) v->resize(count);
+    for (int k = 0; k < 3; k++) {
+        b.axis[k].resize(count);
+        b.origin[k].resize(count);
+        b.c0[k].resize(count);
+        b.c1[k].resize(count);
+        b.c2[k].resize(count);
+        b.c3[k].resize(count);
+    }
+    b.rng.resize(count);
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t &rng = b.rng[i];
+        rng = seed_rng_();
+
+        float x = random_float(rng, -1.0f, 1.0f);
+        float y = random_float(rng, -1.0f, 1.0f);
+        float z = random_float(rng, -1.0f, 1.0f);
+        if (std::abs(x) + std::abs(y) + std::abs(z) == 0.0f) x = 1.0f;
+
+        const glm::vec3 axis = glm::normalize(glm::vec3(x, y, z));
+        for (int k = 0; k < 3; k++) b.axis[k][i] = axis[k];
+
+        b.speed[i] = random_float(rng, 0.1f, 1.0f);
+        b.scale[i] = mesh.scale(objects_[i].mesh);
+        b.angle[i] = 0.0f;
+
+        b.alpha[i] = b.speed[i];
+        b.alpha_inc[i] = b.alpha[i] > 0.5f ? 0.05f : -0.05f;
+
+        // trigger a subpath generation
+        b.now[i] = 0.0f;
+        b.start[i] = 0.0f;
+        b.end[i] = -1.0f;
+        b.segment_end[i] = std::numeric_limits<float>::infinity();
+    }
+}
+
+float Simulation::curve_position(int i, int axis, float t) const {
+    const Batch &b = *batch_;
+
+    simd::F1 s, c;
+    simd::sincos(simd::F1(t), s, c);
+
+    return b.c0[axis][i] + b.c1[axis][i] * c.v + b.c2[axis][i] * s.v + b.c3[axis][i] * (t - b.t0[i]);
+}
+
+void Simulation::advance_path(int i) {
+    Batch &b = *batch_;
+
+    while (b.now[i] >= b.end[i]) generate_subpath(i);
+
+    const float t = b.now[i] - b.start[i];
+    if (t >= b.segment_end[i]) generate_segment(i, t);
+}
+
+void Simulation::generate_subpath(int i) {
+    Batch &b = *batch_;
+    uint32_t &rng = b.rng[i];
+
+    float duration = random_float(rng, 5.0f, 20.0f);
+    CurveType type = static_cast<CurveType>(random_next(rng) % CURVE_COUNT);
+
+    // end is negative only before the first subpath
+    if (b.end[i] >= 0.0f) {
+        for (int k = 0; k < 3; k++) {
+            float origin = b.origin[k][i] + curve_position(i, k, b.end[i] - b.start[i]);
+            b.origin[k][i] = origin - 2.0f * std::floor(origin * 0.5f);
+        }
+        b.start[i] = b.end[i];
+    } else {
+        for (int k = 0; k < 3; k++) b.origin[k][i] = random_float(rng, 0.0f, 2.0f);
+        b.start[i] = b.now[i];
+    }
+
+    b.end[i] = b.start[i] + duration;
+
+    for (int k = 0; k < 3; k++) {
+        b.c0[k][i] = 0.0f;
+        b.c1[k][i] = 0.0f;
+        b.c2[k][i] = 0.0f;
+        b.c3[k][i] = 0.0f;
+    }
+    b.t0[i] = 0.0f;
+
+    switch (type) {
+        case CURVE_RANDOM:
+            // start a segment on the first evaluation
+            b.segment_end[i] = 0.0f;
+            break;
+        case CURVE_CIRCLE: {
+            // one draw per statement; argument evaluation order is unspecified
+            glm::vec3 axis;
+            for (int k = 0; k < 3; k++) axis[k] = random_float(rng, -1.0f, 1.0f);
+            if (axis.x == 0.0f && axis.y == 0.0f && axis.z == 0.0f) axis.x = 1.0f;
+
+            float radius = random_float(rng, 0.02f, 0.2f);
+
+            // same construction as CircleCurve
+            glm::vec3 a;
+            if (axis.x != 0.0f) {
+                a = glm::vec3(-axis.z / axis.x, 0.0f, 1.0f);
+            } else if (axis.y != 0.0f) {
+                a = glm::vec3(1.0f, -axis.x / axis.y, 0.0f);
+            } else {
+                a = glm::vec3(1.0f, 0.0f, -axis.x / axis.z);
+            }
+            a = glm::normalize(a);
+            glm::vec3 bn = glm::normalize(glm::cross(a, axis));
+
+            for (int k = 0; k < 3; k++) {
+                b.c0[k][i] = -a[k] * radius;
+                b.c1[k][i] = a[k] * radius;
+                b.c2[k][i] = bn[k] * radius;
+            }
+            b.segment_end[i] = std::numeric_limits<float>::infinity();
+        } break;
+        default:
+            assert(!"unreachable");
+            break;
+    }
+}
+
+void Simulation::generate_segment(int i, float t) {
+    Batch &b = *batch_;
+    uint32_t &rng = b.rng[i];
+
+    // continue from where the last segment ends
+    for (int k = 0; k < 3; k++) b.c0[k][i] += b.c3[k][i] * (b.segment_end[i] - b.t0[i]);
+
+    glm::vec3 direction;
+    for (int k = 0; k < 3; k++) direction[k] = random_float(rng, -0.3f, 0.3f);
+    float duration = random_float(rng, 1.0f, 5.0f);
+
+    for (int k = 0; k < 3; k++) b.c3[k][i] = direction[k] / duration;
+    b.t0[i] = t;
+    b.segment_end[i] = t + duration;
+}
+
+template <typename F>
+void Simulation::update_lanes(float time, int first) {
+    Batch &b = *batch_;
+    const int i = first;
+    const F t(time);
+
+    F now = F::load(&b.now[i]) + t;
+    now.store(&b.now[i]);
+
+    // subpaths and segments run out every few seconds; handle those lanes
+    // one at a time before evaluating
+    const int expired =
+        F::mask_bits(F::mask_or(now >= F::load(&b.end[i]), now - F::load(&b.start[i]) >= F::load(&b.segment_end[i])));
+    if (expired) {
+        for (int lane = 0; lane < F::width; lane++) {
+            if (expired & (1 << lane)) advance_path(i + lane);
+        }
+    }
+
+    F s, c;
+
+    const F rel = now - F::load(&b.start[i]);
+    simd::sincos(rel, s, c);
+    const F seg = rel - F::load(&b.t0[i]);
+
+    F pos[3];
+    for (int k = 0; k < 3; k++) {
+        pos[k] = F::load(&b.origin[k][i]) + F::load(&b.c0[k][i]) + F::load(&b.c1[k][i]) * c + F::load(&b.c2[k][i]) * s +
+                 F::load(&b.c3[k][i]) * seg;
+    }
+
+    // accumulate the angle and keep it in [-pi, pi]
+    F angle = F::load(&b.angle[i]) + F::load(&b.speed[i]) * t;
+    angle = angle - F(6.28318531f) * round(angle * F(0.159154943f));
+    angle.store(&b.angle[i]);
+    simd::sincos(angle, s, c);
+
+    // scale(mat4(1), vec3(scale)) * rotate(mat4(1), angle, axis)
+    const F x = F::load(&b.axis[0][i]);
+    const F y = F::load(&b.axis[1][i]);
+    const F z = F::load(&b.axis[2][i]);
+    const F scale = F::load(&b.scale[i]);
+    const F sc = scale * c;
+    const F ss = scale * s;
+    const F tx = (scale - sc) * x;
+    const F ty = (scale - sc) * y;
+    const F tz = (scale - sc) * z;
+
+    F alpha = F::load(&b.alpha[i]);
+    F alpha_inc = F::load(&b.alpha_inc[i]);
+    alpha_inc = select(F::mask_or(F(0.0f) >= alpha, alpha >= F(1.0f)), -alpha_inc, alpha_inc);
+    alpha = alpha + alpha_inc;
+    alpha.store(&b.alpha[i]);
+    alpha_inc.store(&b.alpha_inc[i]);
+
+    float out[13][F::width];
+    (sc + tx * x).store(out[0]);
+    (tx * y + ss * z).store(out[1]);
+    (tx * z - ss * y).store(out[2]);
+    (ty * x - ss * z).store(out[3]);
+    (sc + ty * y).store(out[4]);
+    (ty * z + ss * x).store(out[5]);
+    (tz * x + ss * y).store(out[6]);
+    (tz * y - ss * x).store(out[7]);
+    (sc + tz * z).store(out[8]);
+    pos[0].store(out[9]);
+    pos[1].store(out[10]);
+    pos[2].store(out[11]);
+    alpha.store(out[12]);
+
+    for (int lane = 0; lane < F::width; lane++) {
+        auto &obj = objects_[i + lane];
+
+        obj.model[0] = glm::vec4(out[0][lane], out[1][lane], out[2][lane], 0.0f);
+        obj.model[1] = glm::vec4(out[3][lane], out[4][lane], out[5][lane], 0.0f);
+        obj.model[2] = glm::vec4(out[6][lane], out[7][lane], out[8][lane], 0.0f);
+        obj.model[3] = glm::vec4(out[9][lane], out[10][lane], out[11][lane], 1.0f);
+        obj.alpha = out[12][lane];
+    }
+}
+
+uint64_t Simulation::checksum() const {
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](float val) {
+        uint32_t bits;
+        memcpy(&bits, &val, sizeof(bits));
+        for (int i = 0; i < 4; i++) {
+            hash ^= (bits >> (8 * i)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    };
+
+    for (const auto &obj : objects_) {
+        for (int col = 0; col < 4; col++) {
+            for (int row = 0; row < 4; row++) add(obj.model[col][row]);
+        }
+        add(obj.alpha);
+    }
+
+    return hash;
+}
+
+void Simulation::pack_state(int i, PackedState &state) const {
+    const Batch &b = *batch_;
+
+    for (int k = 0; k < 3; k++) {
+        state.axis[k] = b.axis[k][i];
+        state.origin[k] = b.origin[k][i];
+        state.c0[k] = b.c0[k][i];
+        state.c1[k] = b.c1[k][i];
+        state.c2[k] = b.c2[k][i];
+        state.c3[k] = b.c3[k][i];
+    }
+    state.speed = b.speed[i];
+    state.scale = b.scale[i];
+    state.angle = b.angle[i];
+    state.alpha = b.alpha[i];
+    state.alpha_inc = b.alpha_inc[i];
+    state.t0 = b.t0[i];
+    state.now = b.now[i];
+    state.start = b.start[i];
+    state.end = b.end[i];
+    state.segment_end = b.segment_end[i];
+    state.rng = b.rng[i];
+    memset(state.padding, 0, sizeof(state.padding));
+}
+
+void Simulation::set_frame_data_size(uint32_t size, uint32_t objects_per_block) {
+    for (size_t i = 0; i < objects_.size(); i++) {
+        auto &obj = objects_[i];
+        obj.frame_data_block = static_cast<uint32_t>(i / objects_per_block);
+        obj.frame_data_offset = static_cast<uint32_t>(i % objects_per_block) * size;
     }
 }
 
 void Simulation::update(float time, int begin, int end) {
+    if (batch_) {
+        int i = begin;
+        for (; i + simd::Wide::width <= end; i += simd::Wide::width) update_lanes<simd::Wide>(time, i);
+        for (; i < end; i++) update_lanes<simd::F1>(time, i);
+
+        return;
+    }
+
     for (int i = begin; i < end; i++) {
         auto &obj = objects_[i];
 
-        glm::vec3 pos = obj.path.position(time);
-        glm::mat4 trans = obj.animation.transformation(time);
+        glm::vec3 pos = paths_[i].position(time);
+        glm::mat4 trans = animations_[i].transformation(time);
         obj.model = glm::translate(glm::mat4(1.0f), pos) * trans;
-        obj.alpha = obj.animation.transparency();
+        obj.alpha = animations_[i].transparency();
     }
 }
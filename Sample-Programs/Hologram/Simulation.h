@@ -80,16 +80,25 @@ class Path {
 
 class Simulation {
    public:
-    Simulation(int object_count);
+    // When batched, object state is kept as structure of arrays and updated
+    // simd::Wide objects at a time.  Paths are then evaluated in closed form
+    // and objects draw from their own small generators, so the motion is
+    // statistically the same but not identical to the unbatched update.
+    //
+    // All randomness derives from seed.  For a given seed and build, the
+    // object states after a sequence of updates do not depend on how the
+    // update ranges are split, as long as batched ranges start at multiples
+    // of simd::Wide::width.
+    Simulation(int object_count, bool batched, unsigned int seed);
+    ~Simulation();
 
     struct Object {
         Meshes::Type mesh;
         glm::vec3 light_pos;
         glm::vec3 light_color;
 
-        Animation animation;
-        Path path;
-
+        // dynamic offset into uniform buffer frame_data_block
+        uint32_t frame_data_block;
         uint32_t frame_data_offset;
 
         glm::mat4 model;
@@ -97,15 +106,60 @@ class Simulation {
     };
 
     const std::vector<Object> &objects() const { return objects_; }
+    bool batched() const { return batch_ != nullptr; }
+
+    unsigned int rng_seed() { return seed_rng_(); }
 
-    unsigned int rng_seed() { return random_dev_(); }
+    // FNV-1a over the bits of all models and alphas
+    uint64_t checksum() const;
+
+    // batched state of one object, in the std430 layout of sim_state in
+    // Hologram.sim.comp
+    struct PackedState {
+        float axis[3];
+        float speed;
+        float origin[3];
+        float scale;
+        float c0[3];
+        float angle;
+        float c1[3];
+        float alpha;
+        float c2[3];
+        float alpha_inc;
+        float c3[3];
+        float t0;
+        float now;
+        float start;
+        float end;
+        float segment_end;
+        uint32_t rng;
+        uint32_t padding[3];
+    };
+    void pack_state(int i, PackedState &state) const;
 
-    void set_frame_data_size(uint32_t size);
+    void set_frame_data_size(uint32_t size, uint32_t objects_per_block);
     void update(float time, int begin, int end);
 
    private:
-    std::random_device random_dev_;
+    struct Batch;
+
+    template <typename F>
+    void update_lanes(float time, int first);
+
+    void init_batch();
+    void advance_path(int i);
+    void generate_subpath(int i);
+    void generate_segment(int i, float t);
+    float curve_position(int i, int axis, float t) const;
+
+    std::mt19937 seed_rng_;
     std::vector<Object> objects_;
+
+    // unbatched state, parallel to objects_
+    std::vector<Animation> animations_;
+    std::vector<Path> paths_;
+
+    std::unique_ptr<Batch> batch_;
 };
 
 #endif  // SIMULATION_H
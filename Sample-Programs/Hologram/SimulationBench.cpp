@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Times Simulation::update with and without batching, on one thread, and
+// prints the checksums of the final states.  Checksums must match across
+// runs with the same seed.
+//
+//   HologramSimBench [-n objects] [-t ticks] [-s seed]
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Simd.h"
+#include "Simulation.h"
+
+namespace {
+
+double time_update(Simulation &sim, int ticks, float tick_interval) {
+    const int count = static_cast<int>(sim.objects().size());
+
+    // warm up and get past the first subpaths
+    for (int i = 0; i < 10; i++) sim.update(tick_interval, 0, count);
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < ticks; i++) sim.update(tick_interval, 0, count);
+    auto end = std::chrono::steady_clock::now();
+
+    // nanoseconds per object per tick
+    return std::chrono::duration<double, std::nano>(end - begin).count() / ticks / count;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    int object_count = 5000;
+    int ticks = 3000;
+    unsigned int seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg(argv[i]);
+        if (arg == "-n" && i + 1 < argc) {
+            object_count = std::stoi(argv[++i]);
+        } else if (arg == "-t" && i + 1 < argc) {
+            ticks = std::stoi(argv[++i]);
+        } else if (arg == "-s" && i + 1 < argc) {
+            seed = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else {
+            std::cerr << "usage: " << argv[0] << " [-n objects] [-t ticks] [-s seed]" << std::endl;
+            return 1;
+        }
+    }
+
+    const float tick_interval = 1.0f / 30.0f;
+
+    Simulation scalar(object_count, false, seed);
+    Simulation batched(object_count, true, seed);
+
+    const double scalar_ns = time_update(scalar, ticks, tick_interval);
+    const double batched_ns = time_update(batched, ticks, tick_interval);
+
+    std::cout << object_count << " objects, " << ticks << " ticks, seed " << seed << std::endl;
+    std::cout << "unbatched: " << scalar_ns << " ns/object, checksum " << std::hex << std::setw(16) << std::setfill('0')
+              << scalar.checksum() << std::dec << std::endl;
+    std::cout << "batched (" << simd::Wide::width << " lanes): " << batched_ns << " ns/object, " << scalar_ns / batched_ns
+              << "x, checksum " << std::hex << std::setw(16) << std::setfill('0') << batched.checksum() << std::dec << std::endl;
+
+    return 0;
+}
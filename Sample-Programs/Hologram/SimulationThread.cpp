@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+#include "SimulationThread.h"
+
+SimulationThread::SimulationThread(const Simulation &sim, int worker_count, int chunk_size, const JobPool::Job &update)
+    : sim_(sim),
+      chunk_size_(chunk_size),
+      update_(update),
+      pool_(worker_count),
+      requested_ticks_(0),
+      quit_(false),
+      tick_count_(0),
+      back_(0),
+      front_(1),
+      middle_(2) {}
+
+SimulationThread::~SimulationThread() { assert(!thread_.joinable()); }
+
+void SimulationThread::capture(std::vector<State> &states) const {
+    const auto &objects = sim_.objects();
+
+    states.resize(objects.size());
+    for (size_t i = 0; i < objects.size(); i++) {
+        states[i].model = objects[i].model;
+        states[i].alpha = objects[i].alpha;
+    }
+}
+
+void SimulationThread::start() {
+    assert(!thread_.joinable());
+
+    // the reader starts out with the current states
+    capture(last_);
+    Snapshot &front = snapshots_[front_];
+    front.tick = tick_count_.load(std::memory_order_relaxed);
+    front.prev = last_;
+    front.cur = last_;
+
+    requested_ticks_ = front.tick;
+    quit_ = false;
+
+    pool_.start();
+    thread_ = std::thread(&SimulationThread::thread_loop, this);
+}
+
+void SimulationThread::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    tick_cv_.notify_one();
+
+    thread_.join();
+    pool_.stop();
+}
+
+void SimulationThread::request_tick() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (requested_ticks_ - tick_count_.load(std::memory_order_relaxed) >= max_pending_ticks) return;
+        requested_ticks_++;
+    }
+    tick_cv_.notify_one();
+}
+
+const SimulationThread::Snapshot &SimulationThread::acquire() {
+    if (middle_.load(std::memory_order_relaxed) & fresh_bit)
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & index_mask;
+
+    return snapshots_[front_];
+}
+
+void SimulationThread::thread_loop() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            tick_cv_.wait(lock, [this] { return quit_ || requested_ticks_ > tick_count_.load(std::memory_order_relaxed); });
+            if (requested_ticks_ == tick_count_.load(std::memory_order_relaxed)) break;
+        }
+
+        tick();
+    }
+}
+
+void SimulationThread::tick() {
+    pool_.run(0, static_cast<int>(sim_.objects().size()), chunk_size_, update_);
+
+    const uint64_t tick = tick_count_.load(std::memory_order_relaxed) + 1;
+
+    Snapshot &back = snapshots_[back_];
+    back.tick = tick;
+    back.prev.swap(last_);
+    capture(back.cur);
+    last_ = back.cur;
+
+    // publish
+    back_ = middle_.exchange(back_ | fresh_bit, std::memory_order_acq_rel) & index_mask;
+    tick_count_.store(tick, std::memory_order_release);
+}
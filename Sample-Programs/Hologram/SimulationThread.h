@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2016 Google, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SIMULATION_THREAD_H
+#define SIMULATION_THREAD_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "JobPool.h"
+#include "Simulation.h"
+
+// Runs the ticks of a Simulation on a thread and a JobPool of its own.  The
+// thread owning the simulation requests ticks, which never blocks, and reads
+// the results back as snapshots.  Snapshots are exchanged through a triple
+// buffer: the simulation thread fills the back snapshot and swaps it with the
+// middle one, and the reader swaps the middle one with its front snapshot
+// when the middle one is newer.  Neither side ever waits for the other.
+//
+// Simulation::Object members other than model and alpha do not change and
+// may be read while the thread runs.  model and alpha must be read from
+// snapshots instead.
+class SimulationThread {
+   public:
+    struct State {
+        glm::mat4 model;
+        float alpha;
+    };
+
+    // the states of all objects after the last two ticks
+    struct Snapshot {
+        uint64_t tick;
+        std::vector<State> prev;
+        std::vector<State> cur;
+    };
+
+    // update is run on the pool to advance objects [begin, end) by a tick
+    SimulationThread(const Simulation &sim, int worker_count, int chunk_size, const JobPool::Job &update);
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread &thread) = delete;
+    SimulationThread &operator=(const SimulationThread &thread) = delete;
+
+    int worker_count() const { return pool_.worker_count(); }
+
+    void start();
+    // finish the requested ticks and stop
+    void stop();
+
+    // ticks requested while more than max_pending_ticks are still pending
+    // are dropped, so that a slow simulation does not fall further behind
+    static const uint64_t max_pending_ticks = 3;
+    void request_tick();
+
+    // the latest snapshot, valid until the next call
+    const Snapshot &acquire();
+
+    // ticks run so far
+    uint64_t tick_count() const { return tick_count_.load(std::memory_order_acquire); }
+
+   private:
+    void thread_loop();
+    void tick();
+    void capture(std::vector<State> &states) const;
+
+    const Simulation &sim_;
+    const int chunk_size_;
+    const JobPool::Job update_;
+    JobPool pool_;
+
+    std::thread thread_;
+
+    // protects requested_ticks_ and quit_
+    std::mutex mutex_;
+    std::condition_variable tick_cv_;
+    uint64_t requested_ticks_;
+    bool quit_;
+
+    std::atomic<uint64_t> tick_count_;
+
+    // states after the last tick, owned by the simulation thread
+    std::vector<State> last_;
+
+    static const int fresh_bit = 0x4;
+    static const int index_mask = 0x3;
+
+    Snapshot snapshots_[3];
+    // owned by the simulation thread
+    int back_;
+    // owned by the reader
+    int front_;
+    // index of the middle snapshot, with fresh_bit set when it has not been
+    // read yet
+    std::atomic<int> middle_;
+};
+
+#endif  // SIMULATION_THREAD_H